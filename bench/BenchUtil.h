@@ -0,0 +1,76 @@
+// bench/BenchUtil.h
+// Helpers shared by the benchmark programs: scratch directories, timing,
+// percentiles and the balance total that posting benchmarks check.
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include "UserAuth.h"
+#include <algorithm>  // For std::min, std::max
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdint>    // For int64_t
+#include <cstdlib>    // For mkdtemp
+#include <deque>
+#include <filesystem> // For std::filesystem::create_directory, current_path, remove_all
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Create a fresh directory base/name_XXXXXX; returns its path, or "" (after
+// reporting it) if it could not be created
+inline std::string makeTempDirectory(const std::string& base, const std::string& name) {
+    std::string path = base + "/" + name + "_XXXXXX";
+    if (!mkdtemp(&path[0])) {
+        std::cerr << "Error: Could not create a directory under " << base << "." << std::endl;
+        return "";
+    }
+    return path;
+}
+
+// Create a fresh temporary directory holding an empty data/ and make it the
+// working directory, so the real data/ files are untouched. Returns its
+// path, or "" if it could not be created.
+inline std::string enterScratchDirectory(const std::string& name) {
+    std::string path = makeTempDirectory("/tmp", name);
+    if (!path.empty()) {
+        std::filesystem::current_path(path);
+        std::filesystem::create_directory("data");
+    }
+    return path;
+}
+
+// Leave a directory made by enterScratchDirectory and delete it
+inline void leaveScratchDirectory(const std::string& path) {
+    std::filesystem::current_path("/");
+    std::filesystem::remove_all(path);
+}
+
+// Seconds elapsed since start
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Milliseconds elapsed since start
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Nearest-rank percentile p (0-100] of non-empty samples sorted ascending
+inline double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+// Sum every balance, in paisa
+inline int64_t totalBalance() {
+    int64_t total = 0;
+    UserAuth::snapshotAccounts([&total](const std::vector<const std::deque<Account>*>& shards) {
+        for (const auto* accounts : shards) {
+            for (const auto& acc : *accounts) {
+                total += acc.getBalance().toPaisa();
+            }
+        }
+    });
+    return total;
+}
+
+#endif // BENCHUTIL_H
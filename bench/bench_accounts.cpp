@@ -0,0 +1,185 @@
+// bench/bench_accounts.cpp
+// Memory and load-time benchmark: the previous Account layout (three
+// std::string members per account) against the packed Account whose owner
+// names live in the name arena. Both load the same accounts file. Then
+// saves the accounts as shard files and times a full
+// UserAuth::loadAccounts of them, which prints its phase-by-phase
+// breakdown.
+// Usage: bench_accounts [accounts]   (default: 10000000)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountFile.h"
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "UserAuth.h"
+#include <atomic>     // For std::atomic
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::malloc, std::free, std::strtoull
+#include <deque>
+#include <filesystem> // For std::filesystem::file_size, remove
+#include <fstream>
+#include <iomanip>    // For std::setw, std::setprecision
+#include <iostream>
+#include <malloc.h>   // For mallinfo2
+#include <new>        // For std::bad_alloc
+#include <thread>     // For std::thread::hardware_concurrency
+#include <vector>
+
+// Count every heap allocation made through operator new
+static std::atomic<size_t> allocationCount(0);
+
+void* operator new(size_t n) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// The Account layout before names were moved into the arena
+struct StringAccount {
+    std::string accountNumber;
+    std::string pin; // Now the PIN hash
+    Money balance;
+    std::string ownerName;
+    AccountType accountType;
+};
+
+// Bytes currently allocated from the heap (small chunks plus mmapped ones)
+static size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+struct LoadStats {
+    double seconds;
+    double bytesPerAccount;
+    double allocationsPerAccount;
+};
+
+// Run load, which fills a container with n accounts, and measure it
+template <typename LoadFn>
+LoadStats measure(size_t n, LoadFn load) {
+    size_t heapBefore = heapInUse();
+    size_t allocsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    load();
+    auto end = std::chrono::steady_clock::now();
+    LoadStats stats;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    stats.bytesPerAccount = static_cast<double>(heapInUse() - heapBefore) / n;
+    stats.allocationsPerAccount = static_cast<double>(allocationCount.load() - allocsBefore) / n;
+    return stats;
+}
+
+static void printRow(const char* label, const LoadStats& stats) {
+    std::cout << std::setw(24) << label
+              << std::setw(14) << std::fixed << std::setprecision(3) << stats.seconds
+              << std::setw(16) << std::setprecision(1) << stats.bytesPerAccount
+              << std::setw(16) << std::setprecision(2) << stats.allocationsPerAccount << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    n = std::max<size_t>(n, 1);
+
+    std::string scratch = enterScratchDirectory("bench_accounts");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    // Write an accounts file with realistic owner names (longer than the
+    // 15 characters std::string can hold without a heap allocation)
+    {
+        std::deque<Account> seed;
+        const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+        for (size_t i = 0; i < n; ++i) {
+            seed.emplace_back(unpackAccountNumber(1000000000ULL + i), pin, Money::fromPaisa(100000),
+                              "Customer " + std::to_string(1000000000ULL + i), AccountType::SAVINGS);
+        }
+        if (!AccountFile::write("data/accounts.dat", seed)) {
+            std::cerr << "Error: Could not write the accounts file." << std::endl;
+            return 1;
+        }
+    }
+    AccountFile file;
+    if (!file.open("data/accounts.dat")) {
+        std::cerr << "Error: Could not map the accounts file." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Accounts: " << n << "  (sizeof: string layout " << sizeof(StringAccount)
+              << " B, packed layout " << sizeof(Account) << " B)" << std::endl;
+    std::cout << std::setw(24) << "Layout"
+              << std::setw(14) << "Load (s)"
+              << std::setw(16) << "Heap B/account"
+              << std::setw(16) << "Allocs/account" << std::endl;
+
+    // Both loads read data that is already in memory: the old layout parses
+    // a copy of the file, the new one the warmed-up mapping
+    std::vector<char> bytes(std::filesystem::file_size("data/accounts.dat"));
+    std::ifstream("data/accounts.dat", std::ios::binary).read(bytes.data(), bytes.size());
+    int64_t checksum = 0;
+    for (size_t i = 0; i < file.recordCount(); ++i) {
+        checksum += file.readBalance(i).toPaisa();
+    }
+
+    std::deque<StringAccount> stringAccounts;
+    LoadStats before = measure(n, [&]() {
+        const AccountFileHeader& hdr = *reinterpret_cast<const AccountFileHeader*>(bytes.data());
+        const AccountRecord* recs = reinterpret_cast<const AccountRecord*>(bytes.data() + sizeof(hdr));
+        const char* names = bytes.data() + hdr.namesOffset;
+        for (size_t i = 0; i < hdr.recordCount; ++i) {
+            const AccountRecord& rec = recs[i];
+            stringAccounts.push_back(StringAccount{unpackAccountNumber(rec.accountNumber),
+                                                   std::string(reinterpret_cast<const char*>(rec.pinHash),
+                                                               sizeof(rec.pinHash)),
+                                                   Money::fromPaisa(rec.balance),
+                                                   std::string(names + rec.nameOffset, rec.nameLength),
+                                                   static_cast<AccountType>(rec.type)});
+        }
+    });
+    printRow("std::string members", before);
+    stringAccounts.clear();
+    stringAccounts.shrink_to_fit();
+    bytes.clear();
+    bytes.shrink_to_fit();
+
+    std::deque<Account> packedAccounts;
+    LoadStats after = measure(n, [&]() { file.readAccounts(packedAccounts); });
+    printRow("packed + name arena", after);
+    if (checksum != static_cast<int64_t>(n) * 100000) {
+        std::cerr << "Warning: unexpected balance total." << std::endl;
+    }
+
+    std::cout << "Memory per account: " << std::setprecision(1)
+              << (1.0 - after.bytesPerAccount / before.bytesPerAccount) * 100.0 << "% less; load "
+              << std::setprecision(2) << before.seconds / after.seconds << "x faster." << std::endl;
+
+    file.close();
+    std::filesystem::remove("data/accounts.dat"); // Otherwise loadAccounts reads it as a pre-shard file
+    for (const auto& acc : packedAccounts) {
+        UserAuth::addAccount(acc);
+    }
+    UserAuth::saveAccounts();
+    packedAccounts.clear();
+    packedAccounts.shrink_to_fit();
+
+    std::cout << "\nUserAuth::loadAccounts (sharded) on " << std::thread::hardware_concurrency()
+              << " hardware thread(s):" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    UserAuth::loadAccounts();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Total " << std::setprecision(3) << seconds << " s for "
+              << UserAuth::accountCount() << " accounts." << std::endl;
+
+    leaveScratchDirectory(scratch);
+    return 0;
+}
@@ -0,0 +1,87 @@
+// bench/bench_allocator.cpp
+// Benchmark: account number allocation. Times raw allocations, checks that
+// every issued number is distinct and carries a valid check digit, and that
+// a restarted allocator never reissues a number. Then registers accounts in
+// bulk through UserAuth::createAccount at growing sizes; with constant-time
+// allocation the time per account should stay flat.
+// Usage: bench_allocator [accounts]   (default: 1000000)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountNumberAllocator.h"
+#include "BenchUtil.h"
+#include "PinHash.h"
+#include "UserAuth.h"
+#include <algorithm>  // For std::min, std::max
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::strtoull
+#include <iomanip>    // For std::setw, std::setprecision
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    count = std::max<size_t>(count, 1);
+
+    std::string scratch = enterScratchDirectory("bench_allocator");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    bool ok = true;
+    std::unordered_set<uint64_t> seen;
+    seen.reserve(count + AccountNumberAllocator::BLOCK_SIZE);
+    {
+        AccountNumberAllocator allocator("data/bench.alloc");
+        std::vector<uint64_t> keys(count);
+        auto t = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            ok = allocator.allocate(keys[i]) && ok;
+        }
+        double seconds = secondsSince(t);
+        std::cout << "Allocated " << count << " numbers in " << std::fixed << std::setprecision(3) << seconds
+                  << " s (" << std::setprecision(1) << seconds * 1e9 / count << " ns each)" << std::endl;
+
+        for (uint64_t key : keys) {
+            if (!seen.insert(key).second || !AccountNumberAllocator::hasValidCheckDigit(key)) {
+                std::cerr << "Error: Number " << key << " is repeated or has a bad check digit." << std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+    {
+        // A restart resumes past the last reserved block
+        AccountNumberAllocator restarted("data/bench.alloc");
+        for (size_t i = 0; i < AccountNumberAllocator::BLOCK_SIZE; ++i) {
+            uint64_t key;
+            if (!restarted.allocate(key) || !seen.insert(key).second) {
+                std::cerr << "Error: The restarted allocator reissued a number." << std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+    std::cout << "Distinct with valid check digits, also after a restart: " << (ok ? "yes" : "NO") << std::endl;
+
+    // Bulk registration; PIN hashing is made cheap so the allocator and store dominate
+    PinHash::setIterations(1);
+    std::cout << std::left << std::setw(14) << "Accounts" << std::setw(14) << "Seconds"
+              << "us/account" << std::endl;
+    size_t registered = 0;
+    for (size_t batch = std::max<size_t>(count / 8, 1); registered < count; batch *= 2) {
+        batch = std::min(batch, count - registered);
+        auto t = std::chrono::steady_clock::now();
+        ok = UserAuth::reserveAccountNumbers(batch) && ok;
+        for (size_t i = 0; i < batch; ++i) {
+            ok = !UserAuth::createAccount("1234", Money(), "Customer", AccountType::SAVINGS, Account::NO_ACCOUNT_KEY)
+                      .empty() && ok;
+        }
+        double seconds = secondsSince(t);
+        registered += batch;
+        std::cout << std::setw(14) << registered << std::fixed << std::setprecision(3) << std::setw(14) << seconds
+                  << std::setprecision(2) << seconds * 1e6 / batch << std::endl;
+    }
+
+    leaveScratchDirectory(scratch);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// bench/bench_analytics.cpp
+// Benchmark: balance analytics (per-type count/total/min/max, a filtered
+// count and a histogram) computed by a naive loop over the Account objects
+// versus the struct-of-arrays columns with scalar and AVX2 kernels.
+// Usage: bench_analytics [accounts]   (default: 10000000)
+#include "Analytics.h"
+#include "AccountIndex.h" // For unpackAccountNumber
+#include <algorithm>  // For std::upper_bound, std::min, std::max
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::strtoull
+#include <iomanip>    // For std::setw, std::setprecision
+#include <iostream>
+#include <limits>     // For std::numeric_limits
+#include <random>     // For std::mt19937_64
+#include <vector>
+
+static const Money THRESHOLD = Money::fromPaisa(500 * 100);
+static const Money EDGES[] = {Money(), Money::fromPaisa(100 * 100), Money::fromPaisa(1000 * 100),
+                              Money::fromPaisa(10000 * 100), Money::fromPaisa(100000 * 100),
+                              Money::fromPaisa(1000000 * 100), Money::fromPaisa(10000000 * 100)};
+static const size_t EDGE_COUNT = sizeof(EDGES) / sizeof(EDGES[0]);
+
+// Everything the report needs, so the two approaches can be compared
+struct Results {
+    BalanceStats perType[ACCOUNT_TYPE_COUNT];
+    size_t below;
+    size_t buckets[EDGE_COUNT + 1];
+
+    bool operator==(const Results& other) const {
+        for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+            const BalanceStats& a = perType[t];
+            const BalanceStats& b = other.perType[t];
+            if (a.count != b.count || a.total != b.total || a.minimum != b.minimum || a.maximum != b.maximum) {
+                return false;
+            }
+        }
+        return below == other.below && std::equal(buckets, buckets + EDGE_COUNT + 1, other.buckets);
+    }
+};
+
+// One pass over the Account objects, as callers of getAccounts() do today
+static Results naiveLoop(const std::deque<Account>& accounts) {
+    Results r;
+    int64_t lo[ACCOUNT_TYPE_COUNT], hi[ACCOUNT_TYPE_COUNT], sum[ACCOUNT_TYPE_COUNT] = {};
+    std::fill(lo, lo + ACCOUNT_TYPE_COUNT, std::numeric_limits<int64_t>::max());
+    std::fill(hi, hi + ACCOUNT_TYPE_COUNT, std::numeric_limits<int64_t>::min());
+    int64_t edges[EDGE_COUNT];
+    for (size_t k = 0; k < EDGE_COUNT; ++k) {
+        edges[k] = EDGES[k].toPaisa();
+    }
+    r.below = 0;
+    std::fill(r.buckets, r.buckets + EDGE_COUNT + 1, 0);
+    for (const auto& acc : accounts) {
+        size_t t = static_cast<size_t>(acc.getAccountType());
+        int64_t balance = acc.getBalance().toPaisa();
+        ++r.perType[t].count;
+        sum[t] += balance;
+        lo[t] = std::min(lo[t], balance);
+        hi[t] = std::max(hi[t], balance);
+        r.below += balance < THRESHOLD.toPaisa();
+        ++r.buckets[std::upper_bound(edges, edges + EDGE_COUNT, balance) - edges];
+    }
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        r.perType[t].total = Money::fromPaisa(sum[t]);
+        if (r.perType[t].count > 0) {
+            r.perType[t].minimum = Money::fromPaisa(lo[t]);
+            r.perType[t].maximum = Money::fromPaisa(hi[t]);
+        }
+    }
+    return r;
+}
+
+// The same results from the columns with the active kernels
+static Results columnKernels(const BalanceColumns& columns) {
+    Results r;
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        AccountType type = static_cast<AccountType>(t);
+        r.perType[t] = Analytics::stats(columns.dataOf(type), columns.sizeOf(type));
+    }
+    r.below = Analytics::countBelow(columns.data(), columns.size(), THRESHOLD);
+    Analytics::histogram(columns.data(), columns.size(), EDGES, EDGE_COUNT, r.buckets);
+    return r;
+}
+
+// Best of several runs, in milliseconds
+template <typename Fn>
+double timeBest(Fn fn, int runs = 5) {
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    // Balances spread over several decades, types spread over all nine kinds
+    std::mt19937_64 gen(7);
+    std::uniform_int_distribution<int> decade(0, 8);
+    std::uniform_int_distribution<int64_t> mantissa(1, 999);
+    std::uniform_int_distribution<int> kind(0, static_cast<int>(AccountType::SALARY));
+    std::deque<Account> accounts;
+    const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+    for (size_t i = 0; i < n; ++i) {
+        int64_t balance = mantissa(gen);
+        for (int d = decade(gen); d > 0; --d) {
+            balance *= 10;
+        }
+        accounts.emplace_back(unpackAccountNumber(1000000000ULL + i), pin, Money::fromPaisa(balance),
+                              "Customer", static_cast<AccountType>(kind(gen)));
+    }
+
+    Results expected;
+    double naiveMs = timeBest([&]() { expected = naiveLoop(accounts); });
+
+    BalanceColumns columns;
+    double captureMs = timeBest([&]() { columns.capture(accounts); });
+
+    std::cout << "Accounts: " << n << "  (CPU supports " << simdLevelToString(Analytics::detectedLevel()) << ")" << std::endl;
+    std::cout << std::setw(28) << "Method" << std::setw(14) << "Time (ms)" << std::setw(12) << "Speedup" << "  Matches" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(28) << "Account objects (AoS loop)" << std::setw(14) << naiveMs << std::setw(12) << "1.00x" << "  -" << std::endl;
+    std::cout << std::setw(28) << "Capture columns (once)" << std::setw(14) << captureMs << std::setw(12) << "" << "  -" << std::endl;
+
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2}) {
+        Analytics::setLevel(level);
+        if (Analytics::activeLevel() != level) {
+            continue; // Not supported on this CPU
+        }
+        Results actual;
+        double ms = timeBest([&]() { actual = columnKernels(columns); });
+        std::string label = std::string("Columns, ") + simdLevelToString(level) + " kernels";
+        std::cout << std::setw(28) << label << std::setw(14) << ms
+                  << std::setw(11) << naiveMs / ms << "x" << "  " << (actual == expected ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
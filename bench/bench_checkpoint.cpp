@@ -0,0 +1,149 @@
+// bench/bench_checkpoint.cpp
+// Measures what a checkpoint costs the postings running next to it. Deposit
+// threads post to random accounts while the main thread checkpoints every
+// 250 ms, first with UserAuth::checkpoint() (which saves with every shard
+// locked) and then with UserAuth::checkpointInBackground() (which only locks
+// them to snapshot the balances). Prints deposit latency for each, the time
+// the checkpoint call held the caller, the snapshot memory, and checks that
+// the store reloads from its files with every deposit in place.
+// Checkpoints that fall due on their own (every CHECKPOINT_INTERVAL postings)
+// run in the background in both rounds.
+// Usage: bench_checkpoint [accounts] [threads] [checkpoints]
+//        (default: 1000000 accounts, 4 threads, 8 checkpoints per round)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "Metrics.h"
+#include "PostingEngine.h"
+#include "UserAuth.h"
+#include <algorithm>  // For std::sort, std::min, std::max
+#include <atomic>     // For std::atomic
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::strtoull
+#include <iomanip>    // For std::setw, std::setprecision
+#include <iostream>
+#include <random>     // For std::mt19937_64
+#include <sstream>    // For std::ostringstream
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int64_t INITIAL_BALANCE_PAISA = 100000; // TK. 1000.00 per account
+
+// Current value of a gauge, read from the Prometheus text output
+static int64_t gaugeValue(const std::string& name) {
+    std::ostringstream out;
+    Metrics::writePrometheus(out);
+    std::string text = out.str();
+    size_t at = text.find("\n" + name + " ");
+    return at == std::string::npos ? 0 : std::stoll(text.substr(at + name.size() + 2));
+}
+
+struct RoundResult {
+    std::vector<double> micros; // Latency of every deposit
+    double seconds = 0.0;
+    double heldMs = 0.0;        // Longest checkpoint call
+    int64_t snapshotBytes = 0;  // Largest snapshot seen while a background checkpoint was writing
+    size_t deposits = 0;
+};
+
+// Deposit TK. 1.00 to random accounts from 'threads' threads while the main
+// thread runs 'checkpoints' checkpoints, 250 ms apart
+static RoundResult runRound(const std::vector<std::string>& numbers, size_t threads, size_t checkpoints,
+                            bool background) {
+    RoundResult result;
+    std::atomic<bool> stop(false);
+    std::vector<std::vector<double>> micros(threads);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&numbers, &stop, &micros, t] {
+            std::mt19937_64 rng(t + 1);
+            std::uniform_int_distribution<size_t> pick(0, numbers.size() - 1);
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto posted = std::chrono::steady_clock::now();
+                PostingEngine::deposit(numbers[pick(rng)], Money::fromPaisa(100));
+                micros[t].push_back(
+                    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - posted).count());
+            }
+        });
+    }
+    for (size_t c = 0; c < checkpoints; ++c) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        auto called = std::chrono::steady_clock::now();
+        if (background) {
+            UserAuth::checkpointInBackground();
+        } else {
+            UserAuth::checkpoint();
+        }
+        result.heldMs = std::max(result.heldMs, std::chrono::duration<double, std::milli>(
+                                                    std::chrono::steady_clock::now() - called).count());
+        result.snapshotBytes = std::max(result.snapshotBytes, gaugeValue("bms_checkpoint_snapshot_bytes"));
+        UserAuth::waitForCheckpoint();
+    }
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& samples : micros) {
+        result.micros.insert(result.micros.end(), samples.begin(), samples.end());
+    }
+    std::sort(result.micros.begin(), result.micros.end());
+    result.deposits = result.micros.size();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t accountCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    size_t checkpoints = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8;
+    accountCount = std::max<size_t>(accountCount, 1);
+    threads = std::max<size_t>(threads, 1);
+    checkpoints = std::max<size_t>(checkpoints, 1);
+
+    std::string scratch = enterScratchDirectory("bench_checkpoint");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    std::vector<std::string> numbers;
+    numbers.reserve(accountCount);
+    const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+    for (size_t i = 0; i < accountCount; ++i) {
+        numbers.push_back(unpackAccountNumber(1000000000ULL + i));
+        UserAuth::addAccount(Account(numbers.back(), pin, Money::fromPaisa(INITIAL_BALANCE_PAISA),
+                                     "Owner " + std::to_string(i), AccountType::SAVINGS));
+    }
+    UserAuth::saveAccounts();
+    int64_t before = totalBalance();
+
+    std::cout << accountCount << " accounts, " << threads << " deposit thread(s), " << checkpoints
+              << " checkpoint(s) per round" << std::endl;
+    std::cout << std::setw(12) << "Checkpoint" << std::setw(14) << "Deposits/s" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(12) << "p99.9 us" << std::setw(12) << "max us"
+              << std::setw(12) << "Held ms" << std::setw(14) << "Snapshot MB" << std::endl;
+    size_t deposits = 0;
+    for (bool background : {false, true}) {
+        RoundResult round = runRound(numbers, threads, checkpoints, background);
+        deposits += round.deposits;
+        std::cout << std::setw(12) << (background ? "background" : "blocking") << std::fixed
+                  << std::setprecision(0) << std::setw(14) << round.deposits / round.seconds
+                  << std::setprecision(1) << std::setw(10) << percentile(round.micros, 50) << std::setw(10)
+                  << percentile(round.micros, 99) << std::setw(12) << percentile(round.micros, 99.9)
+                  << std::setw(12) << round.micros.back() << std::setw(12) << round.heldMs << std::setw(14)
+                  << round.snapshotBytes / (1024.0 * 1024.0) << std::defaultfloat << std::endl;
+    }
+
+    // Whatever the last background checkpoint left in the shard files and
+    // the journal must add up to every deposit made
+    int64_t expected = before + 100 * static_cast<int64_t>(deposits);
+    bool consistent = totalBalance() == expected;
+    UserAuth::loadAccounts();
+    bool recovered = totalBalance() == expected;
+    std::cout << "Balances consistent: " << (consistent ? "yes" : "NO")
+              << "; reloaded from disk: " << (recovered ? "yes" : "NO") << std::endl;
+
+    leaveScratchDirectory(scratch);
+    return consistent && recovered ? 0 : 1;
+}
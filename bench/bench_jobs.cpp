@@ -0,0 +1,126 @@
+// bench/bench_jobs.cpp
+// Times the month-end batch jobs (JobEngine::monthEndRules) over a store of
+// N accounts spread evenly over the account types, and checks that every
+// run moves the total balance by exactly what it reports as credited and
+// debited. For comparison, the same rules are first posted the way they
+// would be scripted without the engine, one PostingEngine::deposit, withdraw
+// or transfer call per change, over the first 100000 accounts. Every
+// recurring deposit account is funded from the account numbered just before it.
+// Usage: bench_jobs [accounts] [runs]
+//        (default: 1000000 accounts, 3 runs)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "JobEngine.h"
+#include "PostingEngine.h"
+#include "UserAuth.h"
+#include <algorithm>  // For std::min
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::strtoull
+#include <iomanip>    // For std::setprecision
+#include <iostream>
+#include <random>     // For std::mt19937_64
+#include <string>
+#include <vector>
+
+static const size_t SCRIPTED_ACCOUNTS = 100000;
+
+// Post the rules to one account with separate calls, as a script would; returns the postings made
+static size_t postScripted(const std::string& number, const std::string& funding, AccountType type,
+                           const std::vector<JobRule>& rules) {
+    size_t postings = 0;
+    for (const auto& rule : rules) {
+        if (rule.type != type) {
+            continue;
+        }
+        Money balance;
+        PostingEngine::getBalance(number, balance);
+        int64_t interest = balance.toPaisa() / 120000 * rule.annualRateBasisPoints +
+                           balance.toPaisa() % 120000 * rule.annualRateBasisPoints / 120000;
+        if (interest > 0) {
+            postings += PostingEngine::deposit(number, Money::fromPaisa(interest)) == PostingResult::SUCCESS;
+        }
+        if (rule.installment > Money()) {
+            postings += 2 * (PostingEngine::transfer(funding, number, rule.installment) == PostingResult::SUCCESS);
+        } else if (rule.installment < Money()) {
+            Money amount;
+            Money().subtract(rule.installment, amount);
+            postings += PostingEngine::withdraw(number, amount) == PostingResult::SUCCESS;
+        }
+    }
+    return postings;
+}
+
+int main(int argc, char* argv[]) {
+    size_t accountCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t runs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3;
+    accountCount = std::max<size_t>(accountCount, 1);
+    runs = std::max<size_t>(runs, 1);
+
+    std::string scratch = enterScratchDirectory("bench_jobs");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    // Balances between TK. 0 and TK. 10000, types in turn (UNKNOWN excluded)
+    std::vector<std::string> numbers;
+    numbers.reserve(std::min(accountCount, SCRIPTED_ACCOUNTS));
+    const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> balance(0, 10000 * 100);
+    auto setupStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < accountCount; ++i) {
+        std::string number = unpackAccountNumber(1000000000ULL + i);
+        AccountType type = static_cast<AccountType>(i % (ACCOUNT_TYPE_COUNT - 1));
+        Account account(number, pin, Money::fromPaisa(balance(rng)), "Owner " + std::to_string(i), type);
+        if (type == AccountType::RECURRING_DEPOSIT) {
+            account.setFundingAccountKey(1000000000ULL + i - 1);
+        }
+        UserAuth::addAccount(account);
+        if (i < SCRIPTED_ACCOUNTS) {
+            numbers.push_back(number);
+        }
+    }
+    UserAuth::saveAccounts();
+    std::cout << accountCount << " accounts set up in " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count() << " s"
+              << std::defaultfloat << std::endl;
+
+    std::vector<JobRule> rules = JobEngine::monthEndRules();
+    bool ok = true;
+
+    // Without the engine: one call per change
+    auto scriptedStart = std::chrono::steady_clock::now();
+    size_t scriptedPostings = 0;
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        std::string funding = i > 0 ? numbers[i - 1] : std::string();
+        scriptedPostings +=
+            postScripted(numbers[i], funding, static_cast<AccountType>(i % (ACCOUNT_TYPE_COUNT - 1)), rules);
+    }
+    double scriptedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scriptedStart).count();
+    std::cout << std::fixed << std::setprecision(0) << "Separate calls: " << scriptedPostings << " posting(s) over "
+              << numbers.size() << " accounts, " << scriptedPostings / scriptedSeconds << " postings/s"
+              << std::defaultfloat << std::endl;
+
+    for (size_t r = 0; r < runs; ++r) {
+        int64_t before = totalBalance();
+        JobSummary summary;
+        uint32_t period = 202601 + static_cast<uint32_t>(r / 12 * 100 + r % 12); // A new month each run
+        ok = JobEngine::run(rules, period, summary) && ok;
+        Money credited, debited;
+        for (const auto& totals : summary.byType) {
+            credited.add(totals.credited, credited);
+            debited.add(totals.debited, debited);
+        }
+        bool balanced = totalBalance() == before + credited.toPaisa() - debited.toPaisa();
+        ok = ok && balanced;
+        std::cout << "\nRun " << r + 1 << ": " << std::fixed << std::setprecision(0)
+                  << summary.postings / summary.seconds << " postings/s, balances add up: "
+                  << (balanced ? "yes" : "NO") << std::defaultfloat << std::endl;
+        JobEngine::printSummary(summary);
+    }
+    UserAuth::waitForCheckpoint();
+
+    leaveScratchDirectory(scratch);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// bench/bench_logger.cpp
+// Benchmark: transaction logging throughput, per-call ofstream vs TransactionLogger,
+// and the cost of stamping each transaction with the current time.
+// Usage: bench_logger [rows] [directory]   (default: 200000 rows in /tmp)
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "Transaction.h"
+#include "TransactionLogger.h"
+#include "Utility.h"  // For currentTimestamp, formatTimestamp, formatDateTime
+#include <chrono>   // For std::chrono::steady_clock
+#include <cstdio>   // For std::remove
+#include <cstdlib>  // For std::strtoull
+#include <ctime>    // For std::localtime
+#include <fstream>
+#include <iomanip>  // For std::fixed, std::setprecision, std::put_time
+#include <iostream>
+#include <sstream>  // For std::ostringstream
+#include <vector>
+
+// The original getCurrentDate: std::localtime, then ostringstream and put_time on every call
+static std::string legacyGetCurrentDate() {
+    std::time_t currentTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm* localTime = std::localtime(&currentTime);
+    std::ostringstream oss;
+    oss << std::put_time(localTime, "%Y-%m-%d %H:%M:%S");
+    return oss.str();
+}
+
+// The original logTransaction: open, format with iostreams, flush with endl, close
+static void legacyLogTransaction(const std::string& path, const Transaction& trans) {
+    std::ofstream ofs(path, std::ios::app);
+    ofs << unpackAccountNumber(trans.accountKey) << ","
+        << transactionTypeToString(trans.type) << ","
+        << std::fixed << std::setprecision(2) << trans.amount.toPaisa() / 100.0 << ","
+        << formatDateTime(trans.timestamp) << std::endl;
+    ofs.close();
+}
+
+// Run fn once per row and return rows per second
+template <typename Fn>
+double rowsPerSecond(const std::vector<Transaction>& rows, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& trans : rows) {
+        fn(trans);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return rows.size() / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    std::string path = dir + "/bench_logger_log.txt";
+
+    std::vector<Transaction> rows;
+    rows.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        rows.emplace_back(1000000000ULL + i % 100000, i % 2 ? TransactionType::WITHDRAWAL : TransactionType::DEPOSIT,
+                          Money::fromPaisa(i % 100000), 1752332167 + static_cast<int64_t>(i / 1000));
+    }
+
+    // Stamping: what each posting paid for its date, then and now
+    std::cout << std::left << std::setw(36) << "Timestamp" << "Calls/sec" << std::endl;
+    size_t sink = 0;
+    double legacyStamp = rowsPerSecond(rows, [&](const Transaction&) { sink += legacyGetCurrentDate().size(); });
+    std::cout << std::setw(36) << "getCurrentDate (original)" << std::fixed << std::setprecision(0) << legacyStamp << std::endl;
+    double epochStamp = rowsPerSecond(rows, [&](const Transaction&) { sink += static_cast<size_t>(currentTimestamp() & 1); });
+    std::cout << std::setw(36) << "currentTimestamp" << epochStamp << std::endl;
+    char text[TIMESTAMP_TEXT_LENGTH];
+    double cachedFormat = rowsPerSecond(rows, [&](const Transaction& t) {
+        formatTimestamp(t.timestamp, text);
+        sink += static_cast<size_t>(text[18]);
+    });
+    std::cout << std::setw(36) << "formatTimestamp (cached)" << cachedFormat << std::endl;
+    int64_t minutes = 0;
+    double uncachedFormat = rowsPerSecond(rows, [&](const Transaction& t) {
+        formatTimestamp(t.timestamp + 60 * minutes++, text); // A new minute on every call: always re-rendered
+        sink += static_cast<size_t>(text[18]);
+    });
+    std::cout << std::setw(36) << "formatTimestamp (uncached)" << uncachedFormat << std::endl;
+    if (sink == 0) {
+        std::cout << std::endl; // Keeps the loops from being optimized away
+    }
+    std::cout << std::endl;
+
+    std::cout << std::left << std::setw(36) << "Logger" << "Rows/sec" << std::endl;
+
+    std::remove(path.c_str());
+    double legacy = rowsPerSecond(rows, [&](const Transaction& t) { legacyLogTransaction(path, t); });
+    std::cout << std::setw(36) << "ofstream per call (original)" << std::fixed << std::setprecision(0) << legacy << std::endl;
+
+    // Group-commit configurations; the statement index is left out to isolate the writer
+    struct Config {
+        const char* name;
+        size_t records;
+        bool sync;
+    };
+    const Config configs[] = {
+        {"TransactionLogger N=1", 1, false},
+        {"TransactionLogger N=256", 256, false},
+        {"TransactionLogger N=4096", 4096, false},
+        {"TransactionLogger N=4096 fdatasync", 4096, true},
+    };
+    for (const auto& config : configs) {
+        std::remove(path.c_str());
+        LoggerPolicy policy;
+        policy.flushEveryRecords = config.records;
+        policy.syncOnFlush = config.sync;
+        double rate;
+        {
+            TransactionLogger logger(path, policy, nullptr);
+            rate = rowsPerSecond(rows, [&](const Transaction& t) { logger.append(t); });
+            logger.flush();
+        }
+        std::cout << std::setw(36) << config.name << rate << std::endl;
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,95 @@
+// bench/bench_login.cpp
+// Benchmark: login throughput at each PIN hashing cost, to choose a cost
+// that is as slow as latency allows. For every iteration count it times a
+// full KDF check (a login without a session), the same from all hardware
+// threads at once, and a repeat login answered from the session cache. A
+// wrong PIN must fail on both paths.
+// Usage: bench_login [iterations...]   (default: 1000 10000 100000 600000)
+#include "Account.h"
+#include "BenchUtil.h"
+#include "PinHash.h"
+#include <algorithm> // For std::max
+#include <atomic>    // For std::atomic
+#include <chrono>    // For std::chrono::steady_clock
+#include <cstdlib>   // For std::strtoull
+#include <iomanip>   // For std::setw, std::setprecision
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static const double SECONDS_PER_MEASUREMENT = 0.5;
+
+// Calls per second of check, run for about SECONDS_PER_MEASUREMENT on each of threads threads
+template <typename Check>
+double callsPerSecond(size_t threads, Check check) {
+    std::atomic<size_t> calls(0);
+    std::atomic<bool> failed(false);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            size_t mine = 0;
+            auto begin = std::chrono::steady_clock::now();
+            do {
+                if (!check(t, mine)) {
+                    failed = true;
+                }
+                ++mine;
+            } while (secondsSince(begin) < SECONDS_PER_MEASUREMENT);
+            calls += mine;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (failed) {
+        std::cerr << "Error: A correct PIN was rejected." << std::endl;
+        return 0.0;
+    }
+    return calls / secondsSince(start);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<uint32_t> costs;
+    for (int i = 1; i < argc; ++i) {
+        costs.push_back(static_cast<uint32_t>(std::strtoull(argv[i], nullptr, 10)));
+    }
+    if (costs.empty()) {
+        costs = {1000, 10000, 100000, 600000};
+    }
+    size_t threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+
+    std::cout << std::left << std::setw(12) << "Iterations" << std::setw(14) << "Hash (ms)"
+              << std::setw(18) << "KDF logins/sec" << std::setw(26) << ("KDF logins/sec, " + std::to_string(threads) + " thr")
+              << std::setw(20) << "Session logins/sec" << std::endl;
+    bool ok = true;
+    for (uint32_t cost : costs) {
+        PinHash::setIterations(cost);
+
+        // Hashing a PIN (registration) costs the same as one KDF check
+        auto t = std::chrono::steady_clock::now();
+        std::vector<Account> accounts;
+        for (size_t i = 0; i < threads; ++i) {
+            accounts.emplace_back(std::to_string(1000000000ULL + i), "1234", Money(), "Customer", AccountType::SAVINGS);
+        }
+        double hashMs = secondsSince(t) * 1000.0 / threads;
+
+        double kdf = callsPerSecond(1, [&](size_t, size_t) {
+            return PinHash::verify(accounts[0].getPinCredential(), "1234");
+        });
+        double kdfParallel = callsPerSecond(threads, [&](size_t thread, size_t) {
+            return PinHash::verify(accounts[thread].getPinCredential(), "1234");
+        });
+        accounts[0].authenticate("1234"); // Start the session
+        double cached = callsPerSecond(1, [&](size_t, size_t) {
+            return accounts[0].authenticate("1234");
+        });
+
+        bool rejects = !accounts[0].authenticate("4321") && !PinHash::verify(accounts[0].getPinCredential(), "4321");
+        ok = ok && rejects && kdf > 0.0 && kdfParallel > 0.0 && cached > 0.0;
+        std::cout << std::setw(12) << cost << std::fixed << std::setprecision(3) << std::setw(14) << hashMs
+                  << std::setprecision(0) << std::setw(18) << kdf << std::setw(26) << kdfParallel
+                  << std::setw(20) << cached << (rejects ? "" : "  WRONG PIN ACCEPTED") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// bench/bench_lookup.cpp
+// Microbenchmark: account lookup latency, linear vector scan vs AccountIndex.
+// Usage: bench_lookup [size ...]   (default sizes: 10000 1000000 10000000)
+#include "Account.h"
+#include "AccountIndex.h"
+#include <algorithm> // For std::find_if
+#include <chrono>    // For std::chrono::steady_clock
+#include <cstdlib>   // For std::strtoull
+#include <iostream>
+#include <iomanip>   // For std::setw, std::setprecision
+#include <random>    // For std::mt19937_64
+#include <vector>
+
+// Time a batch of lookups and return the average nanoseconds per lookup
+template <typename LookupFn>
+double timeLookups(const std::vector<std::string>& probes, LookupFn lookup) {
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& accNum : probes) {
+        if (lookup(accNum)) {
+            ++found;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (found != probes.size()) {
+        std::cerr << "Warning: " << probes.size() - found << " lookups missed." << std::endl;
+    }
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / probes.size();
+}
+
+void runSize(size_t n) {
+    std::mt19937_64 gen(42);
+
+    // Build n accounts with distinct sequential-looking numbers
+    std::vector<Account> accounts;
+    accounts.reserve(n); // No reallocation afterwards, so pointers stay valid
+    const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+    for (size_t i = 0; i < n; ++i) {
+        accounts.emplace_back(unpackAccountNumber(1000000000ULL + i * 7), pin, Money::fromPaisa(10000),
+                              "Owner " + std::to_string(i), AccountType::SAVINGS);
+    }
+
+    AccountIndex index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        index.insert(accounts[i].getAccountKey(), &accounts[i], i);
+    }
+
+    // The linear scan is O(n) per lookup, so sample fewer probes for large n
+    size_t scanProbes = std::max<size_t>(10, std::min<size_t>(10000, 50000000 / n));
+    size_t indexProbes = 1000000;
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < std::max(scanProbes, indexProbes); ++i) {
+        probes.push_back(accounts[pick(gen)].getAccountNumber());
+    }
+
+    std::vector<std::string> scanSet(probes.begin(), probes.begin() + scanProbes);
+    double scanNs = timeLookups(scanSet, [&](const std::string& accNum) {
+        uint64_t key;
+        packAccountNumber(accNum, key);
+        auto it = std::find_if(accounts.begin(), accounts.end(),
+                               [&](const Account& acc) { return acc.getAccountKey() == key; });
+        return it != accounts.end();
+    });
+
+    std::vector<std::string> indexSet(probes.begin(), probes.begin() + indexProbes);
+    double indexNs = timeLookups(indexSet, [&](const std::string& accNum) {
+        uint64_t key;
+        return packAccountNumber(accNum, key) && index.find(key) != nullptr;
+    });
+
+    std::cout << std::setw(10) << n
+              << std::setw(18) << std::fixed << std::setprecision(1) << scanNs
+              << std::setw(18) << indexNs
+              << std::setw(12) << std::setprecision(0) << scanNs / indexNs << "x" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = {10000, 1000000, 10000000};
+    }
+
+    std::cout << std::setw(10) << "Accounts"
+              << std::setw(18) << "Scan (ns/op)"
+              << std::setw(18) << "Index (ns/op)"
+              << std::setw(13) << "Speedup" << std::endl;
+    for (size_t n : sizes) {
+        if (n > 0) {
+            runSize(n);
+        }
+    }
+    return 0;
+}
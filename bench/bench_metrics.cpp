@@ -0,0 +1,97 @@
+// bench/bench_metrics.cpp
+// Benchmark: cost of recording metrics on a hot path. Times a counter
+// increment, a histogram record, a sampled and an unsampled ScopedTimer,
+// and counter increments from several threads at once (per-thread shards
+// should keep the per-event cost flat as threads are added).
+// Usage: bench_metrics [events] [maxThreads]   (default: 50000000 events, all hardware threads)
+#include "Metrics.h"
+#include <algorithm> // For std::max
+#include <chrono>    // For std::chrono::steady_clock
+#include <cstdlib>   // For std::strtoull
+#include <iomanip>   // For std::setw, std::setprecision
+#include <iostream>
+#include <sstream>   // For std::ostringstream
+#include <thread>
+#include <vector>
+
+static const Counter events("bench_events_total", "Events recorded by the benchmark");
+static const Histogram eventTicks("bench_event_seconds", "Synthetic durations");
+static const Histogram timedAlways("bench_timed_seconds", "Every scope timed");
+static const Histogram timedSampled("bench_sampled_seconds", "One scope in 16 timed", 16);
+
+static double nanosPerEvent(std::chrono::steady_clock::time_point start, size_t n) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+static void printRow(const char* name, double nanos) {
+    std::cout << std::setw(32) << std::left << name << std::fixed << std::setprecision(2) << nanos << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000000;
+    size_t maxThreads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    n = std::max<size_t>(n, 1);
+    maxThreads = std::max<size_t>(maxThreads, 1);
+
+    std::cout << std::setw(32) << std::left << "Event" << "ns/event" << std::endl;
+    events.add(); // Attach this thread's shard outside the timed loops
+
+    auto t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        events.add();
+    }
+    printRow("Counter add", nanosPerEvent(t, n));
+
+    t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        eventTicks.record(i & 0xFFFF);
+    }
+    printRow("Histogram record", nanosPerEvent(t, n));
+
+    size_t timedEvents = n / 10;
+    t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < timedEvents; ++i) {
+        ScopedTimer timer(timedAlways);
+    }
+    printRow("ScopedTimer (every event)", nanosPerEvent(t, timedEvents));
+
+    t = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < timedEvents; ++i) {
+        ScopedTimer timer(timedSampled);
+    }
+    printRow("ScopedTimer (1 in 16)", nanosPerEvent(t, timedEvents));
+
+    // Same total work split across threads; per-thread shards mean no cache line is shared
+    for (size_t threads = 2; threads <= maxThreads; threads *= 2) {
+        size_t perThread = n / threads;
+        t = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < threads; ++w) {
+            workers.emplace_back([perThread]() {
+                for (size_t i = 0; i < perThread; ++i) {
+                    events.add();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::string label = "Counter add, " + std::to_string(threads) + " threads";
+        printRow(label.c_str(), nanosPerEvent(t, perThread)); // Wall time per event on each thread
+    }
+
+    // Exited threads must have been folded into the totals
+    std::ostringstream json;
+    Metrics::writeJson(json);
+    uint64_t expected = 1 + n; // The warmup add, then the single-thread loop
+    for (size_t threads = 2; threads <= maxThreads; threads *= 2) {
+        expected += (n / threads) * threads;
+    }
+    std::string line = "\"bench_events_total\": " + std::to_string(expected);
+    if (json.str().find(line) == std::string::npos) {
+        std::cerr << "Error: Counter total does not match; expected " << expected << "." << std::endl;
+        return 1;
+    }
+    std::cout << "Counter total: " << expected << " (matches)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+// bench/bench_posting.cpp
+// Stress test and benchmark for PostingEngine: random deposits, withdrawals and
+// transfers from 1..N threads, then one settlement batch, checking that no
+// money is created or destroyed.
+// Usage: bench_posting [accounts] [postsPerThread] [maxThreads]
+//        (default: 100000 accounts, 100000 posts per thread, all hardware threads)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "PostingEngine.h"
+#include "UserAuth.h"
+#include <atomic>     // For std::atomic
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstdlib>    // For std::strtoull
+#include <iomanip>    // For std::setw, std::setprecision
+#include <iostream>
+#include <random>     // For std::mt19937_64
+#include <thread>
+#include <vector>
+
+static const int64_t INITIAL_BALANCE_PAISA = 100000; // TK. 1000.00 per account
+
+int main(int argc, char* argv[]) {
+    size_t accountCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t postsPerThread = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    size_t maxThreads = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : std::thread::hardware_concurrency();
+    if (accountCount < 2 || maxThreads == 0) {
+        accountCount = std::max<size_t>(accountCount, 2);
+        maxThreads = std::max<size_t>(maxThreads, 1);
+    }
+
+    std::string scratch = enterScratchDirectory("bench_posting");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    std::vector<std::string> numbers;
+    numbers.reserve(accountCount);
+    const PinCredential pin = PinHash::hash("1234"); // Hashed once; the KDF is not what this measures
+    for (size_t i = 0; i < accountCount; ++i) {
+        numbers.push_back(unpackAccountNumber(1000000000ULL + i));
+        UserAuth::addAccount(Account(numbers.back(), pin, Money::fromPaisa(INITIAL_BALANCE_PAISA),
+                                     "Owner " + std::to_string(i), AccountType::SAVINGS));
+    }
+    UserAuth::saveAccounts();
+
+    std::cout << std::setw(8) << "Threads" << std::setw(16) << "Posts/sec"
+              << std::setw(12) << "Scaling" << "  Invariant" << std::endl;
+
+    // Powers of two up to maxThreads, always ending with maxThreads itself
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0.0;
+    bool allConserved = true;
+    for (size_t threads : threadCounts) {
+        int64_t before = totalBalance();
+        std::atomic<int64_t> netDeposited(0); // Deposits minus withdrawals that succeeded
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::mt19937_64 gen(1000 + t);
+                std::uniform_int_distribution<size_t> pick(0, accountCount - 1);
+                std::uniform_int_distribution<int64_t> amount(1, 20000);
+                int64_t net = 0;
+                for (size_t i = 0; i < postsPerThread; ++i) {
+                    const std::string& a = numbers[pick(gen)];
+                    Money m = Money::fromPaisa(amount(gen));
+                    switch (i % 4) {
+                        case 0:
+                            if (PostingEngine::deposit(a, m) == PostingResult::SUCCESS) net += m.toPaisa();
+                            break;
+                        case 1:
+                            if (PostingEngine::withdraw(a, m) == PostingResult::SUCCESS) net -= m.toPaisa();
+                            break;
+                        default:
+                            PostingEngine::transfer(a, numbers[pick(gen)], m);
+                            break;
+                    }
+                }
+                netDeposited += net;
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double rate = threads * postsPerThread / std::chrono::duration<double>(end - start).count();
+        if (threads == 1) {
+            baseline = rate;
+        }
+        bool conserved = totalBalance() == before + netDeposited.load();
+        allConserved = allConserved && conserved;
+        std::cout << std::setw(8) << threads
+                  << std::setw(16) << std::fixed << std::setprecision(0) << rate
+                  << std::setw(11) << std::setprecision(2) << rate / baseline << "x"
+                  << "  " << (conserved ? "OK" : "VIOLATED") << std::endl;
+    }
+
+    // Batch settlement: one pass, one journal commit per batch
+    const size_t batchSize = 10000;
+    std::mt19937_64 gen(7);
+    std::uniform_int_distribution<size_t> pick(0, accountCount - 1);
+    std::vector<TransferRequest> batch;
+    for (size_t i = 0; i < batchSize; ++i) {
+        size_t from = pick(gen);
+        size_t to = (from + 1 + pick(gen) % (accountCount - 1)) % accountCount;
+        batch.emplace_back(numbers[from], numbers[to], Money::fromPaisa(100 + i % 5000));
+    }
+    int64_t before = totalBalance();
+    std::vector<PostingResult> results;
+    auto start = std::chrono::steady_clock::now();
+    size_t settled = PostingEngine::settleBatch(batch, results);
+    auto end = std::chrono::steady_clock::now();
+    bool conserved = totalBalance() == before;
+    allConserved = allConserved && conserved;
+    std::cout << "\nsettleBatch: " << settled << "/" << batchSize << " transfers, "
+              << std::setprecision(0) << batchSize / std::chrono::duration<double>(end - start).count()
+              << " transfers/sec  " << (conserved ? "OK" : "VIOLATED") << std::endl;
+
+    leaveScratchDirectory(scratch);
+    return allConserved ? 0 : 1;
+}
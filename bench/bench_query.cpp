@@ -0,0 +1,195 @@
+// bench/bench_query.cpp
+// Times filtered queries over a transaction log holding many days of
+// history, one sealed segment per day plus the active log. Each audit query
+// (findTransactions) is compared with a full scan that decodes every block
+// and filters every row, and must return exactly the same rows; the block
+// counts show how many blocks the RowRange summaries let it skip. Account
+// statements for the last 30 days are compared with the whole history.
+// Usage: bench_query [days] [rowsPerDay] [repeats]
+//        (default: 60 days, 50000 rows per day, 5 repeats)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "LogSegments.h"
+#include "Metrics.h"
+#include "Transaction.h"
+#include "TransactionLogReader.h"
+#include "Utility.h"      // For currentTimestamp, formatDateTime
+#include <algorithm>      // For std::stable_sort, std::max
+#include <chrono>         // For std::chrono::steady_clock
+#include <cstdlib>        // For std::strtoull
+#include <cstring>        // For std::memcmp
+#include <iomanip>        // For std::setw, std::setprecision
+#include <iostream>
+#include <shared_mutex>   // For std::shared_lock
+#include <sstream>        // For std::ostringstream
+#include <string>
+#include <vector>
+
+static const size_t ACCOUNTS = 10000;
+static const size_t LARGE_EVERY = 100000; // One row in this many is a large amount
+
+// Current value of a counter, read from the Prometheus export
+static uint64_t counterValue(const std::string& name) {
+    std::ostringstream out;
+    Metrics::writePrometheus(out);
+    std::string text = out.str();
+    size_t at = text.find("\n" + name + " ");
+    return at == std::string::npos ? 0 : std::strtoull(text.c_str() + at + name.size() + 2, nullptr, 10);
+}
+
+static uint64_t blocksRead() {
+    return counterValue("bms_segment_blocks_decoded_total") + counterValue("bms_log_blocks_scanned_total");
+}
+
+static uint64_t blocksSkipped() {
+    return counterValue("bms_segment_blocks_skipped_total") + counterValue("bms_log_blocks_skipped_total");
+}
+
+// The query answered without summaries: decode every sealed block and read
+// the whole active log, filtering row by row
+static std::vector<Transaction> fullScan(LogSegments& segments, const RowFilter& filter) {
+    std::vector<Transaction> rows;
+    std::shared_lock<std::shared_mutex> reading = segments.lockForReading();
+    segments.forEachRow([&](const Transaction& trans) {
+        if (filter.matches(trans)) {
+            rows.push_back(trans);
+        }
+        return true;
+    });
+    TransactionLogReader log;
+    if (log.open("data/logs.dat")) {
+        for (const Transaction& trans : log) {
+            if (filter.matches(trans)) {
+                rows.push_back(trans);
+            }
+        }
+    }
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Transaction& a, const Transaction& b) { return a.timestamp < b.timestamp; });
+    return rows;
+}
+
+static bool sameRows(const std::vector<Transaction>& a, const std::vector<Transaction>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(Transaction)) == 0);
+}
+
+// Time one audit query both ways and check that they agree
+static bool compare(const char* name, const StatementQuery& query, LogSegments& segments, size_t repeats) {
+    RowFilter filter;
+    compileQuery("", query, filter);
+    std::vector<Transaction> indexed;
+    uint64_t readBefore = blocksRead();
+    uint64_t skippedBefore = blocksSkipped();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r) {
+        indexed = findTransactions(query);
+    }
+    double indexedMs = millisecondsSince(start) / repeats;
+    uint64_t read = (blocksRead() - readBefore) / repeats;
+    uint64_t skipped = (blocksSkipped() - skippedBefore) / repeats;
+
+    std::vector<Transaction> scanned;
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r) {
+        scanned = fullScan(segments, filter);
+        if (query.pageSize != 0 && scanned.size() > query.pageSize) {
+            scanned.erase(scanned.begin(), scanned.end() - query.pageSize); // The newest page
+        }
+    }
+    double scanMs = millisecondsSince(start) / repeats;
+
+    bool same = sameRows(indexed, scanned);
+    std::cout << std::left << std::setw(26) << name << std::setw(10) << indexed.size() << std::setw(16)
+              << (std::to_string(read) + "/" + std::to_string(read + skipped)) << std::fixed << std::setprecision(2)
+              << std::setw(14) << indexedMs << std::setw(14) << scanMs << std::setprecision(1)
+              << scanMs / std::max(indexedMs, 0.001) << "x" << (same ? "" : "  MISMATCH") << std::defaultfloat
+              << std::endl;
+    return same;
+}
+
+// Average time of an account statement query
+static double statementMs(const std::string& number, const StatementQuery& query, size_t repeats, size_t& found) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r) {
+        found = findStatementRows(number, query).size();
+    }
+    return millisecondsSince(start) / repeats;
+}
+
+int main(int argc, char* argv[]) {
+    size_t days = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 60;
+    size_t rowsPerDay = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50000;
+    size_t repeats = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 5;
+    days = std::max<size_t>(days, 31);
+    rowsPerDay = std::max<size_t>(rowsPerDay, 1);
+    repeats = std::max<size_t>(repeats, 1);
+
+    std::string scratch = enterScratchDirectory("bench_query");
+    if (scratch.empty()) {
+        return 1;
+    }
+
+    // One batch of rows per day, oldest first, spread evenly over the day;
+    // each new day closes the previous day's segment
+    const int64_t today = currentTimestamp() / 86400 * 86400;
+    const int64_t firstDay = today - static_cast<int64_t>(days) * 86400;
+    auto setupStart = std::chrono::steady_clock::now();
+    std::vector<Transaction> batch(rowsPerDay);
+    size_t row = 0;
+    for (size_t d = 0; d < days; ++d) {
+        for (size_t i = 0; i < rowsPerDay; ++i, ++row) {
+            int64_t paisa = row % LARGE_EVERY == LARGE_EVERY / 2 ? 1000000 * 100 : static_cast<int64_t>(row % 500000) + 100;
+            batch[i] = Transaction(1000000000ULL + (row * 7919) % ACCOUNTS, static_cast<TransactionType>(1 + row % 4),
+                                   Money::fromPaisa(paisa),
+                                   firstDay + static_cast<int64_t>(d) * 86400 + static_cast<int64_t>(i * 86400 / rowsPerDay));
+        }
+        logTransactions(batch.data(), batch.size());
+    }
+    findTransactions(StatementQuery()); // Waits for the last seals
+    std::cout << days * rowsPerDay << " rows over " << days << " days logged and sealed in " << std::fixed
+              << std::setprecision(1) << millisecondsSince(setupStart) / 1000.0 << " s" << std::defaultfloat
+              << std::endl;
+
+    // A second view of the same segments for the full scans; every segment is sealed by now
+    LogSegments segments("data/logs.dat", "data/logs", SegmentPolicy());
+    segments.open();
+
+    bool ok = true;
+    std::string lastDay = formatDateTime(today - 86400).substr(0, 10);
+    std::string weekStart = formatDateTime(firstDay + 20 * 86400).substr(0, 10);
+    std::string weekEnd = formatDateTime(firstDay + 26 * 86400).substr(0, 10);
+
+    std::cout << "\n" << std::left << std::setw(26) << "Audit query" << std::setw(10) << "Rows" << std::setw(16)
+              << "Blocks read" << std::setw(14) << "Query (ms)" << std::setw(14) << "Scan (ms)" << "Speedup" << std::endl;
+    StatementQuery query;
+    query.fromDate = lastDay;
+    ok = compare("Last day", query, segments, repeats) && ok;
+    query = StatementQuery();
+    query.fromDate = weekStart;
+    query.toDate = weekEnd;
+    ok = compare("One week, mid-history", query, segments, repeats) && ok;
+    query.types = transactionTypeBit(TransactionType::TRANSFER_OUT);
+    ok = compare("Same week, transfers out", query, segments, repeats) && ok;
+    query = StatementQuery();
+    query.minAmount = Money::fromPaisa(500000 * 100);
+    ok = compare("Amount >= TK. 500000", query, segments, repeats) && ok;
+    query = StatementQuery();
+    query.pageSize = 100;
+    ok = compare("Newest 100, no bounds", query, segments, repeats) && ok;
+
+    // Statements of one account: the last 30 days against its whole history
+    std::string number = unpackAccountNumber(1000000000ULL + 42);
+    StatementQuery recent;
+    recent.fromDate = formatDateTime(today - 30 * 86400).substr(0, 10);
+    size_t recentRows = 0;
+    size_t allRows = 0;
+    double recentMs = statementMs(number, recent, repeats * 20, recentRows);
+    double allMs = statementMs(number, StatementQuery(), repeats * 20, allRows);
+    std::cout << "\nStatement of " << number << ": last 30 days " << recentRows << " rows in " << std::fixed
+              << std::setprecision(3) << recentMs << " ms, whole history " << allRows << " rows in " << allMs << " ms"
+              << std::defaultfloat << std::endl;
+
+    leaveScratchDirectory(scratch);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// bench/bench_records.cpp
+// Benchmark: filtering the transaction log by account, CSV rows split with
+// getline (the original reader) vs Transaction records read in place from a
+// mapping. A plain sum over the same mapped bytes gives the memory-bandwidth
+// ceiling the record scan should approach.
+// Usage: bench_records [rows] [directory]   (default: 4000000 rows in /tmp)
+#include "AccountIndex.h"          // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "Transaction.h"
+#include "TransactionLogReader.h"
+#include "TransactionLogger.h"
+#include "Utility.h"               // For formatDateTime
+#include <chrono>   // For std::chrono::steady_clock
+#include <cstdio>   // For std::remove
+#include <cstdlib>  // For std::strtoull
+#include <fstream>
+#include <iomanip>  // For std::setw, std::setprecision
+#include <iostream>
+#include <sstream>  // For std::stringstream
+
+static const uint64_t ACCOUNTS = 10000;
+
+// The original statement reader's row split
+static bool parseLogRow(const std::string& line, std::string& accNum, std::string& type,
+                        std::string& amountStr, std::string& date) {
+    std::stringstream ss(line);
+    return std::getline(ss, accNum, ',') &&
+           std::getline(ss, type, ',') &&
+           std::getline(ss, amountStr, ',') &&
+           std::getline(ss, date);
+}
+
+static void printRow(const char* name, size_t rows, uint64_t bytes, double seconds, size_t matches) {
+    std::cout << std::setw(28) << name << std::setw(14) << std::fixed << std::setprecision(0) << rows / seconds
+              << std::setw(12) << std::setprecision(2) << bytes / seconds / 1e9
+              << std::setw(10) << matches << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    std::string csvPath = dir + "/bench_records.csv";
+    std::string binaryPath = dir + "/bench_records.dat";
+    std::remove(binaryPath.c_str());
+
+    // The same rows in both formats
+    {
+        std::ofstream csv(csvPath, std::ios::binary | std::ios::trunc);
+        LoggerPolicy policy;
+        policy.flushInterval = std::chrono::milliseconds(0);
+        policy.flushEveryRecords = 4096;
+        TransactionLogger logger(binaryPath, policy, nullptr);
+        for (size_t i = 0; i < n; ++i) {
+            Transaction trans(1000000000ULL + (i * 7919) % ACCOUNTS, static_cast<TransactionType>(1 + i % 4),
+                              Money::fromPaisa(static_cast<int64_t>(i % 1000000)), 1735689600 + static_cast<int64_t>(i));
+            logger.append(trans);
+            csv << unpackAccountNumber(trans.accountKey) << ',' << transactionTypeToString(trans.type) << ','
+                << trans.amount << ',' << formatDateTime(trans.timestamp) << '\n';
+        }
+    }
+    uint64_t wanted = 1000000000ULL + 4242;
+    std::string wantedNumber = unpackAccountNumber(wanted);
+
+    std::cout << "Filtering " << n << " rows for one of " << ACCOUNTS << " accounts" << std::endl;
+    std::cout << std::left << std::setw(28) << "Reader" << std::setw(14) << "Rows/sec"
+              << std::setw(12) << "GB/s" << std::setw(10) << "Matches" << std::endl;
+
+    // Original: getline each row, split it into strings, compare the account text
+    uint64_t csvBytes = 0;
+    size_t csvMatches = 0;
+    auto t = std::chrono::steady_clock::now();
+    {
+        std::ifstream ifs(csvPath, std::ios::binary);
+        std::string line, accNum, type, amountStr, date;
+        while (std::getline(ifs, line)) {
+            csvBytes += line.size() + 1;
+            if (parseLogRow(line, accNum, type, amountStr, date) && accNum == wantedNumber) {
+                ++csvMatches;
+            }
+        }
+    }
+    printRow("CSV getline + split", n, csvBytes, secondsSince(t), csvMatches);
+
+    // Records in place: one integer compare per row, no copies
+    TransactionLogReader reader;
+    if (!reader.open(binaryPath)) {
+        std::cerr << "Error: Could not map " << binaryPath << "." << std::endl;
+        return 1;
+    }
+    uint64_t recordBytes = reader.size() * sizeof(Transaction);
+    size_t warm = 0;
+    for (const Transaction& trans : reader) {
+        warm += trans.accountKey == wanted; // Fault the pages in, so both scans below read memory
+    }
+    t = std::chrono::steady_clock::now();
+    size_t recordMatches = 0;
+    for (const Transaction& trans : reader) {
+        recordMatches += trans.accountKey == wanted;
+    }
+    printRow("Mapped records", reader.size(), recordBytes, secondsSince(t), recordMatches);
+
+    // Ceiling: sum every 8-byte word of the same records
+    t = std::chrono::steady_clock::now();
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(reader.begin());
+    uint64_t sum = 0;
+    for (size_t i = 0; i < recordBytes / sizeof(uint64_t); ++i) {
+        sum += words[i];
+    }
+    printRow("Memory read (reference)", reader.size(), recordBytes, secondsSince(t), sum == 0 ? 0 : warm);
+
+    std::cout << "CSV " << csvBytes << " bytes, records " << recordBytes << " bytes" << std::endl;
+    reader.close();
+    std::remove(csvPath.c_str());
+    std::remove(binaryPath.c_str());
+    if (csvMatches != recordMatches) {
+        std::cerr << "Error: Readers disagree." << std::endl;
+        return 1;
+    }
+    return 0;
+}
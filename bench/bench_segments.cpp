@@ -0,0 +1,181 @@
+// bench/bench_segments.cpp
+// Benchmark: transaction log segmentation. Shows that append throughput and
+// recent-statement latency stay flat as sealed history grows, and compares
+// the size of a CSV segment with its RAW and VARINT sealed forms.
+// Usage: bench_segments [rows] [segmentMiB] [directory]   (default: 2000000 rows, 8 MiB, /tmp)
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "LogSegments.h"
+#include "StatementIndex.h"
+#include "Transaction.h"
+#include "TransactionLogReader.h"
+#include "TransactionLogger.h"
+#include "Utility.h"    // For formatDateTime
+#include <chrono>       // For std::chrono::steady_clock
+#include <cstdlib>      // For std::strtoull
+#include <filesystem>   // For std::filesystem::file_size, remove_all
+#include <fstream>
+#include <iomanip>      // For std::setw, std::setprecision
+#include <iostream>
+#include <shared_mutex> // For std::shared_lock
+#include <vector>
+
+static const size_t ACCOUNTS = 1000;
+static const size_t PHASES = 10;
+
+// Account key of row i; spreads rows evenly over ACCOUNTS accounts
+static uint64_t accountOf(size_t i) {
+    return 1000000000ULL + (i * 7919) % ACCOUNTS;
+}
+
+// Newest page of an account's statement, as viewAccountStatement reads it (microseconds per call)
+static double recentStatementMicros(LogSegments& segments, StatementIndex& index, const std::string& logPath,
+                                    uint64_t key, size_t pageSize, size_t repeats, size_t& found) {
+    static TransactionLogReader log; // Long-lived, as in viewAccountStatement
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r) {
+        std::shared_lock<std::shared_mutex> reading = segments.lockForReading();
+        if (!log.refresh()) {
+            log.open(logPath, 64 * 1024 * 1024);
+        }
+        std::vector<std::string> rows;
+        index.forEachRow(key, [&](uint64_t offset, uint32_t) {
+            const Transaction* trans = log.at(offset);
+            if (trans) {
+                rows.push_back(formatDateTime(trans->timestamp));
+            }
+            return trans && rows.size() < pageSize;
+        });
+        if (rows.size() < pageSize) {
+            segments.forEachAccountRow(key, [&](const Transaction& trans) {
+                rows.push_back(formatDateTime(trans.timestamp));
+                return rows.size() < pageSize;
+            });
+        }
+        found = rows.size();
+    }
+    return secondsSince(start) * 1e6 / repeats;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    uint64_t segmentBytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8) * 1024 * 1024;
+    std::string base = argc > 3 ? argv[3] : "/tmp";
+    std::string dir = makeTempDirectory(base, "bench_segments");
+    if (dir.empty()) {
+        return 1;
+    }
+    std::string logPath = dir + "/logs.dat";
+
+    // One row per second starting 2025-01-01, so dates increase like a real log
+    std::vector<Transaction> rows;
+    rows.reserve(n);
+    const int64_t start = 1735689600;
+    for (size_t i = 0; i < n; ++i) {
+        rows.emplace_back(accountOf(i), static_cast<TransactionType>(1 + i % 4), Money::fromPaisa(static_cast<int64_t>(i % 5000000)),
+                          start + static_cast<int64_t>(i));
+    }
+
+    {
+        SegmentPolicy policy;
+        policy.maxActiveBytes = segmentBytes;
+        policy.rollDaily = false; // Roll by size only, so segment count tracks rows written
+        StatementIndex index(logPath, dir + "/logs.idx", dir + "/logs.heads");
+        index.open();
+        TransactionLogger logger(logPath, LoggerPolicy(), &index);
+        LogSegments segments(logPath, dir + "/logs", policy);
+        segments.open();
+
+        // A recent account: its newest rows are in the active log.
+        // A quiet account: it only appeared in the first phase, so its rows sink into the oldest segment.
+        uint64_t quiet = 1099999999;
+
+        std::cout << "Appending " << n << " rows, rolling over every " << segmentBytes / (1024 * 1024) << " MiB" << std::endl;
+        std::cout << std::left << std::setw(10) << "Phase" << std::setw(12) << "Segments"
+                  << std::setw(14) << "Rows/sec" << std::setw(22) << "Recent page (us)"
+                  << std::setw(22) << "Quiet page (us)" << std::endl;
+        size_t perPhase = (n + PHASES - 1) / PHASES;
+        for (size_t phase = 0; phase < PHASES; ++phase) {
+            size_t first = phase * perPhase;
+            size_t last = std::min(n, first + perPhase);
+            auto t = std::chrono::steady_clock::now();
+            for (size_t i = first; i < last; ++i) {
+                segments.rollOverIfDue(logger, rows[i].timestamp);
+                logger.append(rows[i]);
+            }
+            if (phase == 0) {
+                logger.append(Transaction(quiet, TransactionType::DEPOSIT, Money::fromPaisa(100), rows[last - 1].timestamp));
+            }
+            double rate = (last - first) / secondsSince(t);
+            logger.flush();
+
+            size_t found = 0;
+            double recent = recentStatementMicros(segments, index, logPath, rows[last - 1].accountKey, 10, 200, found);
+            size_t quietFound = 0;
+            double quietMicros = recentStatementMicros(segments, index, logPath, quiet, 10, 200, quietFound);
+            std::cout << std::setw(10) << phase + 1 << std::setw(12) << segments.segmentCount()
+                      << std::setw(14) << std::fixed << std::setprecision(0) << rate
+                      << std::setw(22) << std::setprecision(1) << recent
+                      << std::setw(22) << quietMicros << std::endl;
+            if (found != 10 || quietFound != 1) {
+                std::cerr << "Error: Statement found " << found << " and " << quietFound << " rows." << std::endl;
+                return 1;
+            }
+        }
+
+        // Every row must be in exactly one place: a sealed segment or the active log
+        logger.flush();
+        std::shared_lock<std::shared_mutex> reading = segments.lockForReading();
+        size_t sealedRows = 0;
+        segments.forEachRow([&](const Transaction&) { ++sealedRows; return true; });
+        TransactionLogReader active;
+        active.open(logPath);
+        size_t activeRows = active.size();
+        std::cout << "Sealed rows: " << sealedRows << ", active rows: " << activeRows << std::endl;
+        if (sealedRows + activeRows != n + 1) {
+            std::cerr << "Error: Expected " << n + 1 << " rows in total." << std::endl;
+            return 1;
+        }
+    }
+
+    // Sizes of up to four days of rows as a legacy CSV log, as a binary log and as both sealed encodings
+    std::string csvPath = dir + "/day.csv";
+    std::string binaryPath = dir + "/day.dat";
+    size_t sample = std::min<size_t>(n, 86400 * 4);
+    {
+        std::ofstream csv(csvPath, std::ios::binary);
+        for (size_t i = 0; i < sample; ++i) {
+            csv << unpackAccountNumber(rows[i].accountKey) << ',' << transactionTypeToString(rows[i].type) << ','
+                << rows[i].amount << ',' << formatDateTime(rows[i].timestamp) << '\n';
+        }
+        LoggerPolicy policy;
+        policy.flushInterval = std::chrono::milliseconds(0);
+        TransactionLogger binary(binaryPath, policy, nullptr);
+        for (size_t i = 0; i < sample; ++i) {
+            binary.append(rows[i]);
+        }
+    }
+    std::cout << std::left << std::setw(10) << "Format" << std::setw(14) << "Bytes" << std::setw(12) << "Ratio"
+              << "Seal time (ms)" << std::endl;
+    uint64_t csvBytes = std::filesystem::file_size(csvPath);
+    std::cout << std::setw(10) << "CSV" << std::setw(14) << csvBytes << std::setw(12) << "1.00" << "-" << std::endl;
+    uint64_t binaryBytes = std::filesystem::file_size(binaryPath);
+    std::cout << std::setw(10) << "Records" << std::setw(14) << binaryBytes << std::setw(12) << std::setprecision(2)
+              << static_cast<double>(csvBytes) / binaryBytes << "-" << std::endl;
+    for (bool compress : {false, true}) {
+        std::string segmentPath = dir + (compress ? "/day.varint.seg" : "/day.raw.seg");
+        auto t = std::chrono::steady_clock::now();
+        if (!LogSegments::seal(binaryPath, segmentPath, compress)) {
+            std::cerr << "Error: Could not seal " << binaryPath << "." << std::endl;
+            return 1;
+        }
+        double ms = secondsSince(t) * 1000.0;
+        uint64_t bytes = std::filesystem::file_size(segmentPath);
+        std::cout << std::setw(10) << (compress ? "VARINT" : "RAW") << std::setw(14) << bytes
+                  << std::setw(12) << std::setprecision(2) << static_cast<double>(csvBytes) / bytes
+                  << std::setprecision(0) << ms << std::endl;
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
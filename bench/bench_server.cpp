@@ -0,0 +1,294 @@
+// bench/bench_server.cpp
+// Load generator for service mode (see RequestServer). Opens one connection
+// per client thread to the server's Unix socket and logs it in, then keeps
+// up to --pipeline requests in flight on each (balance, deposit, withdraw,
+// balance, repeating) until it has sent --requests. Times every request from
+// the write that sent it to the read that brought its response, and prints
+// requests per second and p50/p99/p99.9 latency.
+// By default it serves a fresh store from an in-process server, with one
+// account per client, and checks the final balances afterwards. With
+// --connect it drives a server that is already running
+// (bank_management_system --serve --socket <path>) instead, logging every
+// client in to --account with --pin.
+// Usage: bench_server [--clients N] [--requests N] [--pipeline N] [--workers N]
+//                     [--connect <socket> --account <number> --pin <pin>]
+//        (default: 16 clients, 20000 requests each, 8 in flight, the server's default workers)
+// The in-process server runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "BenchUtil.h"
+#include "PostingEngine.h"
+#include "RequestServer.h"
+#include "UserAuth.h"
+#include <algorithm>      // For std::sort, std::min, std::max
+#include <cerrno>         // For errno
+#include <chrono>         // For std::chrono::steady_clock
+#include <csignal>        // For std::signal, SIGPIPE
+#include <cstdlib>        // For std::strtoull
+#include <cstring>        // For std::strcmp, std::memchr
+#include <deque>
+#include <iomanip>        // For std::setprecision
+#include <iostream>
+#include <string>
+#include <sys/socket.h>   // For socket, connect
+#include <sys/un.h>       // For sockaddr_un
+#include <thread>         // For std::thread
+#include <unistd.h>       // For read, write, close
+#include <vector>
+
+static const int64_t INITIAL_BALANCE_PAISA = 100000; // TK. 1000.00 per account
+static const char* const PIN = "1234";
+
+struct LoadConfig {
+    size_t clients = 16;
+    size_t requests = 20000;  // Per client
+    size_t pipeline = 8;      // Requests in flight per client
+    size_t workers = 0;       // In-process server only; 0 for its default
+    std::string socketPath;   // Set by --connect
+    std::string account;      // Account every client logs in to with --connect
+    std::string pin;
+};
+
+// What one client thread saw
+struct ClientResult {
+    std::vector<double> micros; // Latency of each answered request
+    size_t failures = 0;        // Requests answered with ERR
+    bool ok = false;            // Connected, logged in and got every response
+};
+
+static bool parseArgs(int argc, char* argv[], LoadConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << "." << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--clients") == 0) {
+            config.clients = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--requests") == 0) {
+            config.requests = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--pipeline") == 0) {
+            config.pipeline = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--workers") == 0) {
+            config.workers = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--connect") == 0) {
+            config.socketPath = value;
+        } else if (std::strcmp(arg, "--account") == 0) {
+            config.account = value;
+        } else if (std::strcmp(arg, "--pin") == 0) {
+            config.pin = value;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "." << std::endl;
+            return false;
+        }
+    }
+    if (!config.socketPath.empty() && (config.account.empty() || config.pin.empty())) {
+        std::cerr << "Error: --connect needs --account and --pin." << std::endl;
+        return false;
+    }
+    config.clients = std::max<size_t>(config.clients, 1);
+    config.requests = std::max<size_t>(config.requests, 1);
+    config.pipeline = std::max<size_t>(config.pipeline, 1);
+    return true;
+}
+
+// The i-th request a client sends; deposits and withdrawals of TK. 1.00 alternate
+static const char* requestText(size_t i) {
+    static const char* const cycle[] = {"balance\n", "deposit 1.00\n", "withdraw 1.00\n", "balance\n"};
+    return cycle[i % 4];
+}
+
+// Net change in paisa that the first count requests make to a balance
+static int64_t netChange(size_t count) {
+    size_t deposits = count / 4 + (count % 4 > 1 ? 1 : 0);
+    size_t withdrawals = count / 4 + (count % 4 > 2 ? 1 : 0);
+    return 100 * (static_cast<int64_t>(deposits) - static_cast<int64_t>(withdrawals));
+}
+
+static int connectTo(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    path.copy(address.sun_path, path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Log in, then run the request stream with up to config.pipeline requests in flight
+static void runClient(const LoadConfig& config, const std::string& account, ClientResult& result) {
+    int fd = connectTo(config.socketPath);
+    if (fd < 0) {
+        std::cerr << "Error: Could not connect to " << config.socketPath << "." << std::endl;
+        return;
+    }
+    result.micros.reserve(config.requests);
+    std::deque<std::chrono::steady_clock::time_point> inFlight;
+    std::string received;
+    char buffer[16 * 1024];
+    bool loggedIn = false;
+    bool ok = writeAll(fd, "login " + account + " " + (config.pin.empty() ? PIN : config.pin) + "\n");
+    size_t sent = 0;
+    size_t answered = 0;
+
+    while (ok && answered < config.requests) {
+        if (loggedIn) {
+            std::string batch;
+            auto now = std::chrono::steady_clock::now();
+            while (sent < config.requests && inFlight.size() < config.pipeline) {
+                batch += requestText(sent++);
+                inFlight.push_back(now);
+            }
+            if (!batch.empty() && !writeAll(fd, batch)) {
+                ok = false;
+                break;
+            }
+        }
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        received.append(buffer, static_cast<size_t>(n));
+        size_t start = 0;
+        size_t newline;
+        while ((newline = received.find('\n', start)) != std::string::npos) {
+            bool success = received.compare(start, 3, "OK ") == 0 || received.compare(start, 3, "OK\n") == 0;
+            start = newline + 1;
+            if (!loggedIn) {
+                if (!success) {
+                    std::cerr << "Error: Could not log in to account " << account << "." << std::endl;
+                    ok = false;
+                    break;
+                }
+                loggedIn = true;
+                continue;
+            }
+            result.micros.push_back(std::chrono::duration<double, std::micro>(now - inFlight.front()).count());
+            inFlight.pop_front();
+            result.failures += success ? 0 : 1;
+            ++answered;
+        }
+        received.erase(0, start);
+    }
+    writeAll(fd, "quit\n");
+    ::close(fd);
+    result.ok = ok;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Without --connect: a fresh store and an in-process server on a socket in a temporary directory
+    bool inProcess = config.socketPath.empty();
+    std::string scratch;
+    std::vector<std::string> accounts(config.clients, config.account);
+    ServerOptions options;
+    options.workers = config.workers;
+    options.maxPipeline = std::max<size_t>(config.pipeline, ServerOptions().maxPipeline);
+    if (inProcess) {
+        scratch = enterScratchDirectory("bench_server");
+        if (scratch.empty()) {
+            return 1;
+        }
+        config.socketPath = scratch + "/bms.sock";
+        options.socketPath = config.socketPath;
+        for (std::string& account : accounts) {
+            account = UserAuth::createAccount(PIN, Money::fromPaisa(INITIAL_BALANCE_PAISA), "Load Client",
+                                              AccountType::SAVINGS, Account::NO_ACCOUNT_KEY);
+        }
+    }
+    RequestServer server(options);
+    std::thread serverThread;
+    if (inProcess) {
+        serverThread = std::thread([&server] { server.run(); });
+        // Wait until the server accepts connections
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            int fd = connectTo(config.socketPath);
+            if (fd >= 0) {
+                ::close(fd);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::vector<ClientResult> results(config.clients);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < config.clients; ++c) {
+        clients.emplace_back(runClient, std::cref(config), std::cref(accounts[c]), std::ref(results[c]));
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = true;
+    std::vector<double> micros;
+    size_t failures = 0;
+    for (const ClientResult& result : results) {
+        ok = ok && result.ok;
+        failures += result.failures;
+        micros.insert(micros.end(), result.micros.begin(), result.micros.end());
+    }
+    std::sort(micros.begin(), micros.end());
+
+    if (inProcess) {
+        server.stop();
+        serverThread.join();
+        // Every client's deposits and withdrawals must have landed exactly once
+        Money expected = Money::fromPaisa(INITIAL_BALANCE_PAISA + netChange(config.requests));
+        for (const std::string& account : accounts) {
+            Money balance;
+            if (!PostingEngine::getBalance(account, balance) || balance != expected) {
+                std::cerr << "Error: Account " << account << " ended with the wrong balance." << std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    std::cout << config.clients << " client(s), " << config.pipeline << " request(s) in flight each" << std::endl;
+    if (!micros.empty()) {
+        std::cout << std::fixed << std::setprecision(0) << micros.size() / seconds << " requests/s over "
+                  << std::setprecision(2) << seconds << " s, " << failures << " failed" << std::endl;
+        std::cout << "Latency us: p50 " << std::setprecision(1) << percentile(micros, 50)
+                  << "  p99 " << percentile(micros, 99) << "  p99.9 " << percentile(micros, 99.9)
+                  << "  max " << micros.back() << std::endl;
+    }
+    std::cout << "Every request answered" << (inProcess ? " and balances consistent" : "") << ": "
+              << (ok ? "yes" : "NO") << std::endl;
+
+    if (inProcess) {
+        leaveScratchDirectory(scratch);
+    }
+    return ok ? 0 : 1;
+}
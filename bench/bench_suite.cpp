@@ -0,0 +1,296 @@
+// bench/bench_suite.cpp
+// Regression benchmark for the hot paths of the program: registration, login
+// (with the PIN KDF, and again from the session cache), deposit (with its
+// journal write), a statement page, and a full save and load of the
+// accounts file. Builds a synthetic account database and transaction log of
+// the requested size, runs each operation after a warmup, and prints
+// per-operation p50/p99 latency and throughput as JSON so results can be
+// compared between releases on the same machine.
+// Usage: bench_suite [--accounts N] [--log-rows N] [--samples N] [--heavy-samples N]
+//                    [--warmup N] [--seed N] [--pin-iterations N] [--output file.json]
+//        (default: 100000 accounts, 1000000 log rows, 2000 samples of the fast
+//         operations, 20 of KDF login/registration/save/load, 200 warmup runs,
+//         PinHash::DEFAULT_ITERATIONS, JSON on stdout)
+// Runs inside a fresh temporary directory so the real data/ files are untouched.
+#include "AccountIndex.h" // For unpackAccountNumber
+#include "BenchUtil.h"
+#include "PinHash.h"
+#include "PostingEngine.h"
+#include "Transaction.h"
+#include "UserAuth.h"
+#include "Utility.h"      // For currentTimestamp
+#include <algorithm>      // For std::sort, std::min
+#include <chrono>         // For std::chrono::steady_clock
+#include <cstdlib>        // For std::strtoull
+#include <cstring>        // For std::strcmp
+#include <filesystem>     // For std::filesystem::absolute
+#include <fstream>
+#include <functional>     // For std::function
+#include <iomanip>        // For std::setprecision
+#include <iostream>
+#include <random>         // For std::mt19937_64
+#include <sstream>        // For std::ostringstream
+#include <streambuf>      // For std::streambuf
+#include <string>
+#include <thread>         // For std::thread::hardware_concurrency
+#include <vector>
+
+static const int64_t INITIAL_BALANCE_PAISA = 100000; // TK. 1000.00 per account
+static const size_t STATEMENT_PAGE_SIZE = 10;
+
+struct SuiteConfig {
+    size_t accounts = 100000;
+    size_t logRows = 1000000;
+    size_t samples = 2000;      // Per fast operation (login, deposit, statement)
+    size_t heavySamples = 20;   // Per operation that runs the KDF or rewrites or rereads the whole store
+    size_t warmup = 200;
+    uint64_t seed = 42;
+    uint32_t pinIterations = PinHash::DEFAULT_ITERATIONS;
+    std::string output;         // Empty for stdout
+};
+
+struct OperationResult {
+    std::string name;
+    size_t samples;
+    size_t failures;
+    double p50Micros;
+    double p99Micros;
+    double meanMicros;
+    double maxMicros;
+    double opsPerSecond;
+};
+
+// Swallows output, so the console messages of the operations under test
+// cost what they cost without flooding the terminal
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+static NullBuffer nullBuffer;
+
+// Redirects std::cout to nullBuffer for as long as it lives
+class MutedConsole {
+private:
+    std::streambuf* saved;
+
+public:
+    MutedConsole() : saved(std::cout.rdbuf(&nullBuffer)) {}
+    ~MutedConsole() { std::cout.rdbuf(saved); }
+};
+
+static bool parseArgs(int argc, char* argv[], SuiteConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << "." << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--accounts") == 0) {
+            config.accounts = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--log-rows") == 0) {
+            config.logRows = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--samples") == 0) {
+            config.samples = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--heavy-samples") == 0) {
+            config.heavySamples = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--warmup") == 0) {
+            config.warmup = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--seed") == 0) {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--pin-iterations") == 0) {
+            config.pinIterations = static_cast<uint32_t>(std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--output") == 0) {
+            config.output = value;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "." << std::endl;
+            return false;
+        }
+    }
+    config.accounts = std::max<size_t>(config.accounts, 1);
+    config.samples = std::max<size_t>(config.samples, 1);
+    config.heavySamples = std::max<size_t>(config.heavySamples, 1);
+    return true;
+}
+
+// Run op warmup times untimed, then samples times, timing each call on its own.
+// op returns false when the operation failed; failures are counted, not retried.
+static OperationResult measure(const std::string& name, size_t warmup, size_t samples,
+                               const std::function<bool(size_t)>& op) {
+    for (size_t i = 0; i < warmup; ++i) {
+        op(i);
+    }
+    std::vector<double> micros;
+    micros.reserve(samples);
+    OperationResult result{name, samples, 0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    double total = 0.0;
+    for (size_t i = 0; i < samples; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = op(warmup + i);
+        double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        micros.push_back(elapsed);
+        total += elapsed;
+        result.failures += ok ? 0 : 1;
+    }
+    std::sort(micros.begin(), micros.end());
+    result.p50Micros = percentile(micros, 50.0);
+    result.p99Micros = percentile(micros, 99.0);
+    result.meanMicros = total / samples;
+    result.maxMicros = micros.back();
+    result.opsPerSecond = total > 0.0 ? samples * 1e6 / total : 0.0;
+    return result;
+}
+
+static void writeJson(std::ostream& out, const SuiteConfig& config, double setupSeconds,
+                      const std::vector<OperationResult>& results) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"benchmark\": \"bench_suite\",\n";
+    out << "  \"host\": {\"hardware_threads\": " << std::thread::hardware_concurrency()
+        << ", \"compiler\": \"" << __VERSION__ << "\"},\n";
+    out << "  \"config\": {\"accounts\": " << config.accounts << ", \"log_rows\": " << config.logRows
+        << ", \"samples\": " << config.samples << ", \"heavy_samples\": " << config.heavySamples
+        << ", \"warmup\": " << config.warmup << ", \"seed\": " << config.seed
+        << ", \"pin_iterations\": " << config.pinIterations << "},\n";
+    out << "  \"setup_seconds\": " << setupSeconds << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const OperationResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"samples\": " << r.samples
+            << ", \"failures\": " << r.failures
+            << ", \"p50_us\": " << r.p50Micros << ", \"p99_us\": " << r.p99Micros
+            << ", \"mean_us\": " << r.meanMicros << ", \"max_us\": " << r.maxMicros
+            << ", \"ops_per_sec\": " << r.opsPerSecond << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    SuiteConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        std::cerr << "Usage: bench_suite [--accounts N] [--log-rows N] [--samples N] [--heavy-samples N]"
+                  << " [--warmup N] [--seed N] [--pin-iterations N] [--output file.json]" << std::endl;
+        return 1;
+    }
+    // Resolve the output path before leaving the working directory
+    std::string outputPath = config.output.empty()
+        ? "" : std::filesystem::absolute(config.output).string();
+
+    std::string scratch = enterScratchDirectory("bench_suite");
+    if (scratch.empty()) {
+        return 1;
+    }
+    PinHash::setIterations(config.pinIterations);
+
+    // Synthetic database: sequential account numbers, then a log of rows
+    // spread over them, one second apart and ending now
+    auto setupStart = std::chrono::steady_clock::now();
+    std::vector<std::string> numbers;
+    numbers.reserve(config.accounts);
+    {
+        MutedConsole muted;
+        const PinCredential pin = PinHash::hash("1234"); // One KDF run shared by every synthetic account
+        for (size_t i = 0; i < config.accounts; ++i) {
+            numbers.push_back(unpackAccountNumber(1000000000ULL + i));
+            UserAuth::addAccount(Account(numbers.back(), pin, Money::fromPaisa(INITIAL_BALANCE_PAISA),
+                                         "Customer " + std::to_string(1000000000ULL + i), AccountType::SAVINGS));
+        }
+        if (!UserAuth::checkpoint()) {
+            std::cerr << "Error: Could not write the accounts file." << std::endl;
+            return 1;
+        }
+        std::mt19937_64 gen(config.seed);
+        int64_t first = currentTimestamp() - static_cast<int64_t>(config.logRows);
+        for (size_t i = 0; i < config.logRows; ++i) {
+            uint64_t key = 1000000000ULL + gen() % config.accounts;
+            logTransaction(Transaction(key, static_cast<TransactionType>(1 + i % 4),
+                                       Money::fromPaisa(static_cast<int64_t>(1 + gen() % 100000)),
+                                       first + static_cast<int64_t>(i)));
+        }
+        flushTransactionLog();
+    }
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+
+    std::mt19937_64 gen(config.seed + 1);
+    std::uniform_int_distribution<size_t> pick(0, config.accounts - 1);
+    std::vector<OperationResult> results;
+    {
+        MutedConsole muted;
+
+        // The operations that run the KDF or touch the whole store get fewer
+        // samples and a short warmup
+        size_t heavyWarmup = std::min<size_t>(config.warmup, 2);
+
+        // Login: the lookup and PIN check loginUser does after reading its
+        // input, first with the full KDF, then for a session already verified
+        results.push_back(measure("login_kdf", heavyWarmup, config.heavySamples, [&](size_t) {
+            PinHash::clearSessionCache();
+            Account* acc = UserAuth::findAccount(numbers[pick(gen)]);
+            return acc && acc->authenticate("1234");
+        }));
+        const std::string& sessionAccount = numbers[pick(gen)];
+        results.push_back(measure("login_cached", config.warmup, config.samples, [&](size_t) {
+            Account* acc = UserAuth::findAccount(sessionAccount);
+            return acc && acc->authenticate("1234");
+        }));
+
+        // Deposit: balance change, journal append and log row, as from the menu
+        results.push_back(measure("deposit_persist", config.warmup, config.samples, [&](size_t) {
+            return PostingEngine::deposit(numbers[pick(gen)], Money::fromPaisa(100)) == PostingResult::SUCCESS;
+        }));
+
+        // Statement: the newest page of a random account's history, formatted
+        StatementQuery query;
+        query.pageSize = STATEMENT_PAGE_SIZE;
+        results.push_back(measure("statement_page", config.warmup, config.samples, [&](size_t) {
+            viewAccountStatement(numbers[pick(gen)], query);
+            return true;
+        }));
+
+        // Registration: create the account and save it immediately, as registerUser does
+        results.push_back(measure("register", heavyWarmup, config.heavySamples, [&](size_t i) {
+            std::string number = UserAuth::createAccount("1234", Money::fromPaisa(INITIAL_BALANCE_PAISA),
+                                                         "New Customer " + std::to_string(i), AccountType::SAVINGS,
+                                                         Account::NO_ACCOUNT_KEY);
+            return !number.empty() && UserAuth::checkpoint();
+        }));
+
+        results.push_back(measure("save_accounts", heavyWarmup, config.heavySamples, [&](size_t) {
+            return UserAuth::checkpoint();
+        }));
+
+        size_t expected = UserAuth::accountCount();
+        results.push_back(measure("load_accounts", heavyWarmup, config.heavySamples, [&](size_t) {
+            UserAuth::loadAccounts();
+            return UserAuth::accountCount() == expected;
+        }));
+        flushTransactionLog();
+    }
+
+    bool ok = true;
+    for (const OperationResult& r : results) {
+        if (r.failures > 0) {
+            std::cerr << "Error: " << r.name << " failed " << r.failures << " of " << r.samples << " times." << std::endl;
+            ok = false;
+        }
+    }
+
+    if (outputPath.empty()) {
+        writeJson(std::cout, config, setupSeconds, results);
+    } else {
+        std::ofstream out(outputPath, std::ios::trunc);
+        writeJson(out, config, setupSeconds, results);
+        if (!out) {
+            std::cerr << "Error: Could not write " << outputPath << "." << std::endl;
+            ok = false;
+        } else {
+            std::cerr << "Results written to " << outputPath << std::endl;
+        }
+    }
+
+    leaveScratchDirectory(scratch);
+    return ok ? 0 : 1;
+}
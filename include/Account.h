@@ -2,13 +2,18 @@
 #ifndef ACCOUNT_H
 #define ACCOUNT_H
 
+#include "Money.h"
+#include "PinHash.h" // For PinCredential
 #include <string>
+#include <string_view> // For std::string_view
+#include <cstdint> // For uint8_t, uint64_t
 #include <fstream> // For std::ofstream, std::ifstream
 #include <iostream> // For std::cout
 #include <vector> // For potential future use with transactions within account
 
-// Enum to define different types of accounts
-enum class AccountType {
+// Enum to define different types of accounts.
+// The underlying values are stored on disk, so only append new types before UNKNOWN.
+enum class AccountType : uint8_t {
     SAVINGS,
     CURRENT,
     FIXED_DEPOSIT,
@@ -28,45 +33,66 @@ std::string accountTypeToString(AccountType type);
 AccountType stringToAccountType(const std::string& typeStr);
 
 
+// An account is a small fixed-size object with no heap storage of its own:
+// the account number is kept packed as an integer, the salted PIN hash
+// inline, and the owner name in StringArena::names(), so copying or scanning
+// accounts never allocates.
 class Account {
+public:
+    static const uint64_t NO_ACCOUNT_KEY; // Key of an account without a valid number
+
 private:
-    std::string accountNumber;
-    std::string pin; // Stored as plain text for simplicity; in real app, hash this.
-    double balance;
-    std::string ownerName;
+    uint64_t accountKey; // Packed 10-digit account number (see packAccountNumber)
+    Money balance;
+    std::string_view ownerName; // Points into StringArena::names()
     AccountType accountType; // New member for account type
+    uint64_t fundingKey; // Account debited for this one's installments (recurring deposits), NO_ACCOUNT_KEY if none
+    PinCredential pin; // Salted hash of the PIN; the PIN itself is never kept
 
 public:
     // Default constructor
     Account();
 
-    // Parameterized constructor (updated to include accountType)
-    Account(const std::string& accNum, const std::string& p, double bal, const std::string& name, AccountType type);
+    // Parameterized constructor (updated to include accountType).
+    // Copies the owner name into the name arena and hashes the PIN (see PinHash).
+    Account(const std::string& accNum, const std::string& p, Money bal, const std::string& name, AccountType type);
+
+    // Same, with a PIN that is already hashed
+    Account(const std::string& accNum, const PinCredential& credential, Money bal, const std::string& name,
+            AccountType type);
+
+    // Build an account whose owner name is already stored in StringArena::names()
+    // (e.g. a whole name table copied in at once by the loader)
+    static Account fromPooled(uint64_t key, const PinCredential& credential, Money bal, std::string_view pooledName,
+                              AccountType type);
 
     // Getters
-    std::string getAccountNumber() const;
-    std::string getPin() const;
-    double getBalance() const;
-    std::string getOwnerName() const;
+    uint64_t getAccountKey() const;
+    std::string getAccountNumber() const; // Formatted from the key; short enough to never allocate
+    const PinCredential& getPinCredential() const;
+    Money getBalance() const;
+    std::string_view getOwnerName() const;
     AccountType getAccountType() const; // New getter for account type
+    uint64_t getFundingAccountKey() const;
 
     // Setters (if needed, though direct modification is often avoided)
-    void setBalance(double newBalance);
+    void setBalance(Money newBalance);
+    void setFundingAccountKey(uint64_t key); // Set once, when the account is created or loaded
 
     // Core account operations
-    bool deposit(double amount);
-    bool withdraw(double amount);
+    bool deposit(Money amount);
+    bool withdraw(Money amount);
 
-    // Authentication
-    bool authenticate(const std::string& enteredPin) const;
+    // Authentication: checks the PIN against its hash, through the session cache
+    bool authenticate(std::string_view enteredPin) const;
 
     // Display account information
     void displayAccountInfo() const;
 
-    // File I/O operations for saving/loading account data
-    // These methods handle the serialization/deserialization of an Account object
-    void saveToFile(std::ofstream& ofs) const;
-    void loadFromFile(std::ifstream& ifs);
+    // Read one account in the legacy length-prefixed format. Returns false,
+    // leaving the account unchanged, if the record is cut short or damaged.
+    // Only used to migrate old accounts files; new files are written by AccountFile.
+    bool loadFromFile(std::ifstream& ifs);
 
     // Operator overload for comparison (useful for finding accounts)
     bool operator==(const Account& other) const;
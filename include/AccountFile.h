@@ -0,0 +1,134 @@
+// include/AccountFile.h
+#ifndef ACCOUNTFILE_H
+#define ACCOUNTFILE_H
+
+#include "Account.h"
+#include <cstdint> // For fixed-width integer types
+#include <deque>
+#include <string>
+#include <vector>
+
+// On-disk layout of an accounts file (format version 6):
+//
+//   [AccountFileHeader][AccountRecord x recordCount][name bytes]
+//
+// Every record has the same size, so record i lives at a known offset and
+// can be read without touching the rest of the file. Owner names are
+// variable-length, so they are interned into a single name table at the end
+// of the file and each record stores an offset/length into it.
+//
+// Integrity: the header carries a CRC32C of itself and the name table, and
+// every record a CRC32C of all its fields, balance included, and its owner
+// name. Files are written to a temporary file, synced and renamed over the
+// old one, so a crash never leaves a half-written file behind.
+
+const char ACCOUNT_FILE_MAGIC[8] = {'B', 'M', 'S', 'A', 'C', 'C', 'T', '\0'};
+const uint32_t ACCOUNT_FILE_VERSION = 6;
+
+struct AccountFileHeader {
+    char magic[8];        // ACCOUNT_FILE_MAGIC
+    uint32_t version;     // ACCOUNT_FILE_VERSION
+    uint32_t recordSize;  // sizeof(AccountRecord), checked on open
+    uint64_t recordCount; // Number of fixed-size records that follow the header
+    uint64_t namesOffset; // File offset of the name table
+    uint64_t namesSize;   // Size of the name table in bytes
+    uint32_t checksum;    // CRC32C of this header (with checksum zero) and the name table
+    uint32_t reservedWord;
+    uint64_t reserved[2]; // Pads the header to 64 bytes
+};
+
+struct AccountRecord {
+    uint64_t accountNumber; // Packed 10-digit account number
+    int64_t balance;        // Paisa
+    uint64_t fundingAccount; // Packed number of the account that funds installments, Account::NO_ACCOUNT_KEY if none
+    uint32_t nameOffset;    // Offset of the owner name within the name table
+    uint32_t nameLength;    // Length of the owner name in bytes
+    uint32_t pinIterations; // PinCredential::iterations
+    uint8_t type;           // AccountType as its underlying integer value
+    uint8_t reserved[3];
+    uint8_t pinSalt[16];    // PinCredential::salt
+    uint8_t pinHash[32];    // PinCredential::hash
+    uint32_t checksum;      // CRC32C of the record (checksum zero) and its owner name
+    uint32_t padding;
+};
+
+static_assert(sizeof(AccountFileHeader) == 64, "AccountFileHeader layout changed");
+static_assert(sizeof(AccountRecord) == 96, "AccountRecord layout changed");
+
+// The accounts of one shard as they stood at one instant, so that they can
+// be written out while postings go on. Only the balances are copied: every
+// other field of an account is fixed when it is created, and accounts never
+// move once stored, so those are read through the pointers at write time.
+// Costs sizeof(Account*) + sizeof(Money) = 16 bytes per account.
+struct AccountSnapshot {
+    std::vector<const Account*> accounts;
+    std::vector<Money> balances;
+
+    // Copy the balances of every account in source (which must not change meanwhile)
+    void capture(const std::deque<Account>& source);
+
+    // Memory held by the snapshot in bytes
+    size_t bytes() const;
+};
+
+// A memory-mapped accounts file in the fixed-width format. Files are only
+// ever replaced whole (see write), so the mapping is read-only and private.
+class AccountFile {
+private:
+    int fd;
+    const char* base; // Start of the mapping, or nullptr when closed
+    size_t length;    // Size of the mapping in bytes
+    uint64_t recordsInFile; // Records that lie wholly inside the file (fewer than recordCount if cut short)
+    uint64_t namesInFile;   // Bytes of the name table inside the file
+
+    const AccountFileHeader& header() const;
+    // Record i
+    const AccountRecord& recordAt(size_t i) const;
+
+    // Whether record i passes its checksum and its name lies inside the file
+    bool recordIntact(size_t i) const;
+
+    // Build an Account from record i whose name is viewed in the name table at names
+    Account buildAccount(size_t i, const char* names) const;
+
+public:
+    AccountFile();
+    ~AccountFile();
+
+    AccountFile(const AccountFile&) = delete;
+    AccountFile& operator=(const AccountFile&) = delete;
+
+    // Write all accounts to path in the fixed-width format. The file is built
+    // as path.tmp, synced and renamed over path, so path always holds either
+    // the old or the new contents.
+    static bool write(const std::string& path, const std::deque<Account>& accounts);
+
+    // Same, with the balances of a snapshot
+    static bool write(const std::string& path, const AccountSnapshot& snapshot);
+
+    // Map an existing fixed-width file for reading.
+    // Fails if the header is damaged; a file cut short is still opened, and
+    // readAccounts stops where its records end.
+    bool open(const std::string& path);
+    void close();
+
+    uint64_t recordCount() const;
+
+    // Append an Account for every record, storing all owner names in the
+    // name arena with a single copy of the name table. Records are split
+    // into ranges that are converted on several threads; they are fixed
+    // width, so record boundaries need no offset table.
+    // Every record is checked as it is converted (checksum, and that it and
+    // its name lie inside the file); reading stops cleanly before the first
+    // bad one. Returns the number of accounts appended, which is
+    // recordCount() unless the file is damaged.
+    size_t readAccounts(std::deque<Account>& accounts) const;
+
+    // Whether the header checksum (which also covers the name table) matches
+    bool checksumMatches() const;
+
+    // Read the balance stored in record i
+    Money readBalance(size_t i) const;
+};
+
+#endif // ACCOUNTFILE_H
@@ -0,0 +1,83 @@
+// include/AccountIndex.h
+#ifndef ACCOUNTINDEX_H
+#define ACCOUNTINDEX_H
+
+#include <cstdint> // For uint64_t
+#include <deque>
+#include <string>
+#include <vector>
+
+class Account;
+
+// Pack a 10-digit account number string into an integer key.
+// Returns false if the string is not exactly 10 decimal digits.
+bool packAccountNumber(const std::string& accNum, uint64_t& key);
+
+// Unpack an integer key back into its zero-padded 10-digit string form
+std::string unpackAccountNumber(uint64_t key);
+
+// Mix the bits of a packed account number for use as a hash table position
+uint64_t hashAccountKey(uint64_t key);
+
+// Open-addressing hash map from packed account number to Account* and the
+// account's position in the store (which is also its record number on disk).
+// Uses linear probing over a power-of-two table; the table grows when
+// it becomes more than half full, so lookups stay O(1) on average.
+class AccountIndex {
+private:
+    struct Slot {
+        uint64_t key;
+        Account* account;
+        size_t position;
+
+        Slot() {} // Left uninitialized so a large table can be filled in parallel
+        Slot(uint64_t k, Account* a, size_t p) : key(k), account(a), position(p) {}
+    };
+
+    static const uint64_t EMPTY_KEY; // Marks an unused slot (never a valid account number)
+
+    std::vector<Slot> slots;
+    size_t count;
+
+    // Find the slot that holds key, or the empty slot where it would go
+    size_t probe(uint64_t key) const;
+
+    // Rebuild the table with a new capacity (must be a power of two)
+    void rehash(size_t newCapacity);
+
+    // Insert while other threads do the same (used by build); the table must
+    // already have room for every key
+    void insertConcurrent(uint64_t key, Account* account, size_t position);
+
+public:
+    AccountIndex();
+
+    // Insert or replace the mapping for key
+    void insert(uint64_t key, Account* account, size_t position);
+
+    // Replace the contents with every account in the store (position i is
+    // accounts[i]; accounts without a valid number are skipped). Keys are
+    // partitioned by their home slot and each partition is inserted by its
+    // own thread, so the table is filled region by region instead of at
+    // random, which is several times faster for large stores.
+    void build(std::deque<Account>& accounts);
+
+    // Look up an account; returns nullptr if the key is not present
+    Account* find(uint64_t key) const;
+
+    // Look up an account's position; returns false if the key is not present
+    bool findPosition(uint64_t key, size_t& position) const;
+
+    // Check whether a key is present
+    bool contains(uint64_t key) const;
+
+    // Make room for at least n entries without rehashing
+    void reserve(size_t n);
+
+    // Remove all entries
+    void clear();
+
+    size_t size() const;
+};
+
+#endif // ACCOUNTINDEX_H
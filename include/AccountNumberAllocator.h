@@ -0,0 +1,78 @@
+// include/AccountNumberAllocator.h
+#ifndef ACCOUNTNUMBERALLOCATOR_H
+#define ACCOUNTNUMBERALLOCATOR_H
+
+#include <cstdint> // For uint64_t, uint32_t
+#include <mutex>   // For std::mutex
+#include <string>
+
+const char ACCOUNT_ALLOCATOR_MAGIC[8] = {'B', 'M', 'S', 'A', 'L', 'L', 'O', 'C'};
+const uint32_t ACCOUNT_ALLOCATOR_VERSION = 1;
+
+// Allocator state file: the permutation key and how far counters are reserved
+struct AccountAllocatorState {
+    char magic[8];     // ACCOUNT_ALLOCATOR_MAGIC
+    uint32_t version;  // ACCOUNT_ALLOCATOR_VERSION
+    uint32_t reserved;
+    uint64_t key;      // Secret key of the permutation, chosen when the file is created
+    uint64_t limit;    // Every counter below this may have been handed out
+};
+
+static_assert(sizeof(AccountAllocatorState) == 32, "AccountAllocatorState layout changed");
+
+// Hands out unique 10-digit account numbers in constant time.
+//
+// Numbers come from a counter, so none is ever issued twice and no lookup is
+// needed to find a free one. The counter is passed through a keyed Feistel
+// permutation of the 9-digit space, so consecutive registrations get
+// unrelated-looking numbers that do not reveal how many accounts exist; a
+// Luhn check digit is appended as the tenth digit to catch mistyped numbers.
+//
+// Only a high-water mark is persisted. Counters are reserved in blocks: the
+// state file records the end of the current block before any number from it
+// is issued, so after a crash the allocator resumes past that block and a
+// number can be skipped but never reused. reserve() makes one block large
+// enough for a whole bulk registration.
+class AccountNumberAllocator {
+public:
+    static const uint64_t CAPACITY = 1000000000ULL; // 9-digit bodies
+    static const uint64_t BLOCK_SIZE = 4096;        // Counters reserved per state-file write
+
+private:
+    std::string path;
+    std::mutex mutex;
+    bool loaded;
+    uint64_t key;
+    uint64_t next;  // Next counter to issue
+    uint64_t limit; // Counters below this are reserved on disk
+
+    // Read the state file, or create it with a fresh key
+    bool loadLocked();
+    // Durably record a new high-water mark (temporary file, sync, rename)
+    bool persistLocked(uint64_t newLimit);
+
+public:
+    explicit AccountNumberAllocator(const std::string& statePath);
+
+    AccountNumberAllocator(const AccountNumberAllocator&) = delete;
+    AccountNumberAllocator& operator=(const AccountNumberAllocator&) = delete;
+
+    // Issue the next account number as a packed key. Returns false when the
+    // state file cannot be written or every number has been issued.
+    bool allocate(uint64_t& accountKey);
+
+    // Make sure the next count numbers can be issued without touching the disk
+    bool reserve(uint64_t count);
+
+    // Counters used up so far, including any skipped by earlier runs
+    uint64_t issued();
+
+    // The account number a key gives to counter (counter < CAPACITY)
+    static uint64_t numberAt(uint64_t key, uint64_t counter);
+
+    // Whether the last digit of a 10-digit number is its Luhn check digit
+    // (checked before lookups by UserAuth::acceptsAccountNumber)
+    static bool hasValidCheckDigit(uint64_t accountKey);
+};
+
+#endif // ACCOUNTNUMBERALLOCATOR_H
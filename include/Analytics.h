@@ -0,0 +1,95 @@
+// include/Analytics.h
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include "Account.h"
+#include <cstddef> // For size_t
+#include <cstdint> // For int64_t
+#include <deque>
+#include <vector>
+
+// Number of AccountType values, including UNKNOWN
+const size_t ACCOUNT_TYPE_COUNT = static_cast<size_t>(AccountType::UNKNOWN) + 1;
+
+// Struct-of-arrays copy of every balance, in paisa, grouped by account type.
+// Balances of one type are contiguous, so any aggregate over a type (or over
+// all accounts) is a single pass over a plain int64_t array.
+class BalanceColumns {
+private:
+    std::vector<int64_t> balances;
+    size_t typeStart[ACCOUNT_TYPE_COUNT + 1]; // balances of type t are [typeStart[t], typeStart[t + 1])
+
+public:
+    BalanceColumns();
+
+    // Copy the balances out of the accounts container
+    void capture(const std::deque<Account>& accounts);
+
+    // Copy the balances out of several containers (such as the store's shards) as one set
+    void capture(const std::vector<const std::deque<Account>*>& parts);
+
+    // Capture the accounts held by UserAuth, with postings paused for the copy
+    void captureStore();
+
+    size_t size() const;
+    const int64_t* data() const;
+
+    // Balances of one account type
+    const int64_t* dataOf(AccountType type) const;
+    size_t sizeOf(AccountType type) const;
+};
+
+// Count, total and extremes of a set of balances
+struct BalanceStats {
+    size_t count;
+    Money total;
+    Money minimum; // Zero when count is 0
+    Money maximum; // Zero when count is 0
+
+    BalanceStats() : count(0), total(), minimum(), maximum() {}
+};
+
+// Instruction sets the analytics kernels can use
+enum class SimdLevel {
+    SCALAR,
+    AVX2
+};
+
+// Convert a SimdLevel to its display name
+const char* simdLevelToString(SimdLevel level);
+
+// Aggregation kernels over balance columns. Each kernel has a portable
+// scalar version and an AVX2 version; the best one the CPU supports is
+// picked when the program starts.
+class Analytics {
+private:
+    // Private constructor to prevent instantiation (it's a utility class)
+    Analytics() = delete;
+
+public:
+    // Best level this CPU supports
+    static SimdLevel detectedLevel();
+
+    // Level the kernels currently use
+    static SimdLevel activeLevel();
+
+    // Select the kernels to use (for benchmarks); levels the CPU lacks fall back to SCALAR
+    static void setLevel(SimdLevel level);
+
+    // Count, total (wrapping past +/-92 quadrillion taka), minimum and maximum
+    static BalanceStats stats(const int64_t* balances, size_t n);
+
+    // Number of balances strictly below threshold
+    static size_t countBelow(const int64_t* balances, size_t n, Money threshold);
+
+    // Bucket the balances by ascending edges: counts[0] holds balances below
+    // edges[0], counts[i] those in [edges[i - 1], edges[i]), and
+    // counts[edgeCount] those at or above the last edge
+    static void histogram(const int64_t* balances, size_t n, const Money* edges, size_t edgeCount, size_t* counts);
+
+    // Print per-type totals, a balance histogram with cumulative percentiles,
+    // and the number of accounts below threshold
+    static void printReport(const BalanceColumns& columns, Money threshold);
+};
+
+#endif // ANALYTICS_H
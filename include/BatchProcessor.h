@@ -0,0 +1,65 @@
+// include/BatchProcessor.h
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <cstddef> // For size_t
+#include <string>
+
+// Settings for a non-interactive batch run
+struct BatchOptions {
+    std::string inputPath;
+    std::string resultsPath; // Defaults to inputPath + ".results"
+    size_t batchSize;        // Input lines validated and committed together
+
+    BatchOptions() : inputPath(""), resultsPath(""), batchSize(10000) {}
+};
+
+// Totals reported at the end of a batch run
+struct BatchSummary {
+    size_t lines;     // Operation lines read (blank and comment lines excluded)
+    size_t succeeded;
+    size_t failed;
+    size_t batches;   // Commits made
+    double seconds;   // Wall-clock time of the run
+
+    BatchSummary() : lines(0), succeeded(0), failed(0), batches(0), seconds(0.0) {}
+};
+
+// Streams a file of operations through the posting engine without any
+// terminal interaction. One operation per line, comma separated:
+//
+//   register,<accountNumber or empty>,<pin>,<type 1-9>,<initialDeposit>,<owner name>
+//   deposit,<accountNumber>,<amount>
+//   withdraw,<accountNumber>,<amount>
+//   transfer,<fromAccount>,<toAccount>,<amount>
+//
+// The account type uses the numbering of the registration menu, and the
+// owner name is the rest of the line, so it may contain commas. Blank lines
+// and lines starting with '#' are skipped.
+//
+// Lines are handled batchSize at a time: the whole batch is parsed and
+// validated first, the PINs of its registrations are hashed on several
+// threads, its registrations are saved by rewriting the shard files they
+// land in (if one cannot be written, its new accounts are dropped and the
+// batch's postings are not applied), and its postings are applied in order
+// with one journal commit. Registrations therefore take
+// effect before the postings of their batch.
+// One result row is written per operation line:
+//
+//   <lineNumber>,OK,<accountNumber for register, otherwise empty>
+//   <lineNumber>,FAILED,<reason>
+class BatchProcessor {
+private:
+    // Private constructor to prevent instantiation (it's a utility class)
+    BatchProcessor() = delete;
+
+public:
+    // Run the whole input file. Returns false if the input or results file
+    // could not be opened or a commit failed; failed lines alone do not count.
+    static bool run(const BatchOptions& options, BatchSummary& summary);
+
+    // Print the totals and throughput of a run
+    static void printSummary(const BatchSummary& summary);
+};
+
+#endif // BATCHPROCESSOR_H
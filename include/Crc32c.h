@@ -0,0 +1,17 @@
+// include/Crc32c.h
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+
+// CRC32C (Castagnoli) checksum of size bytes. Pass the result of a previous
+// call as crc to checksum data that is split across several buffers.
+// Uses the SSE4.2 crc32 instruction when the CPU has it, and a table-driven
+// version otherwise; both give the same result.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// Whether crc32c runs on the SSE4.2 instruction
+bool crc32cIsHardware();
+
+#endif // CRC32C_H
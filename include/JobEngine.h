@@ -0,0 +1,99 @@
+// include/JobEngine.h
+#ifndef JOBENGINE_H
+#define JOBENGINE_H
+
+#include "Account.h"   // For AccountType
+#include "Analytics.h" // For ACCOUNT_TYPE_COUNT
+#include "Money.h"
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+#include <string>
+#include <vector>
+
+// What a scheduled job does to every account of one type. A run applies the
+// interest first, then the installment; each change it makes is a separate
+// posting. Interest is a deposit. A negative installment (such as a loan
+// EMI) is a withdrawal from the account itself; a positive one (such as a
+// recurring deposit installment) is a transfer into the account from its
+// funding account (Account::getFundingAccountKey), and is skipped for an
+// account that has none.
+struct JobRule {
+    AccountType type;
+    uint32_t annualRateBasisPoints; // Yearly interest on a positive balance in 1/100 percent, paid as 1/12 per run
+    Money installment;              // Debited every run if negative, moved in from the funding account if positive
+
+    JobRule() : type(AccountType::UNKNOWN), annualRateBasisPoints(0), installment() {}
+    JobRule(AccountType t, uint32_t rate, Money amount) : type(t), annualRateBasisPoints(rate), installment(amount) {}
+};
+
+// What a run did to the accounts of one type
+struct JobTypeTotals {
+    size_t accounts; // Accounts of the type that a rule covered
+    size_t postings; // Balance changes made (a funded installment makes two, one on the funding account)
+    size_t skipped;  // Debits refused for insufficient funds, credits that would overflow, or unfunded installments
+    Money credited;
+    Money debited;   // Positive: the sum of the amounts taken, from funding accounts included
+
+    JobTypeTotals() : accounts(0), postings(0), skipped(0), credited(), debited() {}
+};
+
+// Totals and timing of a run
+struct JobSummary {
+    JobTypeTotals byType[ACCOUNT_TYPE_COUNT];
+    uint32_t period;   // YYYYMM
+    bool refused;      // The period was already applied, so nothing ran
+    size_t accounts;   // Accounts in the store
+    size_t postings;
+    size_t skipped;
+    bool persisted;    // The postings were journaled (otherwise every change was rolled back)
+    bool logged;       // Their log rows were written (otherwise the rest are held in memory and retried)
+    double groupMs;    // Sorting each shard's accounts by type
+    double applyMs;    // Running the rules
+    double journalMs;  // Writing and syncing the journal group
+    double logMs;      // Writing the transaction log rows
+    double seconds;    // Wall-clock time of the whole run
+
+    JobSummary() : period(0), refused(false), accounts(0), postings(0), skipped(0), persisted(false), logged(false),
+                   groupMs(0.0), applyMs(0.0), journalMs(0.0), logMs(0.0), seconds(0.0) {}
+};
+
+// Runs periodic jobs such as month-end interest accrual, recurring deposit
+// installments and loan EMI debits over the whole account store in one pass.
+//
+// Every shard is locked exclusively for the run, so other postings wait
+// (as they do for PostingEngine::applyBatch). Each shard's accounts are
+// grouped by type, then every rule runs as a loop over the accounts of its
+// type; shards are handled in parallel. Funded installments touch a second
+// account, possibly in another shard, so they run afterwards on one thread.
+// All the resulting balance changes are journaled as one all-or-nothing
+// group with one fsync, so after a crash either the whole run or none of it
+// is recovered, and their transaction log rows are written with one bulk
+// append.
+//
+// Each run is for a period (a month). The group ends with a marker record
+// naming the period, so the period is recorded exactly when the postings
+// commit, and a period no later than the last one applied is refused.
+class JobEngine {
+private:
+    // Private constructor to prevent instantiation (it's a utility class)
+    JobEngine() = delete;
+
+public:
+    // The month-end rules: interest on savings and deposit accounts, the
+    // recurring deposit installment and the loan EMI
+    static std::vector<JobRule> monthEndRules();
+
+    // Apply the rules to every account for a period (YYYYMM). Returns false,
+    // leaving every balance as it was, if the period is not after the last
+    // one applied or the postings could not be journaled.
+    static bool run(const std::vector<JobRule>& rules, uint32_t period, JobSummary& summary);
+
+    // Parse a period written as "YYYY-MM" into YYYYMM, and format one back
+    static bool parsePeriod(const std::string& text, uint32_t& period);
+    static std::string formatPeriod(uint32_t period);
+
+    // Print the per-type totals and the timing of a run
+    static void printSummary(const JobSummary& summary);
+};
+
+#endif // JOBENGINE_H
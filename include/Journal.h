@@ -0,0 +1,111 @@
+// include/Journal.h
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Money.h"
+#include <cstdint>    // For uint64_t, UINT64_MAX
+#include <cstdio>     // For std::FILE
+#include <functional> // For std::function
+#include <mutex>      // For std::mutex
+#include <string>
+
+// One journal entry: a balance change on a single account.
+// The resulting balance is stored alongside the delta so that replaying
+// an entry is idempotent (a journal replayed over an already-checkpointed
+// accounts file leaves the balances unchanged).
+//
+// Records are written in groups that must be applied all-or-nothing (for
+// example both legs of a transfer). Every record of a group but the last
+// has 'following' set to the number of records after it in the group; the
+// last has 0. Replay discards a group whose last record never reached disk.
+struct JournalRecord {
+    uint64_t accountKey; // Packed 10-digit account number
+    Money delta;         // Signed change applied to the balance
+    Money newBalance;    // Balance after the change
+    uint32_t following;  // Records still to come in this group
+    uint32_t reserved;
+};
+
+// A record with this key changes no balance: it marks the group it ends as
+// the month-end job run for the period (YYYYMM) held in newBalance's paisa.
+// Packed account numbers have ten digits, so they never reach it.
+const uint64_t JOURNAL_PERIOD_KEY = UINT64_MAX;
+
+// Journal files start with this header.
+struct JournalHeader {
+    char magic[8];    // JOURNAL_MAGIC
+    uint32_t version; // JOURNAL_VERSION
+    uint32_t recordSize;
+};
+
+const char JOURNAL_MAGIC[8] = {'B', 'M', 'S', 'J', 'R', 'N', 'L', '\0'};
+const uint32_t JOURNAL_VERSION = 3;
+
+// Append-only write-ahead journal of balance deltas.
+// Every append is written through to the OS immediately; the file is
+// fsync'd once per group of 'groupSize' appends (group commit), or when
+// a group asks for it. A checkpoint folds the journal into the accounts file
+// and then calls reset() to empty it.
+//
+// A checkpoint that runs while postings continue instead calls rotate() at
+// the instant of its snapshot: the records so far move to a second file
+// (path + ".prev") and later appends start a new one. Once the snapshot is
+// on disk, discardRotated() deletes the rotated file. Until then replay()
+// reads the rotated file before the current one.
+// All public methods are safe to call from several threads at once.
+class Journal {
+private:
+    mutable std::mutex mutex;
+    std::string path;
+    std::string rotatedPath; // Records from before the snapshot of a running checkpoint
+    std::FILE* file;      // Opened lazily on first append
+    size_t groupSize;     // Appends per fsync
+    size_t pendingSync;   // Appends since the last fsync
+    size_t recordCount;   // Records currently in the journal file
+    bool torn;            // A failed group could not be cut off; appends are refused until reset()
+
+    bool openForAppend();
+    bool syncLocked();
+    size_t replayRotated(const std::function<void(const JournalRecord&)>& apply);
+
+public:
+    Journal(const std::string& filePath, size_t recordsPerSync);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Append records as one all-or-nothing group with a single write, setting
+    // their 'following' fields. If syncNow is set the group is fsync'd before
+    // returning; otherwise it counts towards the normal group-commit batch.
+    // Returns false, with the group cut off the file again, if the write, the
+    // flush or a due fsync failed.
+    bool appendGroup(JournalRecord* records, size_t count, bool syncNow);
+
+    // Read every complete group in order and pass its records to apply.
+    // A torn record or unfinished group at the tail (from a crash mid-write)
+    // is discarded.
+    // Returns the number of records replayed; if it is non-zero the caller
+    // should checkpoint.
+    size_t replay(const std::function<void(const JournalRecord&)>& apply);
+
+    // Discard all records, rotated ones included (called after a successful checkpoint)
+    void reset();
+
+    // Move the records so far to the rotated file and start an empty journal.
+    // Only one rotated file can exist: returns false if an earlier one has
+    // not been discarded yet, or if the file could not be moved.
+    bool rotate();
+
+    // Force the rotated records to stable storage (appends since the last
+    // group fsync are only written through to the OS)
+    void syncRotated();
+
+    // Delete the rotated records once the snapshot they lead up to is saved
+    void discardRotated();
+
+    // Number of records written since the last reset or rotation
+    size_t size() const;
+};
+
+#endif // JOURNAL_H
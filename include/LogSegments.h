@@ -0,0 +1,180 @@
+// include/LogSegments.h
+#ifndef LOGSEGMENTS_H
+#define LOGSEGMENTS_H
+
+#include "Transaction.h"
+#include <atomic>             // For std::atomic
+#include <condition_variable> // For std::condition_variable
+#include <cstdint>            // For fixed-width integer types
+#include <deque>
+#include <functional>         // For std::function
+#include <memory>             // For std::unique_ptr
+#include <mutex>              // For std::mutex
+#include <shared_mutex>       // For std::shared_mutex, std::shared_lock
+#include <string>
+#include <thread>             // For std::thread
+#include <vector>
+
+class TransactionLogger;
+
+// The transaction log is split into segments. New rows go to the active
+// segment (data/logs.dat, Transaction records, indexed by StatementIndex).
+// When it grows past a size limit or a row from a new day arrives, it is
+// closed: renamed into the segment directory as NNNNNNNN.dat and then sealed
+// in the background into NNNNNNNN.seg, an immutable columnar file:
+//
+//   [SegmentHeader][block x blockCount][RowRange x blockCount][SegmentBlock x blockCount]
+//
+// Rows are sorted by account (keeping their logged order within an
+// account) and stored in blocks of up to SEGMENT_BLOCK_ROWS rows. Each
+// block holds four columns: account keys, type codes, amounts in paisa and
+// timestamps in epoch seconds. The block directory at the end records each
+// block's key range, so one account's rows are found by binary search and
+// only the blocks holding them are decoded. Compressed segments store the
+// columns as delta/zigzag varints instead of fixed-width values.
+//
+// Each block's RowRange (its key, timestamp and amount bounds) lets range
+// queries skip blocks that cannot match without decoding them, and the
+// header's timestamps let them skip whole segments.
+
+const char SEGMENT_MAGIC[8] = {'B', 'M', 'S', 'L', 'S', 'E', 'G', '\0'};
+const uint32_t SEGMENT_VERSION = 2;
+const uint32_t SEGMENT_BLOCK_ROWS = 4096;
+
+// Column encodings of a sealed segment
+enum class SegmentEncoding : uint32_t {
+    RAW = 0,    // Fixed-width little-endian values
+    VARINT = 1  // Keys and timestamps delta-coded, amounts zigzag, all as LEB128 varints
+};
+
+struct SegmentHeader {
+    char magic[8];           // SEGMENT_MAGIC
+    uint32_t version;        // SEGMENT_VERSION
+    uint32_t encoding;       // SegmentEncoding
+    uint64_t rowCount;
+    uint64_t blockCount;
+    int64_t firstTimestamp;  // Oldest row, epoch seconds
+    int64_t lastTimestamp;   // Newest row, epoch seconds
+    uint64_t directoryOffset; // File offset of the SegmentBlock array
+    uint64_t rangeOffset;    // File offset of the RowRange array
+};
+
+struct SegmentBlock {
+    uint64_t firstKey; // Smallest account key in the block
+    uint64_t lastKey;  // Largest account key in the block
+    uint64_t offset;   // File offset of the block's columns
+    uint32_t size;     // Bytes of column data
+    uint32_t rows;
+};
+
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader layout changed");
+static_assert(sizeof(SegmentBlock) == 32, "SegmentBlock layout changed");
+
+// When the active segment is closed, and how closed segments are stored
+struct SegmentPolicy {
+    uint64_t maxActiveBytes; // Close the active segment at this size; 0 for no limit
+    bool rollDaily;          // Close it when the first row of a new day arrives
+    bool compress;           // Seal with the VARINT encoding instead of RAW
+
+    SegmentPolicy() : maxActiveBytes(64ULL * 1024 * 1024), rollDaily(true), compress(true) {}
+};
+
+class LogSegments {
+private:
+    struct Segment; // A mapped .seg file
+
+    std::string activePath;
+    std::string directory;
+    SegmentPolicy policy;
+
+    mutable std::shared_mutex segmentsMutex; // Readers share it; closing and publishing take it exclusively
+    std::vector<std::unique_ptr<Segment>> segments; // Sealed segments, oldest first
+    uint64_t nextNumber;                 // Number of the next segment to close
+    std::atomic<uint32_t> activeDay;     // YYYYMMDD of the active segment's rows, 0 if unknown
+    std::mutex rollMutex;                // Serializes closing the active segment
+
+    // Background sealing of closed segments
+    std::mutex sealMutex;
+    std::condition_variable sealChanged;
+    std::deque<uint64_t> toSeal; // Closed segment numbers waiting to be sealed
+    size_t sealing;              // Segments taken off toSeal but not yet published
+    bool stopping;
+    std::thread sealer;
+
+    std::string pathFor(uint64_t number, const char* extension) const;
+    std::string closedPathFor(uint64_t number) const;
+    bool mapSegment(uint64_t number);
+    bool rollOverLocked(TransactionLogger& logger, uint32_t day);
+    static bool visitMatches(const Segment& segment, const RowFilter& filter,
+                             const std::function<bool(const Transaction&)>& visit, size_t& decoded, size_t& skipped);
+    void sealerLoop();
+    bool sealOne(uint64_t number);
+
+public:
+    LogSegments(const std::string& activeLogFile, const std::string& segmentDirectory, const SegmentPolicy& segmentPolicy);
+    ~LogSegments();
+
+    LogSegments(const LogSegments&) = delete;
+    LogSegments& operator=(const LogSegments&) = delete;
+
+    // Map the sealed segments and queue any closed but unsealed ones (e.g. after a crash)
+    bool open();
+
+    // Move a CSV log from before the binary format into the segment
+    // directory and queue it for sealing, so its rows stay in statements
+    bool adoptLegacyLog(const std::string& csvPath);
+
+    // Close the active segment if the policy says a row logged at timestamp
+    // (epoch seconds) should start a new one. Call before appending that row.
+    void rollOverIfDue(TransactionLogger& logger, int64_t timestamp);
+
+    // Close the active segment now
+    bool rollOver(TransactionLogger& logger);
+
+    // Hold while reading the active segment and the sealed ones together, so
+    // that no rows move between them mid-read. Waits for pending seals first;
+    // a segment that could not be sealed stays pending and is retried each
+    // second, so readers never go ahead without its rows.
+    std::shared_lock<std::shared_mutex> lockForReading();
+
+    // Visit one account's rows in the sealed segments, newest first, until visit
+    // returns false. Segments and blocks holding no row within bounds (whose
+    // account is ignored) are skipped, so visit may see rows outside bounds
+    // but never misses one inside. With keepNewer, nothing is skipped down to
+    // the oldest block that may hold a row within bounds, and the walk stops
+    // after it: every row newer than the oldest possible match is visited,
+    // whatever its timestamp (for carrying a balance back through them).
+    // The caller holds lockForReading().
+    void forEachAccountRow(uint64_t accountKey, const std::function<bool(const Transaction&)>& visit,
+                           const RowFilter& bounds = RowFilter(), bool keepNewer = false) const;
+
+    // Visit the sealed rows that match filter, oldest segment first and grouped
+    // by account within a segment, until visit returns false. Only blocks whose
+    // RowRange may hold a match are decoded. The caller holds lockForReading().
+    void forEachMatchingRow(const RowFilter& filter, const std::function<bool(const Transaction&)>& visit) const;
+
+    // forEachMatchingRow, newest segment first. Before each segment that may
+    // hold a match, enter is called with the segment's oldest and newest
+    // timestamps; returning false skips the segment. Lets a query for the
+    // newest rows pass over segments too old to hold any of them.
+    void forEachRecentMatchingRow(const RowFilter& filter, const std::function<bool(int64_t, int64_t)>& enter,
+                                  const std::function<bool(const Transaction&)>& visit) const;
+
+    // Visit every sealed row, oldest segment first and grouped by account within
+    // a segment, decoding one block at a time. The caller holds lockForReading().
+    void forEachRow(const std::function<bool(const Transaction&)>& visit) const;
+
+    // Number of sealed segments (takes the lock itself)
+    size_t segmentCount() const;
+
+    // Number the active segment will be sealed under; it changes at each
+    // rollover (takes the lock itself)
+    uint64_t activeSegment() const;
+
+    // Convert a closed segment (a binary log, or a legacy CSV log if the name
+    // ends in ".csv") into a sealed segment file. Returns false, leaving no
+    // segment file behind, if it cannot be read or written.
+    static bool seal(const std::string& closedPath, const std::string& segmentPath, bool compress);
+};
+
+#endif // LOGSEGMENTS_H
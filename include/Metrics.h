@@ -0,0 +1,175 @@
+// include/Metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>  // For std::atomic
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t, int64_t
+#include <ostream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc
+#else
+#include <chrono>      // For std::chrono::steady_clock
+#endif
+
+// Lightweight process metrics: counters, gauges and latency histograms.
+//
+// Metrics are declared as static objects next to the code they measure and
+// registered by name when the program starts. Counters and histograms are
+// kept per thread: each thread owns a shard that only it writes, so an event
+// is a plain load and store to memory no other core touches (no locked
+// instruction, no shared cache line). Exports add the shards together; the
+// shard of an exited thread is folded into a retired total first (events
+// the thread records after that, while it exits, are not counted).
+//
+// Histograms count durations in clock ticks (the TSC on x86, nanoseconds
+// elsewhere) in power-of-two buckets, converted to seconds on export. Reading
+// the clock costs more than recording, so a histogram for a sub-microsecond
+// path can time only one event in sampleEvery; pair it with a counter for
+// the exact event count.
+
+static const size_t MAX_COUNTERS = 64;
+static const size_t MAX_HISTOGRAMS = 32;
+static const size_t HISTOGRAM_BUCKETS = 32;
+static const unsigned HISTOGRAM_MIN_SHIFT = 6; // Bucket 0 holds durations under 2^6 ticks
+
+// One thread's counter and histogram cells. The extra last slot of each
+// array absorbs metrics registered past the limit.
+struct MetricShard {
+    std::atomic<uint64_t> counters[MAX_COUNTERS + 1];
+    std::atomic<uint64_t> buckets[MAX_HISTOGRAMS + 1][HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> tickSums[MAX_HISTOGRAMS + 1];
+    uint32_t sampleClock[MAX_HISTOGRAMS + 1]; // Events seen, for sampled histograms
+};
+
+class Metrics {
+private:
+    // Attach a new shard to the calling thread and return it
+    static MetricShard& attachThread();
+
+    // Private constructor to prevent instantiation (it's a utility class)
+    Metrics() = delete;
+
+public:
+    // The calling thread's shard (null until its first event)
+    static inline thread_local MetricShard* localShard = nullptr;
+
+    static MetricShard& shard() {
+        MetricShard* s = localShard;
+        return s ? *s : attachThread();
+    }
+
+    // Add to a cell only this thread writes: no read-modify-write instruction needed
+    static void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+        cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Current time in histogram ticks
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Registration, used by the metric constructors; returns the metric's slot
+    static size_t registerCounter(const char* name, const char* help);
+    static size_t registerHistogram(const char* name, const char* help, uint32_t sampleEvery);
+    static void registerGauge(const char* name, const char* help, const std::atomic<int64_t>* value);
+
+    // Write every metric in Prometheus text exposition format
+    static void writePrometheus(std::ostream& out);
+    // Write every metric as one JSON object
+    static void writeJson(std::ostream& out);
+    // Write every metric to a file: JSON if the path ends in ".json", Prometheus text otherwise.
+    // Written to a temporary file and renamed, so a scraper never reads half a dump.
+    static bool dumpToFile(const std::string& path);
+
+    // Dump to path when the program exits and whenever it receives SIGUSR1.
+    // Call at the start of main, before any other thread is started, so that
+    // every thread inherits SIGUSR1 blocked and only the dump thread takes it.
+    static void enableDump(const std::string& path);
+};
+
+// Monotonic count of events
+class Counter {
+private:
+    size_t slot;
+
+public:
+    Counter(const char* name, const char* help) : slot(Metrics::registerCounter(name, help)) {}
+
+    void add(uint64_t n = 1) const {
+        Metrics::bump(Metrics::shard().counters[slot], n);
+    }
+};
+
+// A value that goes up and down (e.g. accounts in memory); shared, not per thread
+class Gauge {
+private:
+    std::atomic<int64_t> value;
+
+public:
+    Gauge(const char* name, const char* help) : value(0) {
+        Metrics::registerGauge(name, help, &value);
+    }
+
+    void set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    void add(int64_t d) { value.fetch_add(d, std::memory_order_relaxed); }
+};
+
+// Distribution of durations
+class Histogram {
+private:
+    size_t slot;
+    uint32_t sampleMask; // sampleEvery - 1
+
+public:
+    // sampleEvery is rounded down to a power of two; 1 times every event
+    Histogram(const char* name, const char* help, uint32_t sampleEvery = 1);
+
+    // Whether the calling thread should time its current event
+    bool sampleNext() const {
+        if (sampleMask == 0) {
+            return true;
+        }
+        uint32_t& clock = Metrics::shard().sampleClock[slot];
+        return (clock++ & sampleMask) == 0;
+    }
+
+    void record(uint64_t elapsedTicks) const {
+        unsigned bits = 64 - static_cast<unsigned>(__builtin_clzll(elapsedTicks | 1));
+        size_t bucket = bits > HISTOGRAM_MIN_SHIFT ? bits - HISTOGRAM_MIN_SHIFT : 0;
+        if (bucket >= HISTOGRAM_BUCKETS) {
+            bucket = HISTOGRAM_BUCKETS - 1;
+        }
+        MetricShard& s = Metrics::shard();
+        Metrics::bump(s.buckets[slot][bucket], 1);
+        Metrics::bump(s.tickSums[slot], elapsedTicks);
+    }
+};
+
+// Times the enclosing scope into a histogram (if this event is sampled)
+class ScopedTimer {
+private:
+    const Histogram& histogram;
+    bool timed;
+    uint64_t start;
+
+public:
+    explicit ScopedTimer(const Histogram& h)
+        : histogram(h), timed(h.sampleNext()), start(timed ? Metrics::ticks() : 0) {}
+    ~ScopedTimer() {
+        if (timed) {
+            histogram.record(Metrics::ticks() - start);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,143 @@
+// include/Money.h
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cstddef>     // For size_t
+#include <cstdint>     // For int64_t
+#include <ostream>     // For std::ostream
+#include <string>
+#include <string_view> // For std::string_view
+
+// An amount of money held as a whole number of paisa (1/100 of a taka).
+// Integer arithmetic keeps balances exact: the stored balance always equals
+// the sum of the logged postings, which is not true of double.
+class Money {
+private:
+    int64_t paisa;
+
+    constexpr explicit Money(int64_t minorUnits) : paisa(minorUnits) {}
+
+public:
+    // Longest formatted amount, e.g. "-92233720368547758.08"
+    static constexpr size_t MAX_TEXT_LENGTH = 21;
+
+    constexpr Money() : paisa(0) {}
+
+    static constexpr Money fromPaisa(int64_t minorUnits) { return Money(minorUnits); }
+    constexpr int64_t toPaisa() const { return paisa; }
+
+    // Checked arithmetic: returns false (leaving result untouched) on overflow
+    constexpr bool add(Money other, Money& result) const {
+        int64_t sum = 0;
+        if (__builtin_add_overflow(paisa, other.paisa, &sum)) {
+            return false;
+        }
+        result = Money(sum);
+        return true;
+    }
+
+    constexpr bool subtract(Money other, Money& result) const {
+        int64_t difference = 0;
+        if (__builtin_sub_overflow(paisa, other.paisa, &difference)) {
+            return false;
+        }
+        result = Money(difference);
+        return true;
+    }
+
+    constexpr bool multiply(int64_t factor, Money& result) const {
+        int64_t product = 0;
+        if (__builtin_mul_overflow(paisa, factor, &product)) {
+            return false;
+        }
+        result = Money(product);
+        return true;
+    }
+
+    // Parse "123", "123.4", "123.45" or "-123.45". More than two decimal
+    // places, stray characters and out-of-range values are rejected.
+    static constexpr bool parse(std::string_view text, Money& result) {
+        size_t i = 0;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+            negative = text[i] == '-';
+            ++i;
+        }
+        int64_t units = 0;
+        size_t digits = 0;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits) {
+            if (__builtin_mul_overflow(units, int64_t(10), &units) ||
+                __builtin_add_overflow(units, int64_t(text[i] - '0'), &units)) {
+                return false;
+            }
+        }
+        int64_t fraction = 0;
+        size_t fractionDigits = 0;
+        if (i < text.size() && text[i] == '.') {
+            for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++fractionDigits) {
+                if (fractionDigits == 2) {
+                    return false; // Finer than one paisa
+                }
+                fraction = fraction * 10 + (text[i] - '0');
+            }
+        }
+        if (i != text.size() || digits + fractionDigits == 0) {
+            return false;
+        }
+        if (fractionDigits == 1) {
+            fraction *= 10;
+        }
+        int64_t total = 0;
+        if (__builtin_mul_overflow(units, int64_t(100), &total) ||
+            __builtin_add_overflow(total, fraction, &total)) {
+            return false;
+        }
+        result = Money(negative ? -total : total);
+        return true;
+    }
+
+    // Write the amount with exactly two decimals into out (at least
+    // MAX_TEXT_LENGTH bytes, not NUL-terminated). Returns the length.
+    constexpr size_t format(char* out) const {
+        char digits[MAX_TEXT_LENGTH] = {};
+        size_t n = 0;
+        // Work in unsigned so that INT64_MIN can be negated
+        uint64_t magnitude = paisa < 0 ? 0 - static_cast<uint64_t>(paisa) : static_cast<uint64_t>(paisa);
+        do {
+            digits[n++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0 || n < 3); // At least "0.00"
+        size_t length = 0;
+        if (paisa < 0) {
+            out[length++] = '-';
+        }
+        while (n > 2) {
+            out[length++] = digits[--n];
+        }
+        out[length++] = '.';
+        out[length++] = digits[1];
+        out[length++] = digits[0];
+        return length;
+    }
+
+    // Convenience for display code; allocates, unlike format()
+    std::string toString() const {
+        char text[MAX_TEXT_LENGTH];
+        return std::string(text, format(text));
+    }
+
+    constexpr bool operator==(Money other) const { return paisa == other.paisa; }
+    constexpr bool operator!=(Money other) const { return paisa != other.paisa; }
+    constexpr bool operator<(Money other) const { return paisa < other.paisa; }
+    constexpr bool operator<=(Money other) const { return paisa <= other.paisa; }
+    constexpr bool operator>(Money other) const { return paisa > other.paisa; }
+    constexpr bool operator>=(Money other) const { return paisa >= other.paisa; }
+};
+
+// Stream an amount as "123.45" without allocating
+inline std::ostream& operator<<(std::ostream& os, Money amount) {
+    char text[Money::MAX_TEXT_LENGTH];
+    return os.write(text, static_cast<std::streamsize>(amount.format(text)));
+}
+
+#endif // MONEY_H
@@ -0,0 +1,66 @@
+// include/PinHash.h
+#ifndef PINHASH_H
+#define PINHASH_H
+
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uint8_t, uint32_t, uint64_t
+#include <string_view> // For std::string_view
+
+// A PIN as it is kept in memory and on disk: PBKDF2-HMAC-SHA256 of the PIN
+// under a random per-account salt. The iteration count travels with the
+// hash, so raising the cost only affects PINs hashed from then on and older
+// hashes keep verifying.
+struct PinCredential {
+    uint32_t iterations; // PBKDF2 rounds; 0 means no PIN is set and nothing verifies
+    uint8_t salt[16];
+    uint8_t hash[32];
+};
+
+static_assert(sizeof(PinCredential) == 52, "PinCredential layout changed");
+
+// Hashing and verification of PINs.
+//
+// The KDF makes every check cost milliseconds on purpose. So that a client
+// re-authenticating within a session does not pay it each time, a successful
+// check is remembered in a bounded session cache: a fixed table of slots
+// holding the account key, an expiry time and a keyed tag of the PIN
+// (HMAC-SHA256 under a secret generated at startup, so the cache never holds
+// anything that can be checked offline). A later check for the same account
+// and PIN within SESSION_TTL_SECONDS costs one HMAC. A wrong PIN, an expired
+// entry, or an entry evicted by another account always falls back to the
+// full KDF, so the cache cannot speed up guessing.
+class PinHash {
+public:
+    static const uint32_t DEFAULT_ITERATIONS = 10000;
+    static const size_t SESSION_CACHE_SLOTS = 4096;
+    static const int64_t SESSION_TTL_SECONDS = 15 * 60;
+
+private:
+    // Private constructor to prevent instantiation (it's a utility class)
+    PinHash() = delete;
+
+public:
+    // Iteration count for newly hashed PINs (default DEFAULT_ITERATIONS)
+    static void setIterations(uint32_t iterations);
+    static uint32_t iterations();
+
+    // Hash a PIN under a fresh random salt with the current iteration count
+    static PinCredential hash(std::string_view pin);
+    // Hash a PIN under a given salt and iteration count
+    static PinCredential hash(std::string_view pin, const uint8_t salt[16], uint32_t iterations);
+
+    // Full KDF check of a PIN against a credential, comparing in constant time
+    static bool verify(const PinCredential& credential, std::string_view pin);
+
+    // verify(), answered from the session cache when this account recently
+    // passed a check with the same PIN
+    static bool verifyCached(uint64_t accountKey, const PinCredential& credential, std::string_view pin);
+
+    // Forget every cached session (e.g. for benchmarks that want the KDF path)
+    static void clearSessionCache();
+
+    // Compare two byte strings in time that depends only on their length
+    static bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t length);
+};
+
+#endif // PINHASH_H
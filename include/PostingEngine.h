@@ -0,0 +1,143 @@
+// include/PostingEngine.h
+#ifndef POSTINGENGINE_H
+#define POSTINGENGINE_H
+
+#include "Money.h"
+#include "Transaction.h" // For TransactionType, StatementQuery, StatementPage
+#include <cstdint> // For uint64_t, int64_t
+#include <mutex>   // For std::mutex
+#include <string>
+#include <vector>
+
+class Account;
+struct JournalRecord;
+
+// Outcome of a posting
+enum class PostingResult {
+    SUCCESS,
+    ACCOUNT_NOT_FOUND,
+    INVALID_AMOUNT,     // Zero, negative, or would overflow the balance
+    INSUFFICIENT_FUNDS,
+    SAME_ACCOUNT,       // Transfer source and destination are the same account
+    PERSIST_FAILED      // The journal, or the transaction log, could not be written; the balance is unchanged
+};
+
+// Helper function to describe a posting result to the user
+std::string postingResultToString(PostingResult result);
+
+// Kinds of posting that can be applied in a batch
+enum class PostingKind {
+    DEPOSIT,
+    WITHDRAWAL,
+    TRANSFER
+};
+
+// One posting in a batch; toAccount is only used by transfers
+struct PostingRequest {
+    PostingKind kind;
+    std::string account;
+    std::string toAccount;
+    Money amount;
+
+    PostingRequest() : kind(PostingKind::DEPOSIT), account(""), toAccount(""), amount() {}
+    PostingRequest(PostingKind k, const std::string& acc, const std::string& to, Money amt)
+        : kind(k), account(acc), toAccount(to), amount(amt) {}
+};
+
+// One transfer in a settlement batch
+struct TransferRequest {
+    std::string fromAccount;
+    std::string toAccount;
+    Money amount;
+
+    TransferRequest() : fromAccount(""), toAccount(""), amount() {}
+    TransferRequest(const std::string& from, const std::string& to, Money amt)
+        : fromAccount(from), toAccount(to), amount(amt) {}
+};
+
+// Thread-safe entry point for balance changes.
+//
+// Any number of threads may post at once. Each account maps to one of
+// LOCK_STRIPES mutexes by the hash of its number; a posting holds its
+// account's stripe while it updates the balance, journals it and logs it,
+// so postings to accounts on different stripes run in parallel. A transfer
+// locks both stripes in ascending stripe order (once if they coincide),
+// which rules out deadlock between opposing transfers. Both legs of a
+// transfer are journaled as one group, so after a crash either both or
+// neither are recovered.
+//
+// Every posting also holds the lock of its account's shard in shared mode
+// (a transfer holds both shards', lower shard first), so registration on
+// that shard and checkpoints (which take the locks exclusively) never
+// observe a half-applied posting. Postings on other shards are unaffected.
+class PostingEngine {
+private:
+    static const size_t LOCK_STRIPES = 1024;
+    static std::mutex stripes[LOCK_STRIPES];
+
+    // An account resolved from its number while its shard lock is held
+    struct Target {
+        Account* account;
+        uint64_t key;
+    };
+
+    // Find the account for target.key; the caller packs the number and locks its shard
+    static bool resolve(Target& target);
+    static size_t stripeOf(uint64_t key);
+
+    // Apply a signed change to a locked account in memory and describe it in rec
+    static PostingResult apply(const Target& target, Money delta, JournalRecord& rec);
+
+    // Put back the balance an applied change replaced
+    static void revert(const Target& target, const JournalRecord& rec);
+
+    // Write the transaction log row for an applied change; returns false if
+    // the row is held until the logs file can be written again
+    static bool logPosting(const Target& target, Money delta, TransactionType type, int64_t timestamp);
+
+    // Journal applied changes as one group, reverting them all if that fails.
+    // Also refuses them while the logger is holding as many unwritten rows as
+    // it may, so every journaled change keeps its log row.
+    static PostingResult persist(const Target* targets, JournalRecord* records, size_t count, bool syncNow);
+
+    // Validate and apply one batch request in memory, appending its legs
+    static PostingResult applyRequest(const PostingRequest& request, std::vector<Target>& targets,
+                                      std::vector<JournalRecord>& records);
+
+    PostingEngine() = delete;
+
+public:
+    static PostingResult deposit(const std::string& accNum, Money amount);
+    static PostingResult withdraw(const std::string& accNum, Money amount);
+
+    // Same, also reporting the balance the posting left (set only on success),
+    // read under the same lock so no other posting lands in between
+    static PostingResult deposit(const std::string& accNum, Money amount, Money& newBalance);
+    static PostingResult withdraw(const std::string& accNum, Money amount, Money& newBalance);
+
+    // Move money between two accounts under both accounts' locks
+    static PostingResult transfer(const std::string& fromAccNum, const std::string& toAccNum, Money amount);
+
+    // Apply many postings in one pass, in order, with a single journal commit
+    // (one write and one fsync). Each posting succeeds or fails on its own;
+    // results[i] receives the outcome of requests[i]. If the commit itself
+    // fails, every posting in the batch is rolled back and reported as
+    // PERSIST_FAILED. Other postings wait while a batch is applied.
+    // Returns the number of postings that succeeded.
+    static size_t applyBatch(const std::vector<PostingRequest>& requests, std::vector<PostingResult>& results);
+
+    // applyBatch for a batch made up only of transfers
+    static size_t settleBatch(const std::vector<TransferRequest>& transfers, std::vector<PostingResult>& results);
+
+    // Read a balance consistently with concurrent postings
+    static bool getBalance(const std::string& accNum, Money& balance);
+
+    // Read one page of an account's statement with the balance after each
+    // row (see findStatementPage). The balance and the end of the log are
+    // read together under the account's locks, which are released before
+    // any row is read; rows logged after that point are ignored. Returns
+    // false if the account does not exist or the query is malformed.
+    static bool statement(const std::string& accNum, const StatementQuery& query, StatementPage& page);
+};
+
+#endif // POSTINGENGINE_H
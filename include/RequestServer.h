@@ -0,0 +1,126 @@
+// include/RequestServer.h
+#ifndef REQUESTSERVER_H
+#define REQUESTSERVER_H
+
+#include <atomic>             // For std::atomic
+#include <chrono>             // For std::chrono::steady_clock
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For size_t
+#include <cstdint>            // For uint32_t
+#include <deque>
+#include <memory>             // For std::shared_ptr
+#include <mutex>              // For std::mutex
+#include <string>
+#include <string_view>        // For std::string_view
+#include <thread>             // For std::thread
+#include <unordered_map>
+#include <vector>
+
+// Settings for service mode
+struct ServerOptions {
+    std::string socketPath; // Unix domain socket to listen on; empty serves stdin/stdout
+    size_t workers;         // Worker threads; 0 picks two per hardware thread
+    size_t maxPipeline;     // Requests queued on one connection before it stops being read
+
+    ServerOptions() : socketPath(""), workers(0), maxPipeline(1024) {}
+};
+
+// Serves account operations to many clients at once. One request per line,
+// words separated by spaces; one response per request, in request order:
+//
+//   login <accountNumber> <pin>   -> OK <owner name>
+//   balance                       -> OK <balance>
+//   deposit <amount>              -> OK <balance after the deposit>
+//   withdraw <amount>             -> OK <balance after the withdrawal>
+//   statement [<rows>]            -> OK <n>, then n lines "<YYYY-MM-DD HH:MM:SS>,<type>,<amount>"
+//                                    (the latest rows oldest first; every row if rows is omitted)
+//   logout                        -> OK
+//   quit                          -> OK, then the connection is closed
+//
+// A request that fails gets "ERR <reason>" instead. Every request but login
+// acts on the account logged in on the same connection.
+//
+// PIN guessing is limited two ways. A connection is closed after its third
+// failed login, answered "ERR Too many failed logins". An account that
+// fails five logins in a row, on any connections, refuses every login for
+// 15 minutes; those refusals get the same answer as a wrong PIN.
+//
+// One I/O thread accepts connections and reads, splits, parses and validates
+// requests, then queues them on their connection. A connection with queued
+// requests is handed to the worker pool; the worker takes every request
+// queued so far, runs them in order through UserAuth and the posting engine,
+// and writes all their responses with one write. A connection is only ever
+// on one worker at a time, so a client may pipeline (send many requests
+// without waiting for the responses) and still see them run in order, while
+// different connections run in parallel. A connection with maxPipeline
+// requests queued, or with responses it is not reading, is not read from
+// until it catches up.
+class RequestServer {
+private:
+    struct Request;
+    struct Connection;
+
+    ServerOptions options;
+    int listenFd;
+    int epollFd;
+    int wakeFds[2];                 // Pipe that wakes the I/O thread: stop() and connections needing attention
+    std::atomic<bool> stopping;
+
+    std::vector<std::thread> workers;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<std::shared_ptr<Connection>> ready;     // Connections with requests to run
+    std::vector<std::shared_ptr<Connection>> attention; // Released by workers, for the I/O thread to look at
+    bool workersStopping;
+
+    // Consecutive failed logins of an account, on every connection
+    struct LoginFailures {
+        uint32_t count;
+        std::chrono::steady_clock::time_point lockedUntil; // Logins are refused until then
+    };
+    std::mutex loginMutex;
+    std::unordered_map<uint64_t, LoginFailures> loginFailures; // Only accounts that failed since their last login
+
+    // I/O thread
+    bool serveSocket();
+    bool serveStream(int inFd, int outFd);
+    void acceptConnections(std::unordered_map<Connection*, std::shared_ptr<Connection>>& connections);
+    void readFrom(const std::shared_ptr<Connection>& conn);
+    void receive(const std::shared_ptr<Connection>& conn, const char* data, size_t size);
+    void watchLocked(Connection& conn);
+    std::vector<std::shared_ptr<Connection>> takeAttention(); // Also drains the wake pipe
+
+    // Worker threads
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop();
+    void runRequests(const std::shared_ptr<Connection>& conn);
+    void execute(Connection& conn, const Request& request, std::string& out);
+    bool loginAllowed(uint64_t key);
+    void recordLogin(uint64_t key, bool succeeded);
+
+    // Either side
+    void schedule(const std::shared_ptr<Connection>& conn);
+    void wake();
+    static void flushLocked(Connection& conn);
+    static bool finishedLocked(const Connection& conn);
+    static Request parseRequest(std::string_view line);
+
+public:
+    explicit RequestServer(const ServerOptions& serverOptions);
+    ~RequestServer();
+
+    RequestServer(const RequestServer&) = delete;
+    RequestServer& operator=(const RequestServer&) = delete;
+
+    // Serve until stop() is called or, when serving stdin/stdout, until the
+    // input ends and every response is written. Returns false if the socket
+    // could not be set up.
+    bool run();
+
+    // Make run() return after the requests already read have been answered.
+    // Only writes to a pipe, so it is safe to call from a signal handler.
+    void stop();
+};
+
+#endif // REQUESTSERVER_H
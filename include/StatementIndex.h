@@ -0,0 +1,85 @@
+// include/StatementIndex.h
+#ifndef STATEMENTINDEX_H
+#define STATEMENTINDEX_H
+
+#include <cstddef>    // For size_t
+#include <cstdint>    // For fixed-width integer types
+#include <functional> // For std::function
+#include <string>
+
+struct Transaction;
+
+// Location of one row of the transaction log
+struct StatementIndexEntry {
+    uint64_t accountKey; // Packed account number of the row
+    uint64_t offset;     // Byte offset of the record in the log
+    uint64_t prev;       // Previous entry for the same account, or NO_ENTRY
+    uint32_t length;     // Length of the record in bytes
+    uint32_t reserved;
+};
+
+// Persistent secondary index over the transaction log, keyed by account.
+//
+// Two sidecar files sit next to the log:
+//   - the entries file: one StatementIndexEntry per log row, in log order.
+//     Entries for the same account are chained newest-to-oldest via 'prev'.
+//   - the heads file: a memory-mapped open-addressing table from account
+//     key to that account's newest entry, plus a header recording how many
+//     log bytes the index covers.
+//
+// A statement probes the heads table and follows the chain, so it touches
+// only that account's rows. If the sidecars are missing or lag behind the
+// log (e.g. after a crash), open() catches up with one streaming pass.
+class StatementIndex {
+public:
+    static const uint64_t NO_ENTRY;
+
+    StatementIndex(const std::string& logFile, const std::string& entriesFile, const std::string& headsFile);
+    ~StatementIndex();
+
+    StatementIndex(const StatementIndex&) = delete;
+    StatementIndex& operator=(const StatementIndex&) = delete;
+
+    // Open the sidecar files and bring them up to date with the log
+    bool open();
+    void close();
+
+    // Record a row that was just appended to the log
+    bool add(uint64_t accountKey, uint64_t offset, uint32_t length);
+
+    // Record count rows just appended to the log at firstOffset, with one
+    // write of their entries. As with add, the entries reach the file before
+    // any head points at them.
+    bool addBatch(const Transaction* rows, size_t count, uint64_t firstOffset);
+
+    // Discard the sidecars and rebuild them from the log in one streaming pass
+    bool rebuild();
+
+    // Visit the rows of an account newest first until visit returns false
+    void forEachRow(uint64_t accountKey,
+                    const std::function<bool(uint64_t offset, uint32_t length)>& visit) const;
+
+private:
+    struct HeadsHeader;
+    struct HeadSlot;
+
+    std::string logPath;
+    std::string entriesPath;
+    std::string headsPath;
+    int entriesFd;
+    int headsFd;
+    char* heads;       // Mapping of the heads file, or nullptr when closed
+    size_t headsSize;  // Size of the heads mapping in bytes
+
+    HeadsHeader& header() const;
+    HeadSlot* slots() const;
+    HeadSlot& probe(uint64_t accountKey) const;
+
+    bool createHeads(uint64_t capacity);
+    bool mapHeads();
+    bool growHeads();
+    bool addChunk(const Transaction* rows, size_t count, uint64_t firstOffset); // One write for the lot
+    bool catchUp(); // Index log rows beyond the covered byte count
+};
+
+#endif // STATEMENTINDEX_H
@@ -0,0 +1,48 @@
+// include/StringArena.h
+#ifndef STRINGARENA_H
+#define STRINGARENA_H
+
+#include <cstddef>     // For size_t
+#include <memory>      // For std::unique_ptr
+#include <mutex>       // For std::mutex
+#include <string_view> // For std::string_view
+#include <vector>
+
+// Bump allocator for strings that live as long as the program.
+// Strings are copied into large blocks and handed out as string_views, so
+// storing a million owner names costs a handful of heap allocations instead
+// of one per name. Nothing is freed individually; views stay valid until
+// the arena is destroyed.
+class StringArena {
+private:
+    static const size_t BLOCK_SIZE; // Bytes per block; larger requests get a block of their own
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor;      // Next free byte in the current block
+    size_t remaining;  // Free bytes left in the current block
+    size_t used;       // Bytes handed out
+    size_t reserved;   // Bytes held in blocks
+    mutable std::mutex mutex;
+
+    char* allocateLocked(size_t n);
+
+public:
+    StringArena();
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    // Copy text into the arena and return a view of the copy
+    std::string_view store(std::string_view text);
+
+    // Reserve n bytes for the caller to fill (e.g. a whole name table at once)
+    char* allocate(size_t n);
+
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+
+    // The arena that holds every account owner name
+    static StringArena& names();
+};
+
+#endif // STRINGARENA_H
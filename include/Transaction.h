@@ -2,28 +2,239 @@
 #ifndef TRANSACTION_H
 #define TRANSACTION_H
 
+#include "Money.h"
+#include <cstdint> // For uint8_t, int64_t
+#include <functional> // For std::function
+#include <limits>  // For std::numeric_limits
 #include <string>
+#include <type_traits> // For std::is_trivially_copyable
 #include <vector>
 
-// Structure to represent a single transaction
+// Kinds of logged transaction.
+// The underlying values are stored in sealed log segments, so only append new kinds.
+enum class TransactionType : uint8_t {
+    UNKNOWN,
+    DEPOSIT,
+    WITHDRAWAL,
+    TRANSFER_OUT,
+    TRANSFER_IN
+};
+
+// Helper function to convert TransactionType enum to the text used in the log
+std::string transactionTypeToString(TransactionType type);
+
+// Helper function to convert log text to TransactionType enum
+TransactionType stringToTransactionType(const std::string& typeStr);
+
+// One logged transaction, exactly as it is stored in the transaction log.
+// The record is fixed-size and trivially copyable, so the log can be read
+// straight out of a memory mapping (see TransactionLogReader) and no field
+// needs a heap allocation.
 struct Transaction {
-    std::string accountNumber;
-    std::string type; // e.g., "Deposit", "Withdrawal"
-    double amount;
-    std::string date; // YYYY-MM-DD HH:MM:SS
+    uint64_t accountKey;      // Packed account number (see packAccountNumber)
+    Money amount;             // Never negative; the type gives the direction
+    int64_t timestamp;        // Seconds since the epoch; shown as local YYYY-MM-DD HH:MM:SS
+    TransactionType type;
+    uint8_t reserved[7];      // Zero; pads the record to 32 bytes
 
     // Default constructor
-    Transaction() : accountNumber(""), type(""), amount(0.0), date("") {}
+    Transaction() : accountKey(0), amount(), timestamp(0), type(TransactionType::UNKNOWN), reserved() {}
 
     // Parameterized constructor
-    Transaction(const std::string& accNum, const std::string& t, double amt, const std::string& d)
-        : accountNumber(accNum), type(t), amount(amt), date(d) {}
+    Transaction(uint64_t key, TransactionType t, Money amt, int64_t ts)
+        : accountKey(key), amount(amt), timestamp(ts), type(t), reserved() {}
+};
+
+static_assert(sizeof(Transaction) == 32, "Transaction record layout changed");
+static_assert(std::is_trivially_copyable<Transaction>::value, "Transaction must stay a plain record");
+
+// The transaction log file is a TransactionLogHeader followed by Transaction records
+const char TRANSACTION_LOG_MAGIC[8] = {'B', 'M', 'S', 'T', 'X', 'L', 'O', 'G'};
+const uint32_t TRANSACTION_LOG_VERSION = 1;
+
+struct TransactionLogHeader {
+    char magic[8];       // TRANSACTION_LOG_MAGIC
+    uint32_t version;    // TRANSACTION_LOG_VERSION
+    uint32_t recordSize; // sizeof(Transaction)
+    uint64_t reserved[2];
+};
+
+static_assert(sizeof(TransactionLogHeader) == sizeof(Transaction), "Records must stay aligned after the header");
+
+// The smallest and largest account key, timestamp and amount in a run of
+// log rows (a block of a sealed segment or of the active log). Queries
+// compare it with their bounds to skip runs that cannot hold a match
+// without reading their rows. Stored as is in sealed segments.
+struct RowRange {
+    uint64_t firstKey;
+    uint64_t lastKey;
+    int64_t firstTimestamp; // Oldest row, epoch seconds
+    int64_t lastTimestamp;  // Newest row, epoch seconds
+    Money minAmount;
+    Money maxAmount;
+
+    // An empty range; include() widens it
+    RowRange()
+        : firstKey(std::numeric_limits<uint64_t>::max()), lastKey(0),
+          firstTimestamp(std::numeric_limits<int64_t>::max()), lastTimestamp(std::numeric_limits<int64_t>::min()),
+          minAmount(Money::fromPaisa(std::numeric_limits<int64_t>::max())),
+          maxAmount(Money::fromPaisa(std::numeric_limits<int64_t>::min())) {}
+
+    void include(const Transaction& row) {
+        if (row.accountKey < firstKey) firstKey = row.accountKey;
+        if (row.accountKey > lastKey) lastKey = row.accountKey;
+        if (row.timestamp < firstTimestamp) firstTimestamp = row.timestamp;
+        if (row.timestamp > lastTimestamp) lastTimestamp = row.timestamp;
+        if (row.amount < minAmount) minAmount = row.amount;
+        if (row.amount > maxAmount) maxAmount = row.amount;
+    }
 };
 
-// Function to log a transaction to the logs file
-void logTransaction(const Transaction& trans);
+static_assert(sizeof(RowRange) == 48, "RowRange layout changed");
+static_assert(std::is_trivially_copyable<RowRange>::value, "RowRange must stay a plain record");
+
+// Helper function to get the bit of a type in StatementQuery::types
+inline uint32_t transactionTypeBit(TransactionType type) {
+    return 1u << static_cast<uint32_t>(type);
+}
+
+// Options for narrowing down an account statement or an audit query
+struct StatementQuery {
+    std::string fromDate; // Inclusive lower bound, "YYYY-MM-DD" or "YYYY-MM-DD HH:MM:SS"; empty for none
+    std::string toDate;   // Inclusive upper bound in the same format (a bare date includes that whole day); empty for none
+    uint32_t types;       // transactionTypeBit of each type to include; 0 for every type
+    Money minAmount;      // Inclusive bounds on the amount
+    Money maxAmount;
+    size_t pageSize;      // Rows per page; 0 shows every matching row
+    size_t page;          // Page number, 0 being the most recent rows
+
+    StatementQuery()
+        : fromDate(""), toDate(""), types(0), minAmount(), maxAmount(Money::fromPaisa(std::numeric_limits<int64_t>::max())),
+          pageSize(0), page(0) {}
+};
+
+// A query reduced to plain comparisons, so rows are checked without
+// formatting their dates and whole blocks can be ruled out by their RowRange
+struct RowFilter {
+    bool allAccounts;
+    uint64_t accountKey;   // Only used if allAccounts is false
+    int64_t fromTimestamp; // Inclusive bounds, epoch seconds
+    int64_t toTimestamp;
+    uint32_t types;        // transactionTypeBit of each type to include
+    Money minAmount;
+    Money maxAmount;
+
+    // A filter that matches every row
+    RowFilter()
+        : allAccounts(true), accountKey(0), fromTimestamp(std::numeric_limits<int64_t>::min()),
+          toTimestamp(std::numeric_limits<int64_t>::max()), types(~0u), minAmount(Money::fromPaisa(std::numeric_limits<int64_t>::min())),
+          maxAmount(Money::fromPaisa(std::numeric_limits<int64_t>::max())) {}
+
+    bool matches(const Transaction& row) const {
+        return (allAccounts || row.accountKey == accountKey) && row.timestamp >= fromTimestamp &&
+               row.timestamp <= toTimestamp && (types & transactionTypeBit(row.type)) != 0 &&
+               row.amount >= minAmount && row.amount <= maxAmount;
+    }
+
+    // False only if no row within the range can match (types are not summarized)
+    bool mayMatch(const RowRange& range) const {
+        return (allAccounts || (range.firstKey <= accountKey && accountKey <= range.lastKey)) &&
+               range.firstTimestamp <= toTimestamp && range.lastTimestamp >= fromTimestamp &&
+               range.maxAmount >= minAmount && range.minAmount <= maxAmount;
+    }
+};
+
+// Function to turn a query on one account (or on every account if
+// accountNumber is empty) into a RowFilter. Returns false if a date or the
+// account number is malformed.
+bool compileQuery(const std::string& accountNumber, const StatementQuery& query, RowFilter& filter);
+
+// One statement row and the account's balance after it
+struct StatementRow {
+    Transaction transaction;
+    Money balance;
+};
+
+// One page of an account's statement
+struct StatementPage {
+    std::vector<StatementRow> rows; // Oldest first
+    bool hasMore;                   // Older matching rows exist (on later pages)
+
+    StatementPage() : rows(), hasMore(false) {}
+};
+
+// Function to log a transaction to the logs file. Returns false if the row
+// could not be written now: it is then held in memory and retried by later
+// flushes (see TransactionLogger).
+bool logTransaction(const Transaction& trans);
+
+// Function to log many transactions at once (such as the postings of a
+// batch job) with a single write that bypasses the logger's buffer.
+// Returns false, holding the unwritten rows, like logTransaction.
+bool logTransactions(const Transaction* rows, size_t count);
+
+// Function to check that count more rows can be logged, if need be by
+// holding them in memory. Callers check it before committing to a change
+// whose rows they will log, so that no row is dropped.
+bool transactionLogAccepts(size_t count);
+
+// Function to write any buffered transactions to the logs file; returns
+// false if some could not be written (they stay buffered for the next try)
+bool flushTransactionLog();
+
+// Function to open the logs file and bring its statement index up to date.
+// Happens on first use anyway; calling it at startup moves that work off
+// the first posting and lets it overlap with loading the accounts.
+void openTransactionLog();
+
+// Function to write every logged transaction, sealed segments first, to a
+// CSV file of "account,type,amount,YYYY-MM-DD HH:MM:SS" rows. Rows of a sealed
+// segment come out grouped by account; the active log's rows in logged order.
+bool exportTransactionLog(const std::string& csvPath);
+
+// Function to collect the transactions of an account that match a query, oldest first
+std::vector<Transaction> findStatementRows(const std::string& accountNumber, const StatementQuery& query);
+
+// Where the transaction log ended at one instant: the number the active
+// segment will be sealed under, and the bytes logged to it so far
+struct LogPosition {
+    uint64_t segment;
+    uint64_t bytes;
+
+    LogPosition() : segment(0), bytes(0) {}
+};
+
+// Function to note where the log ends now. Called while postings to an
+// account are kept out, the position follows every row of that account.
+LogPosition transactionLogEnd();
+
+// Function to collect one page of an account's statement with the balance
+// after each row. snapshot reads the account's balance and, at the same
+// instant, transactionLogEnd(), with postings to the account kept out
+// (PostingEngine::statement does this); it returns false if the account
+// does not exist. The rows are then read without the account's locks, and
+// the balance is carried back only through rows logged before that
+// position. If the active segment is closed in between, snapshot is called
+// again. Rows older than the query's start are never read; newer ones are
+// read only to carry the balance back.
+// Returns false if the query is malformed or snapshot fails.
+bool findStatementPage(const std::string& accountNumber, const StatementQuery& query,
+                       const std::function<bool(Money&, LogPosition&)>& snapshot, StatementPage& page);
+
+// Function to collect the transactions of every account that match a query,
+// oldest first, for audits. Sealed segments and blocks of the active log
+// whose RowRange rules out a match are skipped unread, so a narrow date or
+// amount range costs little however long the history is. Pages count back
+// from the newest match, as for statements.
+std::vector<Transaction> findTransactions(const StatementQuery& query);
 
 // Function to view all transactions for a specific account
 void viewAccountStatement(const std::string& accountNumber);
 
+// Function to view the transactions of an account that match a query, with the balance after each
+void viewAccountStatement(const std::string& accountNumber, const StatementQuery& query);
+
+// Function to view the transactions of every account that match a query
+void viewTransactions(const StatementQuery& query);
+
 #endif // TRANSACTION_H
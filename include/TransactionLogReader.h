@@ -0,0 +1,64 @@
+// include/TransactionLogReader.h
+#ifndef TRANSACTIONLOGREADER_H
+#define TRANSACTIONLOGREADER_H
+
+#include "Transaction.h"
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+#include <string>
+#include <vector>
+
+// Rows per block of the active log summarized by TransactionLogReader::blockRanges
+const size_t LOG_RANGE_ROWS = 4096;
+
+// Read-only memory mapping of a binary transaction log. Records are used
+// in place: iterating or filtering them copies nothing and touches only the
+// pages it reads. The record count is a snapshot taken at open(); refresh()
+// picks up rows appended since, remapping only if the file was replaced or
+// outgrew the mapping, so a long-lived reader stays cheap to bring current.
+// It also keeps a RowRange for each complete block of LOG_RANGE_ROWS rows,
+// computed once per block, so range queries can skip blocks of the log.
+class TransactionLogReader {
+private:
+    std::string path;
+    int fd;
+    const char* data;    // Mapping of the file, or nullptr
+    size_t mappedBytes;  // May exceed the file's length (see open())
+    size_t reserveBytes;
+    uint64_t inode;      // Identity of the mapped file, to notice a rollover
+    size_t count;        // Complete records after the header
+    std::vector<RowRange> ranges; // Of the complete blocks summarized so far; cleared when the file is replaced
+
+public:
+    TransactionLogReader();
+    ~TransactionLogReader();
+
+    TransactionLogReader(const TransactionLogReader&) = delete;
+    TransactionLogReader& operator=(const TransactionLogReader&) = delete;
+
+    // Map a log. Returns false if it cannot be opened or is not a transaction
+    // log. An empty file counts as an empty log; a torn last record is ignored.
+    // The mapping covers at least reserve bytes, so the log can grow that far
+    // before refresh() has to remap it.
+    bool open(const std::string& logPath, size_t reserve = 0);
+    void close();
+
+    // Bring the record count up to date with the file at the opened path
+    bool refresh();
+
+    size_t size() const;
+    const Transaction* begin() const;
+    const Transaction* end() const;
+
+    // The record at a byte offset in the file (as kept by the statement
+    // index), or nullptr if no whole record starts there
+    const Transaction* at(uint64_t offset) const;
+
+    // The RowRange of each complete block: entry b covers rows
+    // [b * LOG_RANGE_ROWS, (b + 1) * LOG_RANGE_ROWS). Rows past the last
+    // complete block have no entry. Blocks added since the last call are
+    // summarized first.
+    const std::vector<RowRange>& blockRanges();
+};
+
+#endif // TRANSACTIONLOGREADER_H
@@ -0,0 +1,111 @@
+// include/TransactionLogger.h
+#ifndef TRANSACTIONLOGGER_H
+#define TRANSACTIONLOGGER_H
+
+#include "Transaction.h"
+#include <atomic>             // For std::atomic
+#include <chrono>             // For std::chrono::milliseconds
+#include <condition_variable> // For std::condition_variable
+#include <mutex>              // For std::mutex
+#include <string>
+#include <thread>             // For std::thread
+#include <vector>
+
+class StatementIndex;
+
+// When the logger hands buffered rows to the operating system
+struct LoggerPolicy {
+    size_t flushEveryRecords;               // Flush once this many rows are buffered
+    std::chrono::milliseconds flushInterval; // Background flush period; 0 disables the flusher thread
+    bool syncOnFlush;                       // fdatasync after each flush
+    size_t bufferBytes;                     // Initial buffer capacity
+    size_t maxHeldRecords;                  // Rows kept in memory while the file cannot be written
+
+    LoggerPolicy()
+        : flushEveryRecords(256), flushInterval(50), syncOnFlush(false), bufferBytes(64 * 1024),
+          maxHeldRecords(64 * 1024) {}
+};
+
+// Long-lived, buffered writer for the transaction log (group commit).
+// The log is a TransactionLogHeader followed by Transaction records, which
+// append() copies into the buffer as they are.
+//
+// Durability: a row passed to append() sits in memory until the next flush,
+// which happens after flushEveryRecords rows, after flushInterval elapses,
+// on an explicit flush() and on destruction. A process crash can therefore
+// lose at most flushEveryRecords rows or flushInterval worth of rows. Once
+// flushed, rows survive a process crash; they survive a power loss only if
+// syncOnFlush is set.
+//
+// A write cut short (a full disk, an I/O error) never leaves part of a
+// record in the file: the file is truncated back to its last whole record,
+// so rows stay aligned. The rows that were not written stay buffered and
+// are retried by every later flush; rows appended meanwhile are held behind
+// them and append() returns false. Callers check accepts() before they
+// commit to new rows, which keeps the held rows within maxHeldRecords.
+class TransactionLogger {
+private:
+    struct PendingRow {
+        uint64_t accountKey;
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    std::string path;
+    LoggerPolicy policy;
+    StatementIndex* index;          // Updated after each flush, may be nullptr
+    int fd;                         // Log file, opened for appending
+    uint64_t fileSize;              // Bytes already in the file
+    std::vector<char> buffer;       // Rows not yet written
+    std::vector<PendingRow> pending; // Index entries for buffered rows
+    std::atomic<uint64_t> totalBytes; // fileSize plus buffered bytes, readable without the mutex
+    bool writeFailed;               // The last flush left rows in the buffer, or could not sync them
+    std::atomic<size_t> heldRows;   // Rows buffered behind a failed write, readable without the mutex
+
+    std::mutex mutex;
+    std::condition_variable wakeFlusher;
+    bool stopping;
+    std::thread flusher;
+
+    bool openFile();
+    void bufferLocked(const Transaction& trans);
+    size_t writeLocked(const char* data, size_t size); // Returns the bytes of whole records written
+    bool flushLocked(); // Returns false if rows are left in the buffer
+    void flusherLoop();
+
+public:
+    TransactionLogger(const std::string& logFile, const LoggerPolicy& loggerPolicy, StatementIndex* statementIndex);
+    ~TransactionLogger();
+
+    TransactionLogger(const TransactionLogger&) = delete;
+    TransactionLogger& operator=(const TransactionLogger&) = delete;
+
+    // Copy a transaction record into the buffer; flushes if the record threshold is reached.
+    // Returns false if the record is held because the file cannot be written
+    // (or, before the file was ever opened, not taken).
+    bool append(const Transaction& trans);
+
+    // Append many records at once: the buffer is flushed, then the records
+    // are written straight from rows with one write (no copy into the
+    // buffer) and indexed. Meant for bulk jobs; returns false if they could
+    // not all be written (the rest are held in the buffer, as by append()).
+    bool appendBatch(const Transaction* rows, size_t count);
+
+    // Write every buffered row to the file now; returns false if some could not be written
+    bool flush();
+
+    // Whether count more rows may be taken: always while no rows are held,
+    // otherwise only if they fit within maxHeldRecords
+    bool accepts(size_t count) const;
+
+    // Bytes in the log, including rows not yet flushed
+    uint64_t size() const;
+
+    // Flush, move the log file to closedPath and start a new, empty log
+    // (the statement index is rebuilt to match). Returns false if the
+    // buffered rows could not be written or the file could not be moved;
+    // the old log then stays active.
+    bool rollOver(const std::string& closedPath);
+};
+
+#endif // TRANSACTIONLOGGER_H
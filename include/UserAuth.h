@@ -3,18 +3,111 @@
 #define USERAUTH_H
 
 #include "Account.h"
-#include <vector>
+#include "AccountFile.h"
+#include "AccountIndex.h"
+#include "AccountNumberAllocator.h"
+#include "Journal.h"
+#include <atomic> // For std::atomic
+#include <deque>  // For pointer-stable account storage
+#include <functional> // For std::function
+#include <mutex>  // For std::unique_lock
+#include <shared_mutex> // For std::shared_mutex
 #include <string>
+#include <vector>
 
 class UserAuth {
+public:
+    // The account store is split into SHARD_COUNT shards by the top bits of
+    // each account number's hash. The count is part of the on-disk layout.
+    static const size_t SHARD_BITS = 4;
+    static const size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+
 private:
-    // Static member to hold all accounts in memory
-    static std::vector<Account> accounts;
-    static const std::string ACCOUNTS_FILE; // File to store account data
+    friend class PostingEngine;
+    friend class JobEngine;
+
+    // One partition of the account store, with its own accounts file, index
+    // and lock, so that work on one shard never waits for another. Lookups
+    // and postings take the lock shared; registration takes it exclusively.
+    // Loads, batches and the snapshot step of a checkpoint lock every shard
+    // (in shard order).
+    // A deque never relocates existing elements on push_back, so an Account*
+    // handed out by loginUser/findAccount (or held by a checkpoint snapshot)
+    // stays valid after later registrations.
+    struct Shard {
+        std::shared_mutex mutex;
+        std::deque<Account> accounts;
+        AccountIndex index;              // Account number -> Account* lookup table
+        std::atomic<bool> dirty{false};  // Changed since the shard was last snapshotted
+    };
+
+    // One shard's accounts as they stood when a checkpoint began
+    struct ShardSnapshot {
+        size_t shard;
+        AccountSnapshot accounts;
+    };
+
+    static Shard shards[SHARD_COUNT];
+    static const std::string ACCOUNTS_FILE;   // Single accounts file from before sharding; split on load
+    static const std::string SHARD_DIRECTORY; // Holds one accounts file per shard
+    static const std::string JOURNAL_FILE;    // Write-ahead journal of balance changes since the last save
+    static const size_t JOURNAL_SYNC_GROUP; // Journal appends per fsync
+    static const size_t CHECKPOINT_INTERVAL; // Journal records that start a background checkpoint
+    // One journal for all shards, so that both legs of a transfer between
+    // shards still commit as one group
+    static Journal journal;
+    static const std::string ALLOCATOR_FILE; // State of the account number allocator
+    static AccountNumberAllocator numberAllocator;
+    static std::atomic<size_t> uncheckedNumbers; // Accounts whose number has no valid check digit
+    static const std::string JOB_PERIOD_FILE; // Last period the month-end jobs were applied for
+    static std::atomic<uint32_t> jobPeriod;   // YYYYMM, 0 if none yet
+    static bool jobPeriodSaved;               // jobPeriod is in JOB_PERIOD_FILE (guarded by every shard lock)
 
-    // Private helper to generate a unique account number
+    // Private helper to generate a unique account number ("" if none can be issued)
     static std::string generateAccountNumber();
 
+    // Private helpers to find the shard that holds an account number, and its file
+    static size_t shardOf(uint64_t key);
+    static Shard& shardFor(uint64_t key);
+    static std::string shardFilePath(size_t shard);
+
+    // Private helper to lock every shard exclusively, in shard order
+    static std::vector<std::unique_lock<std::shared_mutex>> lockAllShards();
+
+    // Private helpers for loadAccounts; every shard is locked exclusively.
+    // readLegacyFile reads ACCOUNTS_FILE; loadShard reads one shard's file.
+    // Both stop at the first damaged record and return false if there was one.
+    static bool readLegacyFile(std::deque<Account>& accounts);
+    static bool loadShard(size_t shard);
+
+    // Private helper for saveAccounts: snapshots and saves every changed
+    // shard, then empties the journal. The caller holds every shard exclusively.
+    static bool saveAccountsLocked();
+
+    // Private helpers for checkpoints. captureLocked snapshots every changed
+    // shard and marks it clean; the caller holds every shard exclusively.
+    // writeSnapshots writes the snapshots to their shard files in parallel
+    // (no lock needed) and marks any shard it could not write changed again;
+    // it returns false if there was one.
+    static std::vector<ShardSnapshot> captureLocked();
+    static bool writeSnapshots(std::vector<ShardSnapshot>& snapshots);
+
+    // Private helpers for the month-end job period. loadJobPeriod reads
+    // JOB_PERIOD_FILE; a damaged file refuses every later period.
+    // saveJobPeriodLocked writes jobPeriod if the file does not hold it yet,
+    // and must succeed before a journal holding the period's marker is
+    // discarded. recordJobPeriod is called once the marker is journaled.
+    // The caller holds every shard exclusively.
+    static void loadJobPeriod();
+    static bool saveJobPeriodLocked();
+    static void recordJobPeriod(uint32_t period);
+
+    // Private helper to persist balance changes already applied to accounts
+    // by appending them to the journal as one all-or-nothing group. The
+    // caller holds the shard lock (shared or exclusive) and the posting lock
+    // of every account involved.
+    static bool recordPostings(JournalRecord* records, size_t count, bool syncNow);
+
     // Private constructor to prevent instantiation (it's a utility class)
     UserAuth() = delete;
 
@@ -23,15 +116,70 @@ public:
     static bool registerUser();
     static Account* loginUser(); // Returns pointer to logged-in account, or nullptr
 
-    // Static methods for data persistence
+    // Static methods for data persistence. saveAccounts and checkpoint wait
+    // for a background checkpoint to finish, then save on the calling thread.
     static void loadAccounts();
-    static void saveAccounts();
+    static void saveAccounts(); // Full checkpoint: saves the changed shards and empties the journal
+    static bool checkpoint();   // saveAccounts without the console message; returns false on failure
+
+    // Static method to start a checkpoint that is written while postings go
+    // on. Postings pause only while the balances of the changed shards are
+    // copied (16 bytes per account in them) and the journal is rotated; a
+    // background thread then writes the copies to the shard files and drops
+    // the rotated journal. Returns false if a checkpoint is still running.
+    static bool checkpointInBackground();
+
+    // Static method to wait until a background checkpoint has finished
+    static void waitForCheckpoint();
 
-    // Static method to find an account by number
+    // Static method to start a background checkpoint once CHECKPOINT_INTERVAL
+    // postings have been journaled since the last one
+    static void checkpointIfDue();
+
+    // Static method to check the check digit of a typed account number before
+    // it is looked up. Numbers issued by the allocator end in a Luhn check
+    // digit, so one that fails it was mistyped. While the store holds accounts
+    // numbered before check digits existed, whose last digit can be anything,
+    // every number is accepted and left to the lookup.
+    static bool acceptsAccountNumber(uint64_t key);
+
+    // Static method to find an account by number (nullptr for a mistyped number)
     static Account* findAccount(const std::string& accNum);
 
-    // Static method to get a reference to the accounts vector (for external modification, e.g., main)
-    static std::vector<Account>& getAccounts();
+    // Static method to add an account to the store and index (returns nullptr on duplicate number)
+    static Account* addAccount(const Account& account);
+
+    // Static method to create an account under a newly generated number; returns that number,
+    // or "" if no number could be issued. The account is only in memory until the next save.
+    // fundingKey names the account its installments are debited from (Account::NO_ACCOUNT_KEY for none).
+    static std::string createAccount(const std::string& pin, Money initialDeposit,
+                                     const std::string& ownerName, AccountType type, uint64_t fundingKey);
+
+    // Same, with a PIN that is already hashed (for bulk registration, which hashes PINs in parallel)
+    static std::string createAccount(const PinCredential& credential, Money initialDeposit,
+                                     const std::string& ownerName, AccountType type, uint64_t fundingKey);
+
+    // Static method to make newly added accounts durable by rewriting only the
+    // shard files they belong to; other shards and the journal are left for
+    // the next checkpoint. The accounts must be the newest of their shards.
+    // saved[i] tells whether keys[i] is on disk: the accounts of a shard that
+    // could not be written are removed from memory again (their numbers are
+    // not reused). Returns false if any shard could not be written.
+    static bool saveNewAccounts(const std::vector<uint64_t>& keys, std::vector<bool>& saved);
+
+    // Static method to reserve numbers for count upcoming createAccount calls in one
+    // allocator-state write (for bulk registration)
+    static bool reserveAccountNumbers(size_t count);
+
+    // Static method to run reader over the accounts of every shard with
+    // postings paused, so that it sees one consistent set of balances
+    static void snapshotAccounts(const std::function<void(const std::vector<const std::deque<Account>*>&)>& reader);
+
+    // Static method to get the last period (YYYYMM) the month-end jobs were applied for, 0 if none
+    static uint32_t lastJobPeriod();
+
+    // Static method to count the accounts in memory
+    static size_t accountCount();
 };
 
 #endif // USERAUTH_H
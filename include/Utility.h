@@ -4,15 +4,47 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include "Money.h"
+#include <cstddef>    // For size_t
+#include <functional> // For std::function
+#include <cstdint>    // For int64_t
 #include <string>
+#include <string_view> // For std::string_view
 #include <iostream> // For std::cin, std::cout, std::endl
 #include <limits>   // For std::numeric_limits
 
+// Length of a formatted "YYYY-MM-DD HH:MM:SS" timestamp
+const size_t TIMESTAMP_TEXT_LENGTH = 19;
+
+// Function to get the current time in seconds since the epoch
+int64_t currentTimestamp();
+
+// Function to write epoch seconds as a local "YYYY-MM-DD HH:MM:SS" date into
+// out (TIMESTAMP_TEXT_LENGTH bytes, not NUL-terminated). Each thread caches
+// the last minute it rendered, so consecutive timestamps cost a few stores.
+void formatTimestamp(int64_t epochSeconds, char* out);
+
 // Function to get the current date as a string
 std::string getCurrentDate();
 
+// Function to convert a local "YYYY-MM-DD HH:MM:SS" date to seconds since the epoch
+bool parseDateTime(std::string_view text, int64_t& epochSeconds);
+
+// Function to format seconds since the epoch as a local "YYYY-MM-DD HH:MM:SS" date
+std::string formatDateTime(int64_t epochSeconds);
+
 // Function to validate if an amount is positive
-bool isValidAmount(double amount);
+bool isValidAmount(Money amount);
+
+// Function to read an amount such as "150" or "150.25" from a stream.
+// Returns false (with the stream's fail bit set) if the input is not a valid amount.
+bool readAmount(std::istream& is, Money& amount);
+
+// Function to split [0, count) into contiguous ranges and run body(begin, end)
+// on each from its own thread. Uses at most one thread per hardware thread
+// and per minPerThread items; small counts, and calls made from inside
+// another parallelFor, run on the calling thread.
+void parallelFor(size_t count, size_t minPerThread, const std::function<void(size_t, size_t)>& body);
 
 // Function to clear the console screen (platform-dependent)
 void clearScreen();
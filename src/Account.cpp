@@ -1,25 +1,31 @@
 
 // src/Account.cpp
 #include "Account.h"
+#include "AccountIndex.h" // For packAccountNumber, unpackAccountNumber
+#include "Metrics.h"
+#include "StringArena.h"
 #include <iostream>
+#include <cmath>    // For std::llround, std::isfinite, std::fabs
 #include <limits>   // Required for std::numeric_limits
-#include <iomanip>  // Required for std::fixed and std::setprecision
 #include <map>      // For mapping enum to string
 
-// Helper function to write a string to a binary file
-void writeString(std::ofstream& ofs, const std::string& str) {
-    size_t len = str.length();
-    ofs.write(reinterpret_cast<const char*>(&len), sizeof(len));
-    ofs.write(str.c_str(), len);
-}
+// Longest field the legacy format ever held; a larger length means the file is damaged
+static const size_t MAX_LEGACY_FIELD_LENGTH = 1 << 16;
+
+static const Histogram authenticateSeconds("bms_authenticate_seconds", "Time to check a PIN");
+static const Counter authentications("bms_authentications_total", "PIN checks");
+static const Counter authenticationFailures("bms_authentication_failures_total", "PIN checks that failed");
 
-// Helper function to read a string from a binary file
-std::string readString(std::ifstream& ifs) {
+// Helper function to read a length-prefixed string from a binary file.
+// Returns false at end of file or on an implausible length, without
+// allocating for it.
+static bool readString(std::ifstream& ifs, std::string& str) {
     size_t len;
-    ifs.read(reinterpret_cast<char*>(&len), sizeof(len));
-    std::string str(len, ' '); // Pre-allocate string with correct size
-    ifs.read(&str[0], len);    // Read directly into string buffer
-    return str;
+    if (!ifs.read(reinterpret_cast<char*>(&len), sizeof(len)) || len > MAX_LEGACY_FIELD_LENGTH) {
+        return false;
+    }
+    str.assign(len, ' ');   // Pre-allocate string with correct size
+    return len == 0 || static_cast<bool>(ifs.read(&str[0], len)); // Read directly into string buffer
 }
 
 // Helper function to convert AccountType enum to string
@@ -53,27 +59,56 @@ AccountType stringToAccountType(const std::string& typeStr) {
 }
 
 
+const uint64_t Account::NO_ACCOUNT_KEY = std::numeric_limits<uint64_t>::max();
+
 // Default constructor
-Account::Account() : accountNumber(""), pin(""), balance(0.0), ownerName(""), accountType(AccountType::UNKNOWN) {}
+Account::Account()
+    : accountKey(NO_ACCOUNT_KEY), balance(), ownerName(), accountType(AccountType::UNKNOWN), fundingKey(NO_ACCOUNT_KEY),
+      pin() {}
 
 // Parameterized constructor (updated to include accountType)
-Account::Account(const std::string& accNum, const std::string& p, double bal, const std::string& name, AccountType type)
-    : accountNumber(accNum), pin(p), balance(bal), ownerName(name), accountType(type) {}
+Account::Account(const std::string& accNum, const std::string& p, Money bal, const std::string& name, AccountType type)
+    : Account(accNum, PinHash::hash(p), bal, name, type) {}
+
+// Parameterized constructor with an already hashed PIN
+Account::Account(const std::string& accNum, const PinCredential& credential, Money bal, const std::string& name,
+                 AccountType type)
+    : Account(fromPooled(NO_ACCOUNT_KEY, credential, bal, StringArena::names().store(name), type)) {
+    if (!packAccountNumber(accNum, accountKey)) {
+        accountKey = NO_ACCOUNT_KEY;
+    }
+}
+
+// Build an account around a name that is already in the arena
+Account Account::fromPooled(uint64_t key, const PinCredential& credential, Money bal, std::string_view pooledName,
+                            AccountType type) {
+    Account acc;
+    acc.accountKey = key;
+    acc.balance = bal;
+    acc.ownerName = pooledName;
+    acc.accountType = type;
+    acc.pin = credential;
+    return acc;
+}
 
 // Getters
+uint64_t Account::getAccountKey() const {
+    return accountKey;
+}
+
 std::string Account::getAccountNumber() const {
-    return accountNumber;
+    return accountKey == NO_ACCOUNT_KEY ? std::string() : unpackAccountNumber(accountKey);
 }
 
-std::string Account::getPin() const {
+const PinCredential& Account::getPinCredential() const {
     return pin;
 }
 
-double Account::getBalance() const {
+Money Account::getBalance() const {
     return balance;
 }
 
-std::string Account::getOwnerName() const {
+std::string_view Account::getOwnerName() const {
     return ownerName;
 }
 
@@ -82,61 +117,78 @@ AccountType Account::getAccountType() const {
     return accountType;
 }
 
+uint64_t Account::getFundingAccountKey() const {
+    return fundingKey;
+}
+
 // Setter for balance (used internally by deposit/withdraw)
-void Account::setBalance(double newBalance) {
+void Account::setBalance(Money newBalance) {
     balance = newBalance;
 }
 
+// Setter for the funding account
+void Account::setFundingAccountKey(uint64_t key) {
+    fundingKey = key;
+}
+
 // Deposit funds into the account
-bool Account::deposit(double amount) {
-    if (amount > 0) {
-        balance += amount;
-        return true;
+bool Account::deposit(Money amount) {
+    if (amount > Money()) {
+        return balance.add(amount, balance); // Fails only if the balance would overflow
     }
     return false;
 }
 
 // Withdraw funds from the account
-bool Account::withdraw(double amount) {
-    if (amount > 0 && balance >= amount) {
-        balance -= amount;
-        return true;
+bool Account::withdraw(Money amount) {
+    if (amount > Money() && balance >= amount) {
+        return balance.subtract(amount, balance);
     }
     return false;
 }
 
 // Authenticate the account with a given PIN
-bool Account::authenticate(const std::string& enteredPin) const {
-    return pin == enteredPin;
+bool Account::authenticate(std::string_view enteredPin) const {
+    ScopedTimer timer(authenticateSeconds);
+    authentications.add();
+    bool ok = PinHash::verifyCached(accountKey, pin, enteredPin);
+    if (!ok) {
+        authenticationFailures.add();
+    }
+    return ok;
 }
 
 // Display account information (updated to include account type)
 void Account::displayAccountInfo() const {
-    std::cout << "Account Number: " << accountNumber << std::endl;
+    std::cout << "Account Number: " << getAccountNumber() << std::endl;
     std::cout << "Owner Name:     " << ownerName << std::endl;
     std::cout << "Account Type:   " << accountTypeToString(accountType) << std::endl; // Display account type
-    std::cout << "Balance:        TK." << std::fixed << std::setprecision(2) << balance << std::endl;
-}
-
-// Save account data to a binary file (updated to include account type)
-void Account::saveToFile(std::ofstream& ofs) const {
-    writeString(ofs, accountNumber);
-    writeString(ofs, pin);
-    ofs.write(reinterpret_cast<const char*>(&balance), sizeof(balance));
-    writeString(ofs, ownerName);
-    writeString(ofs, accountTypeToString(accountType)); // Save account type as string
+    if (fundingKey != NO_ACCOUNT_KEY) {
+        std::cout << "Funded From:    " << unpackAccountNumber(fundingKey) << std::endl;
+    }
+    std::cout << "Balance:        TK." << balance << std::endl;
 }
 
-// Load account data from a binary file (updated to include account type)
-void Account::loadFromFile(std::ifstream& ifs) {
-    accountNumber = readString(ifs);
-    pin = readString(ifs);
-    ifs.read(reinterpret_cast<char*>(&balance), sizeof(balance));
-    ownerName = readString(ifs);
-    accountType = stringToAccountType(readString(ifs)); // Load account type from string
+// Load account data from a legacy-format binary file (used for migration only)
+bool Account::loadFromFile(std::ifstream& ifs) {
+    std::string accNum, p, name, typeName;
+    double legacyBalance = 0.0; // The legacy format stores the balance as a double
+    if (!readString(ifs, accNum) || !readString(ifs, p) ||
+        !ifs.read(reinterpret_cast<char*>(&legacyBalance), sizeof(legacyBalance)) ||
+        !readString(ifs, name) || !readString(ifs, typeName)) {
+        return false; // Cut short or damaged
+    }
+    uint64_t key;
+    if (!packAccountNumber(accNum, key) || !std::isfinite(legacyBalance) ||
+        std::fabs(legacyBalance) > static_cast<double>(std::numeric_limits<int64_t>::max()) / 100.0) {
+        return false;
+    }
+    *this = Account(accNum, p, Money::fromPaisa(std::llround(legacyBalance * 100.0)), name,
+                    stringToAccountType(typeName)); // Load account type from string
+    return true;
 }
 
 // Operator overload for comparison (useful for finding accounts in a vector)
 bool Account::operator==(const Account& other) const {
-    return accountNumber == other.accountNumber;
+    return accountKey == other.accountKey;
 }
@@ -0,0 +1,283 @@
+// src/AccountFile.cpp
+#include "AccountFile.h"
+#include "Crc32c.h"
+#include "StringArena.h"  // For StringArena::names
+#include "Utility.h"      // For parallelFor
+#include <algorithm>      // For std::min
+#include <atomic>         // For std::atomic
+#include <cerrno>         // For errno, EINTR
+#include <cstdio>         // For std::rename, std::remove
+#include <cstring>        // For std::memcmp, std::memcpy
+#include <filesystem>     // For std::filesystem::path
+#include <vector>
+#include <fcntl.h>        // For open
+#include <sys/mman.h>     // For mmap, munmap
+#include <sys/stat.h>     // For fstat
+#include <unistd.h>       // For close, write, fsync
+
+AccountFile::AccountFile() : fd(-1), base(nullptr), length(0), recordsInFile(0), namesInFile(0) {}
+
+AccountFile::~AccountFile() {
+    close();
+}
+
+const AccountFileHeader& AccountFile::header() const {
+    return *reinterpret_cast<const AccountFileHeader*>(base);
+}
+
+const AccountRecord& AccountFile::recordAt(size_t i) const {
+    return reinterpret_cast<const AccountRecord*>(base + sizeof(AccountFileHeader))[i];
+}
+
+// Checksum of a record and its owner name
+static uint32_t recordChecksum(const AccountRecord& rec, const char* name) {
+    AccountRecord copy = rec;
+    copy.checksum = 0;
+    return crc32c(name, rec.nameLength, crc32c(&copy, sizeof(copy)));
+}
+
+// Write the whole buffer to a file descriptor
+static bool writeAll(int out, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(out, p, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Make a rename in the directory holding path durable
+static void syncDirectory(const std::string& path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+}
+
+// Copy the balance of every account, keeping a pointer for the other fields
+void AccountSnapshot::capture(const std::deque<Account>& source) {
+    accounts.clear();
+    balances.clear();
+    accounts.reserve(source.size());
+    balances.reserve(source.size());
+    for (const Account& acc : source) { // Iterators walk the deque's blocks without indexing each time
+        accounts.push_back(&acc);
+        balances.push_back(acc.getBalance());
+    }
+}
+
+size_t AccountSnapshot::bytes() const {
+    return accounts.capacity() * sizeof(const Account*) + balances.capacity() * sizeof(Money);
+}
+
+// Write count accounts in the fixed-width format; accountAt(i) and
+// balanceAt(i) give the fields of account i
+template <typename AccountAt, typename BalanceAt>
+static bool writeAccounts(const std::string& path, size_t count, AccountAt accountAt, BalanceAt balanceAt) {
+    // Lay out the name table first so the header can record its size
+    std::string names;
+    std::vector<AccountRecord> recs(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Account& acc = accountAt(i);
+        AccountRecord& rec = recs[i];
+        std::memset(&rec, 0, sizeof(rec));
+        rec.accountNumber = acc.getAccountKey();
+        rec.balance = balanceAt(i).toPaisa();
+        rec.fundingAccount = acc.getFundingAccountKey();
+        std::string_view owner = acc.getOwnerName();
+        rec.nameOffset = static_cast<uint32_t>(names.size());
+        rec.nameLength = static_cast<uint32_t>(owner.size());
+        names.append(owner.data(), owner.size());
+        const PinCredential& pin = acc.getPinCredential();
+        rec.pinIterations = pin.iterations;
+        std::memcpy(rec.pinSalt, pin.salt, sizeof(rec.pinSalt));
+        std::memcpy(rec.pinHash, pin.hash, sizeof(rec.pinHash));
+        rec.type = static_cast<uint8_t>(acc.getAccountType());
+    }
+
+    AccountFileHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, ACCOUNT_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = ACCOUNT_FILE_VERSION;
+    hdr.recordSize = sizeof(AccountRecord);
+    hdr.recordCount = recs.size();
+    hdr.namesOffset = sizeof(AccountFileHeader) + recs.size() * sizeof(AccountRecord);
+    hdr.namesSize = names.size();
+    hdr.checksum = crc32c(names.data(), names.size(), crc32c(&hdr, sizeof(hdr)));
+
+    // The name table is complete, so every record can now be checksummed
+    parallelFor(recs.size(), 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            recs[i].checksum = recordChecksum(recs[i], names.data() + recs[i].nameOffset);
+        }
+    });
+
+    // Write a temporary file and sync it before it replaces the old one
+    std::string tempPath = path + ".tmp";
+    int out = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        return false;
+    }
+    bool ok = writeAll(out, &hdr, sizeof(hdr)) &&
+              writeAll(out, recs.data(), recs.size() * sizeof(AccountRecord)) &&
+              writeAll(out, names.data(), names.size()) &&
+              fsync(out) == 0;
+    ok = ::close(out) == 0 && ok;
+    if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    syncDirectory(path);
+    return true;
+}
+
+// Write all accounts in the fixed-width format
+bool AccountFile::write(const std::string& path, const std::deque<Account>& accounts) {
+    return writeAccounts(path, accounts.size(),
+                         [&accounts](size_t i) -> const Account& { return accounts[i]; },
+                         [&accounts](size_t i) { return accounts[i].getBalance(); });
+}
+
+// Write the accounts of a snapshot with the balances it captured
+bool AccountFile::write(const std::string& path, const AccountSnapshot& snapshot) {
+    return writeAccounts(path, snapshot.accounts.size(),
+                         [&snapshot](size_t i) -> const Account& { return *snapshot.accounts[i]; },
+                         [&snapshot](size_t i) { return snapshot.balances[i]; });
+}
+
+// Map an existing fixed-width file
+bool AccountFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(AccountFileHeader)) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    base = static_cast<const char*>(mapping);
+
+    // Validate the header before trusting any offsets in it
+    const AccountFileHeader& hdr = header();
+    if (std::memcmp(hdr.magic, ACCOUNT_FILE_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != ACCOUNT_FILE_VERSION ||
+        hdr.recordSize != sizeof(AccountRecord) ||
+        hdr.recordCount > (UINT64_MAX - sizeof(AccountFileHeader)) / hdr.recordSize ||
+        hdr.namesOffset != sizeof(AccountFileHeader) + hdr.recordCount * hdr.recordSize ||
+        hdr.namesSize > UINT64_MAX - hdr.namesOffset) {
+        close();
+        return false;
+    }
+    recordsInFile = std::min<uint64_t>(hdr.recordCount, (length - sizeof(AccountFileHeader)) / hdr.recordSize);
+    namesInFile = hdr.namesOffset < length ? std::min<uint64_t>(hdr.namesSize, length - hdr.namesOffset) : 0;
+    return true;
+}
+
+void AccountFile::close() {
+    if (base) {
+        munmap(const_cast<char*>(base), length);
+        base = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+    recordsInFile = 0;
+    namesInFile = 0;
+}
+
+uint64_t AccountFile::recordCount() const {
+    return base ? header().recordCount : 0;
+}
+
+// Build an Account from record i, given where the name table lives
+Account AccountFile::buildAccount(size_t i, const char* names) const {
+    const AccountRecord& rec = recordAt(i);
+    std::string_view owner;
+    if (static_cast<uint64_t>(rec.nameOffset) + rec.nameLength <= namesInFile) {
+        owner = std::string_view(names + rec.nameOffset, rec.nameLength);
+    }
+    PinCredential pin;
+    pin.iterations = rec.pinIterations;
+    std::memcpy(pin.salt, rec.pinSalt, sizeof(pin.salt));
+    std::memcpy(pin.hash, rec.pinHash, sizeof(pin.hash));
+    AccountType type = rec.type <= static_cast<uint8_t>(AccountType::UNKNOWN)
+                           ? static_cast<AccountType>(rec.type)
+                           : AccountType::UNKNOWN;
+    Account acc = Account::fromPooled(rec.accountNumber, pin, Money::fromPaisa(rec.balance), owner, type);
+    acc.setFundingAccountKey(rec.fundingAccount);
+    return acc;
+}
+
+// Check record i before building an account from it
+bool AccountFile::recordIntact(size_t i) const {
+    const AccountRecord& rec = recordAt(i);
+    return static_cast<uint64_t>(rec.nameOffset) + rec.nameLength <= namesInFile &&
+           recordChecksum(rec, base + header().namesOffset + rec.nameOffset) == rec.checksum;
+}
+
+// Append every intact record to accounts, stopping at the first bad one
+size_t AccountFile::readAccounts(std::deque<Account>& accounts) const {
+    if (!base) {
+        return 0;
+    }
+    // Copy the whole name table into the arena at once; each account's name
+    // is then just a view into that copy
+    char* names = StringArena::names().allocate(namesInFile);
+    std::memcpy(names, base + header().namesOffset, namesInFile);
+
+    // Size the store up front, then fill disjoint ranges of it in parallel
+    size_t first = accounts.size();
+    size_t count = recordsInFile;
+    accounts.resize(first + count);
+    std::atomic<size_t> firstBad(count);
+    parallelFor(count, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && i < firstBad.load(std::memory_order_relaxed); ++i) {
+            if (!recordIntact(i)) {
+                size_t seen = firstBad.load();
+                while (i < seen && !firstBad.compare_exchange_weak(seen, i)) {
+                }
+                break;
+            }
+            accounts[first + i] = buildAccount(i, names);
+        }
+    });
+    accounts.resize(first + firstBad); // Drop everything from the first bad record on
+    return firstBad;
+}
+
+// Check the header and name table against the header checksum
+bool AccountFile::checksumMatches() const {
+    if (!base) {
+        return false;
+    }
+    if (namesInFile < header().namesSize) {
+        return false;
+    }
+    AccountFileHeader copy = header();
+    copy.checksum = 0;
+    return crc32c(base + copy.namesOffset, copy.namesSize, crc32c(&copy, sizeof(copy))) == header().checksum;
+}
+
+// Read the balance of record i
+Money AccountFile::readBalance(size_t i) const {
+    return Money::fromPaisa(recordAt(i).balance);
+}
@@ -0,0 +1,244 @@
+// src/AccountIndex.cpp
+#include "AccountIndex.h"
+#include "Account.h"
+#include "Utility.h" // For parallelFor
+#include <algorithm> // For std::min
+#include <limits> // For std::numeric_limits
+
+const uint64_t AccountIndex::EMPTY_KEY = std::numeric_limits<uint64_t>::max();
+
+// Pack a 10-digit account number string into an integer key
+bool packAccountNumber(const std::string& accNum, uint64_t& key) {
+    if (accNum.length() != 10) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (char c : accNum) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    key = value;
+    return true;
+}
+
+// Unpack an integer key into a zero-padded 10-digit string
+std::string unpackAccountNumber(uint64_t key) {
+    std::string accNum(10, '0');
+    for (int i = 9; i >= 0; --i) {
+        accNum[i] = static_cast<char>('0' + key % 10);
+        key /= 10;
+    }
+    return accNum;
+}
+
+// Mix the bits of a key so that sequential account numbers spread across the table
+uint64_t hashAccountKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Constructor: start with a small table
+AccountIndex::AccountIndex() : slots(16, Slot{EMPTY_KEY, nullptr, 0}), count(0) {}
+
+// Find the slot holding key, or the first empty slot in its probe sequence
+size_t AccountIndex::probe(uint64_t key) const {
+    size_t mask = slots.size() - 1;
+    size_t i = hashAccountKey(key) & mask;
+    while (slots[i].key != EMPTY_KEY && slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Rebuild the table with a new capacity
+void AccountIndex::rehash(size_t newCapacity) {
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(newCapacity, Slot{EMPTY_KEY, nullptr, 0});
+    for (const auto& slot : old) {
+        if (slot.key != EMPTY_KEY) {
+            slots[probe(slot.key)] = slot;
+        }
+    }
+}
+
+// Insert or replace the mapping for key
+void AccountIndex::insert(uint64_t key, Account* account, size_t position) {
+    // Keep the load factor at or below 1/2
+    if ((count + 1) * 2 > slots.size()) {
+        rehash(slots.size() * 2);
+    }
+    size_t i = probe(key);
+    if (slots[i].key == EMPTY_KEY) {
+        slots[i].key = key;
+        ++count;
+    }
+    slots[i].account = account;
+    slots[i].position = position;
+}
+
+// Insert while other threads do the same; claims empty slots with compare-and-swap
+void AccountIndex::insertConcurrent(uint64_t key, Account* account, size_t position) {
+    size_t mask = slots.size() - 1;
+    size_t i = hashAccountKey(key) & mask;
+    while (true) {
+        uint64_t expected = EMPTY_KEY;
+        if (__atomic_compare_exchange_n(&slots[i].key, &expected, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if (expected == key) {
+            break; // Duplicate key: replace its value like insert() does
+        }
+        i = (i + 1) & mask;
+    }
+    slots[i].account = account;
+    slots[i].position = position;
+}
+
+// Fill the table from the whole store, one region of the table per thread
+void AccountIndex::build(std::deque<Account>& accounts) {
+    const size_t BULK_MIN_ACCOUNTS = 65536; // Below this a plain insert loop is fastest
+    const size_t CHUNK = 65536;             // Accounts per counting/scatter task
+    const size_t PARTITION_BITS = 10;       // 1024 regions of the table
+    const size_t PARTITIONS = size_t(1) << PARTITION_BITS;
+
+    size_t n = accounts.size();
+    if (n < BULK_MIN_ACCOUNTS) {
+        clear();
+        reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (accounts[i].getAccountKey() != Account::NO_ACCOUNT_KEY) {
+                insert(accounts[i].getAccountKey(), &accounts[i], i);
+            }
+        }
+        return;
+    }
+
+    // Allocate the full-size table and mark it empty in parallel
+    size_t capacity = 16;
+    while (n * 2 > capacity) {
+        capacity *= 2;
+    }
+    std::vector<Slot> fresh(capacity);
+    parallelFor(capacity, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            fresh[i] = Slot(EMPTY_KEY, nullptr, 0);
+        }
+    });
+    slots.swap(fresh);
+    count = 0;
+
+    // The top bits of a key's home slot select its region
+    size_t shift = __builtin_ctzll(capacity) - PARTITION_BITS;
+    auto regionOf = [&](uint64_t key) { return (hashAccountKey(key) & (capacity - 1)) >> shift; };
+
+    // Count the keys per region in each chunk of the store
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    std::vector<size_t> offsets(chunks * PARTITIONS, 0);
+    parallelFor(chunks, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            size_t* counts = &offsets[c * PARTITIONS];
+            for (size_t i = c * CHUNK; i < std::min(n, (c + 1) * CHUNK); ++i) {
+                uint64_t key = accounts[i].getAccountKey();
+                if (key != Account::NO_ACCOUNT_KEY) {
+                    ++counts[regionOf(key)];
+                }
+            }
+        }
+    });
+
+    // Turn the counts into write offsets, grouped by region and then by chunk
+    // (so within a region, keys stay in store order and later duplicates win)
+    std::vector<size_t> regionStart(PARTITIONS + 1, 0);
+    size_t total = 0;
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        regionStart[p] = total;
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t keys = offsets[c * PARTITIONS + p];
+            offsets[c * PARTITIONS + p] = total;
+            total += keys;
+        }
+    }
+    regionStart[PARTITIONS] = total;
+
+    // Scatter every key into its region's run
+    struct Entry {
+        uint64_t key;
+        Account* account;
+        size_t position;
+
+        Entry() {} // Left uninitialized; every entry is written by the scatter
+    };
+    std::vector<Entry> entries(total);
+    parallelFor(chunks, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            size_t* next = &offsets[c * PARTITIONS];
+            for (size_t i = c * CHUNK; i < std::min(n, (c + 1) * CHUNK); ++i) {
+                uint64_t key = accounts[i].getAccountKey();
+                if (key != Account::NO_ACCOUNT_KEY) {
+                    Entry& entry = entries[next[regionOf(key)]++];
+                    entry.key = key;
+                    entry.account = &accounts[i];
+                    entry.position = i;
+                }
+            }
+        }
+    });
+
+    // Insert region by region; probes that run past the end of a region are
+    // the only contended writes, and compare-and-swap settles those
+    parallelFor(PARTITIONS, 1, [&](size_t first, size_t last) {
+        for (size_t j = regionStart[first]; j < regionStart[last]; ++j) {
+            insertConcurrent(entries[j].key, entries[j].account, entries[j].position);
+        }
+    });
+}
+
+// Look up an account by key
+Account* AccountIndex::find(uint64_t key) const {
+    const Slot& slot = slots[probe(key)];
+    return slot.key == key ? slot.account : nullptr;
+}
+
+// Look up an account's position in the store
+bool AccountIndex::findPosition(uint64_t key, size_t& position) const {
+    const Slot& slot = slots[probe(key)];
+    if (slot.key != key) {
+        return false;
+    }
+    position = slot.position;
+    return true;
+}
+
+// Check whether a key is present
+bool AccountIndex::contains(uint64_t key) const {
+    return slots[probe(key)].key == key;
+}
+
+// Make room for at least n entries without rehashing
+void AccountIndex::reserve(size_t n) {
+    size_t capacity = slots.size();
+    while (n * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != slots.size()) {
+        rehash(capacity);
+    }
+}
+
+// Remove all entries
+void AccountIndex::clear() {
+    slots.assign(16, Slot{EMPTY_KEY, nullptr, 0});
+    count = 0;
+}
+
+size_t AccountIndex::size() const {
+    return count;
+}
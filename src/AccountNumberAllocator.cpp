@@ -0,0 +1,164 @@
+// src/AccountNumberAllocator.cpp
+#include "AccountNumberAllocator.h"
+#include "AccountIndex.h" // For hashAccountKey
+#include <algorithm>      // For std::min
+#include <cstdio>         // For std::fopen, std::rename
+#include <cstring>        // For std::memcmp, std::memcpy
+#include <filesystem>     // For std::filesystem::path
+#include <iostream>
+#include <random>         // For std::random_device
+#include <fcntl.h>        // For open
+#include <unistd.h>       // For fsync
+
+static const unsigned FEISTEL_HALF_BITS = 15; // Two halves of a 30-bit block (2^30 >= CAPACITY)
+static const uint64_t FEISTEL_HALF_MASK = (1ULL << FEISTEL_HALF_BITS) - 1;
+static const int FEISTEL_ROUNDS = 6;
+
+// Keyed permutation of [0, 2^30)
+static uint64_t feistel(uint64_t key, uint64_t block) {
+    uint64_t left = block >> FEISTEL_HALF_BITS;
+    uint64_t right = block & FEISTEL_HALF_MASK;
+    for (int round = 0; round < FEISTEL_ROUNDS; ++round) {
+        uint64_t mixed = hashAccountKey(key + 0x9e3779b97f4a7c15ULL * (round + 1) + right) & FEISTEL_HALF_MASK;
+        uint64_t newRight = left ^ mixed;
+        left = right;
+        right = newRight;
+    }
+    return (left << FEISTEL_HALF_BITS) | right;
+}
+
+// Luhn check digit for a number whose check digit is still to be appended
+static uint64_t luhnDigit(uint64_t body) {
+    uint64_t sum = 0;
+    bool doubled = true; // The body's last digit is doubled once the check digit follows it
+    for (; body > 0; body /= 10, doubled = !doubled) {
+        uint64_t digit = body % 10;
+        if (doubled) {
+            digit *= 2;
+            if (digit > 9) {
+                digit -= 9;
+            }
+        }
+        sum += digit;
+    }
+    return (10 - sum % 10) % 10;
+}
+
+// Flush a stdio stream and push its data to stable storage; false if either step failed
+static bool syncFile(std::FILE* f) {
+    return std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+// Make a rename in the directory holding path durable; false if it may not be
+static bool syncDirectoryOf(const std::string& path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (dir < 0) {
+        return false;
+    }
+    bool synced = fsync(dir) == 0;
+    ::close(dir);
+    return synced;
+}
+
+AccountNumberAllocator::AccountNumberAllocator(const std::string& statePath)
+    : path(statePath), loaded(false), key(0), next(0), limit(0) {}
+
+bool AccountNumberAllocator::loadLocked() {
+    if (loaded) {
+        return true;
+    }
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f) {
+        AccountAllocatorState state;
+        bool ok = std::fread(&state, sizeof(state), 1, f) == 1 &&
+                  std::memcmp(state.magic, ACCOUNT_ALLOCATOR_MAGIC, sizeof(state.magic)) == 0 &&
+                  state.version == ACCOUNT_ALLOCATOR_VERSION && state.limit <= CAPACITY;
+        std::fclose(f);
+        if (!ok) {
+            // Starting over with a new key could reissue numbers, so refuse instead
+            std::cerr << "Error: Account number allocator state " << path << " is damaged." << std::endl;
+            return false;
+        }
+        key = state.key;
+        next = limit = state.limit; // Whatever was left of the last block may have been issued
+    } else {
+        std::random_device device;
+        key = (static_cast<uint64_t>(device()) << 32) | device();
+        next = limit = 0;
+        if (!persistLocked(0)) {
+            return false;
+        }
+    }
+    loaded = true;
+    return true;
+}
+
+bool AccountNumberAllocator::persistLocked(uint64_t newLimit) {
+    AccountAllocatorState state;
+    std::memset(&state, 0, sizeof(state));
+    std::memcpy(state.magic, ACCOUNT_ALLOCATOR_MAGIC, sizeof(state.magic));
+    state.version = ACCOUNT_ALLOCATOR_VERSION;
+    state.key = key;
+    state.limit = newLimit;
+
+    std::string tempPath = path + ".tmp";
+    std::FILE* f = std::fopen(tempPath.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Error: Could not write " << tempPath << "." << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(&state, sizeof(state), 1, f) == 1 && syncFile(f);
+    ok = std::fclose(f) == 0 && ok;
+    // A new limit lost in a crash could reissue numbers, so it is only used once durable
+    if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0 || !syncDirectoryOf(path)) {
+        std::cerr << "Error: Could not save the account number allocator state." << std::endl;
+        return false;
+    }
+    limit = newLimit;
+    return true;
+}
+
+bool AccountNumberAllocator::allocate(uint64_t& accountKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loadLocked()) {
+        return false;
+    }
+    if (next >= CAPACITY) {
+        std::cerr << "Error: Every account number has been issued." << std::endl;
+        return false;
+    }
+    if (next >= limit && !persistLocked(std::min(CAPACITY, next + BLOCK_SIZE))) {
+        return false;
+    }
+    accountKey = numberAt(key, next++);
+    return true;
+}
+
+bool AccountNumberAllocator::reserve(uint64_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loadLocked()) {
+        return false;
+    }
+    uint64_t wanted = std::min(CAPACITY, next + count);
+    return wanted <= limit || persistLocked(wanted);
+}
+
+uint64_t AccountNumberAllocator::issued() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next;
+}
+
+uint64_t AccountNumberAllocator::numberAt(uint64_t key, uint64_t counter) {
+    // Cycle-walk: a permutation of [0, 2^30) restricted to [0, CAPACITY) by
+    // re-applying it until the value lands inside; still a bijection
+    uint64_t body = feistel(key, counter);
+    while (body >= CAPACITY) {
+        body = feistel(key, body);
+    }
+    return body * 10 + luhnDigit(body);
+}
+
+bool AccountNumberAllocator::hasValidCheckDigit(uint64_t accountKey) {
+    return accountKey < CAPACITY * 10 && luhnDigit(accountKey / 10) == accountKey % 10;
+}
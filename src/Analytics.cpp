@@ -0,0 +1,321 @@
+// src/Analytics.cpp
+#include "Analytics.h"
+#include "UserAuth.h"  // For UserAuth::snapshotAccounts
+#include <algorithm>   // For std::min, std::max, std::fill
+#include <iomanip>     // For std::setw, std::setprecision
+#include <iostream>
+#include <limits>      // For std::numeric_limits
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // For AVX2 intrinsics
+#define ANALYTICS_HAVE_AVX2 1
+#endif
+
+BalanceColumns::BalanceColumns() : balances(), typeStart() {}
+
+// Copy the balances out, grouped by type with a counting sort
+void BalanceColumns::capture(const std::deque<Account>& accounts) {
+    capture(std::vector<const std::deque<Account>*>{&accounts});
+}
+
+// Copy the balances of several containers out as one set
+void BalanceColumns::capture(const std::vector<const std::deque<Account>*>& parts) {
+    size_t counts[ACCOUNT_TYPE_COUNT] = {};
+    for (const auto* accounts : parts) {
+        for (const auto& acc : *accounts) {
+            ++counts[std::min(static_cast<size_t>(acc.getAccountType()), ACCOUNT_TYPE_COUNT - 1)];
+        }
+    }
+    typeStart[0] = 0;
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        typeStart[t + 1] = typeStart[t] + counts[t];
+    }
+
+    balances.resize(typeStart[ACCOUNT_TYPE_COUNT]);
+    size_t next[ACCOUNT_TYPE_COUNT];
+    std::copy(typeStart, typeStart + ACCOUNT_TYPE_COUNT, next);
+    for (const auto* accounts : parts) {
+        for (const auto& acc : *accounts) {
+            size_t t = std::min(static_cast<size_t>(acc.getAccountType()), ACCOUNT_TYPE_COUNT - 1);
+            balances[next[t]++] = acc.getBalance().toPaisa();
+        }
+    }
+}
+
+// Capture UserAuth's accounts as one consistent set of balances
+void BalanceColumns::captureStore() {
+    UserAuth::snapshotAccounts([this](const std::vector<const std::deque<Account>*>& shards) { capture(shards); });
+}
+
+size_t BalanceColumns::size() const {
+    return balances.size();
+}
+
+const int64_t* BalanceColumns::data() const {
+    return balances.data();
+}
+
+const int64_t* BalanceColumns::dataOf(AccountType type) const {
+    return balances.data() + typeStart[static_cast<size_t>(type)];
+}
+
+size_t BalanceColumns::sizeOf(AccountType type) const {
+    size_t t = static_cast<size_t>(type);
+    return typeStart[t + 1] - typeStart[t];
+}
+
+// Convert a SimdLevel to its display name
+const char* simdLevelToString(SimdLevel level) {
+    return level == SimdLevel::AVX2 ? "AVX2" : "scalar";
+}
+
+namespace {
+
+// --- Scalar kernels (any CPU) ---
+
+BalanceStats statsScalar(const int64_t* balances, size_t n) {
+    BalanceStats result;
+    uint64_t sum = 0; // Unsigned so overflow wraps instead of being undefined
+    int64_t lo = std::numeric_limits<int64_t>::max();
+    int64_t hi = std::numeric_limits<int64_t>::min();
+    for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<uint64_t>(balances[i]);
+        lo = std::min(lo, balances[i]);
+        hi = std::max(hi, balances[i]);
+    }
+    result.count = n;
+    result.total = Money::fromPaisa(static_cast<int64_t>(sum));
+    if (n > 0) {
+        result.minimum = Money::fromPaisa(lo);
+        result.maximum = Money::fromPaisa(hi);
+    }
+    return result;
+}
+
+size_t countBelowScalar(const int64_t* balances, size_t n, int64_t threshold) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += balances[i] < threshold;
+    }
+    return count;
+}
+
+void histogramScalar(const int64_t* balances, size_t n, const int64_t* edges, size_t edgeCount, size_t* counts) {
+    std::fill(counts, counts + edgeCount + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        // Count the edges at or below the balance without branching
+        size_t bucket = 0;
+        for (size_t k = 0; k < edgeCount; ++k) {
+            bucket += balances[i] >= edges[k];
+        }
+        ++counts[bucket];
+    }
+}
+
+#ifdef ANALYTICS_HAVE_AVX2
+
+// --- AVX2 kernels: four balances per instruction ---
+
+__attribute__((target("avx2"))) int64_t horizontalSum(__m256i v) {
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return static_cast<int64_t>(static_cast<uint64_t>(lanes[0]) + static_cast<uint64_t>(lanes[1]) +
+                                static_cast<uint64_t>(lanes[2]) + static_cast<uint64_t>(lanes[3]));
+}
+
+__attribute__((target("avx2"))) BalanceStats statsAvx2(const int64_t* balances, size_t n) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i lo = _mm256_set1_epi64x(std::numeric_limits<int64_t>::max());
+    __m256i hi = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(balances + i));
+        sum = _mm256_add_epi64(sum, v);
+        // AVX2 has no 64-bit min/max; compare and blend instead
+        lo = _mm256_blendv_epi8(lo, v, _mm256_cmpgt_epi64(lo, v));
+        hi = _mm256_blendv_epi8(hi, v, _mm256_cmpgt_epi64(v, hi));
+    }
+    alignas(32) int64_t loLanes[4], hiLanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(loLanes), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(hiLanes), hi);
+
+    BalanceStats tail = statsScalar(balances + i, n - i);
+    BalanceStats result;
+    result.count = n;
+    result.total = Money::fromPaisa(static_cast<int64_t>(static_cast<uint64_t>(horizontalSum(sum)) +
+                                                         static_cast<uint64_t>(tail.total.toPaisa())));
+    if (n > 0) {
+        int64_t minimum = std::min({loLanes[0], loLanes[1], loLanes[2], loLanes[3]});
+        int64_t maximum = std::max({hiLanes[0], hiLanes[1], hiLanes[2], hiLanes[3]});
+        if (tail.count > 0) {
+            minimum = std::min(minimum, tail.minimum.toPaisa());
+            maximum = std::max(maximum, tail.maximum.toPaisa());
+        }
+        result.minimum = Money::fromPaisa(minimum);
+        result.maximum = Money::fromPaisa(maximum);
+    }
+    return result;
+}
+
+__attribute__((target("avx2"))) size_t countBelowAvx2(const int64_t* balances, size_t n, int64_t threshold) {
+    __m256i limit = _mm256_set1_epi64x(threshold);
+    __m256i count = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(balances + i));
+        count = _mm256_sub_epi64(count, _mm256_cmpgt_epi64(limit, v)); // Each match is -1
+    }
+    return static_cast<size_t>(horizontalSum(count)) + countBelowScalar(balances + i, n - i, threshold);
+}
+
+__attribute__((target("avx2"))) void histogramAvx2(const int64_t* balances, size_t n, const int64_t* edges,
+                                                   size_t edgeCount, size_t* counts) {
+    // below[k] = balances under edges[k]; eight edges per pass keeps the
+    // accumulators in registers
+    const size_t EDGES_PER_PASS = 8;
+    std::vector<size_t> below(edgeCount, 0);
+    size_t vectorEnd = n - n % 4;
+    for (size_t first = 0; first < edgeCount; first += EDGES_PER_PASS) {
+        size_t group = std::min(EDGES_PER_PASS, edgeCount - first);
+        __m256i limits[EDGES_PER_PASS];
+        __m256i acc[EDGES_PER_PASS];
+        for (size_t k = 0; k < group; ++k) {
+            limits[k] = _mm256_set1_epi64x(edges[first + k]);
+            acc[k] = _mm256_setzero_si256();
+        }
+        for (size_t i = 0; i < vectorEnd; i += 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(balances + i));
+            for (size_t k = 0; k < group; ++k) {
+                acc[k] = _mm256_sub_epi64(acc[k], _mm256_cmpgt_epi64(limits[k], v));
+            }
+        }
+        for (size_t k = 0; k < group; ++k) {
+            below[first + k] = static_cast<size_t>(horizontalSum(acc[k])) +
+                               countBelowScalar(balances + vectorEnd, n - vectorEnd, edges[first + k]);
+        }
+    }
+    // Cumulative "below" counts to per-bucket counts
+    size_t previous = 0;
+    for (size_t k = 0; k < edgeCount; ++k) {
+        counts[k] = below[k] - previous;
+        previous = below[k];
+    }
+    counts[edgeCount] = n - previous;
+}
+
+#endif // ANALYTICS_HAVE_AVX2
+
+// The kernels selected for this CPU
+struct Kernels {
+    SimdLevel level;
+    BalanceStats (*stats)(const int64_t*, size_t);
+    size_t (*countBelow)(const int64_t*, size_t, int64_t);
+    void (*histogram)(const int64_t*, size_t, const int64_t*, size_t, size_t*);
+};
+
+Kernels kernelsFor(SimdLevel level) {
+#ifdef ANALYTICS_HAVE_AVX2
+    if (level == SimdLevel::AVX2) {
+        return Kernels{SimdLevel::AVX2, statsAvx2, countBelowAvx2, histogramAvx2};
+    }
+#endif
+    (void)level;
+    return Kernels{SimdLevel::SCALAR, statsScalar, countBelowScalar, histogramScalar};
+}
+
+SimdLevel detectLevel() {
+#ifdef ANALYTICS_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+Kernels& activeKernels() {
+    static Kernels kernels = kernelsFor(detectLevel());
+    return kernels;
+}
+
+// Print one row of the per-type table
+void printStatsRow(const char* label, const BalanceStats& s) {
+    std::cout << std::left << std::setw(26) << label << std::right
+              << std::setw(10) << s.count
+              << std::setw(20) << s.total.toString() // Money's operator<< ignores setw
+              << std::setw(16) << s.minimum.toString()
+              << std::setw(16) << s.maximum.toString() << std::endl;
+}
+
+} // namespace
+
+SimdLevel Analytics::detectedLevel() {
+    static SimdLevel level = detectLevel();
+    return level;
+}
+
+SimdLevel Analytics::activeLevel() {
+    return activeKernels().level;
+}
+
+void Analytics::setLevel(SimdLevel level) {
+    activeKernels() = kernelsFor(level == SimdLevel::AVX2 ? detectedLevel() : SimdLevel::SCALAR);
+}
+
+BalanceStats Analytics::stats(const int64_t* balances, size_t n) {
+    return activeKernels().stats(balances, n);
+}
+
+size_t Analytics::countBelow(const int64_t* balances, size_t n, Money threshold) {
+    return activeKernels().countBelow(balances, n, threshold.toPaisa());
+}
+
+void Analytics::histogram(const int64_t* balances, size_t n, const Money* edges, size_t edgeCount, size_t* counts) {
+    std::vector<int64_t> raw(edgeCount);
+    for (size_t k = 0; k < edgeCount; ++k) {
+        raw[k] = edges[k].toPaisa();
+    }
+    activeKernels().histogram(balances, n, raw.data(), edgeCount, counts);
+}
+
+// Print the balance report
+void Analytics::printReport(const BalanceColumns& columns, Money threshold) {
+    std::cout << "--- Balance Report (" << columns.size() << " accounts, "
+              << simdLevelToString(activeLevel()) << " kernels) ---" << std::endl;
+    std::cout << std::left << std::setw(26) << "Account Type" << std::right
+              << std::setw(10) << "Accounts"
+              << std::setw(20) << "Total (TK)"
+              << std::setw(16) << "Min (TK)"
+              << std::setw(16) << "Max (TK)" << std::endl;
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        AccountType type = static_cast<AccountType>(t);
+        if (columns.sizeOf(type) > 0) {
+            printStatsRow(accountTypeToString(type).c_str(), stats(columns.dataOf(type), columns.sizeOf(type)));
+        }
+    }
+    printStatsRow("All Accounts", stats(columns.data(), columns.size()));
+
+    // Decade buckets in taka
+    const Money edges[] = {Money(), Money::fromPaisa(100 * 100), Money::fromPaisa(1000 * 100),
+                           Money::fromPaisa(10000 * 100), Money::fromPaisa(100000 * 100),
+                           Money::fromPaisa(1000000 * 100), Money::fromPaisa(10000000 * 100)};
+    const size_t edgeCount = sizeof(edges) / sizeof(edges[0]);
+    const char* labels[edgeCount + 1] = {"below 0", "0 - 100", "100 - 1K", "1K - 10K", "10K - 100K",
+                                         "100K - 1M", "1M - 10M", "10M and above"};
+    size_t counts[edgeCount + 1];
+    histogram(columns.data(), columns.size(), edges, edgeCount, counts);
+
+    std::cout << "\nBalance (TK)        Accounts   Share  Cumulative" << std::endl;
+    size_t cumulative = 0;
+    double total = columns.size() > 0 ? static_cast<double>(columns.size()) : 1.0;
+    for (size_t b = 0; b <= edgeCount; ++b) {
+        cumulative += counts[b];
+        std::cout << std::left << std::setw(16) << labels[b] << std::right
+                  << std::setw(12) << counts[b]
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(7) << counts[b] * 100.0 / total << "%"
+                  << std::setw(10) << cumulative * 100.0 / total << "%"
+                  << std::defaultfloat << std::endl;
+    }
+
+    std::cout << "\nAccounts below TK. " << threshold << ": "
+              << countBelow(columns.data(), columns.size(), threshold) << std::endl;
+}
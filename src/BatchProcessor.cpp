@@ -0,0 +1,312 @@
+// src/BatchProcessor.cpp
+#include "BatchProcessor.h"
+#include "AccountIndex.h"  // For packAccountNumber
+#include "PostingEngine.h"
+#include "Transaction.h"   // For flushTransactionLog
+#include "UserAuth.h"
+#include "Utility.h"       // For isValidAmount, parallelFor
+#include <chrono>          // For std::chrono::steady_clock
+#include <fstream>
+#include <iostream>
+#include <string_view>     // For std::string_view
+#include <vector>
+
+namespace {
+
+// One operation line of the current batch
+struct BatchLine {
+    enum class Kind { REGISTER, POSTING, INVALID };
+
+    size_t lineNumber;
+    Kind kind;
+    std::string error;          // Why an INVALID line was rejected
+    size_t posting;             // Index into the batch's posting requests
+    std::string accountNumber;  // Register: requested number (may be empty)
+    std::string pin;            // Register only
+    PinCredential credential;   // Register only: the PIN hashed, before the account is added
+    std::string ownerName;      // Register only
+    AccountType accountType;    // Register only
+    Money initialDeposit;       // Register only
+    bool succeeded;
+    std::string detail;         // Result text: new account number or failure reason
+};
+
+// Split off the next comma-separated field; the last field takes the rest of the line
+std::string_view nextField(std::string_view& rest) {
+    size_t comma = rest.find(',');
+    std::string_view field = rest.substr(0, comma);
+    rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+    return field;
+}
+
+bool isAccountNumber(std::string_view text) {
+    uint64_t key;
+    return packAccountNumber(std::string(text), key);
+}
+
+// Map the registration menu numbering (1-9) onto an account type
+bool parseAccountType(std::string_view text, AccountType& type) {
+    if (text.size() != 1 || text[0] < '1' || text[0] > '9') {
+        return false;
+    }
+    type = static_cast<AccountType>(text[0] - '1');
+    return true;
+}
+
+bool isPin(std::string_view text) {
+    if (text.size() != 4) {
+        return false;
+    }
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parse and validate one operation line, adding postings to requests
+void parseLine(std::string_view text, BatchLine& line, std::vector<PostingRequest>& requests) {
+    line.kind = BatchLine::Kind::INVALID;
+    std::string_view rest = text;
+    std::string_view op = nextField(rest);
+
+    if (op == "register") {
+        std::string_view accNum = nextField(rest);
+        std::string_view pin = nextField(rest);
+        std::string_view type = nextField(rest);
+        std::string_view deposit = nextField(rest);
+        std::string_view name = rest;
+        if (!accNum.empty() && !isAccountNumber(accNum)) {
+            line.error = "Invalid account number";
+        } else if (!isPin(pin)) {
+            line.error = "PIN must be 4 digits";
+        } else if (!parseAccountType(type, line.accountType)) {
+            line.error = "Account type must be 1-9";
+        } else if (!Money::parse(deposit, line.initialDeposit) || !isValidAmount(line.initialDeposit)) {
+            line.error = "Invalid amount";
+        } else if (name.empty()) {
+            line.error = "Owner name is required";
+        } else {
+            line.kind = BatchLine::Kind::REGISTER;
+            line.accountNumber = std::string(accNum);
+            line.pin = std::string(pin);
+            line.ownerName = std::string(name);
+        }
+        return;
+    }
+
+    PostingKind kind;
+    if (op == "deposit") {
+        kind = PostingKind::DEPOSIT;
+    } else if (op == "withdraw") {
+        kind = PostingKind::WITHDRAWAL;
+    } else if (op == "transfer") {
+        kind = PostingKind::TRANSFER;
+    } else {
+        line.error = "Unknown operation";
+        return;
+    }
+    std::string_view accNum = nextField(rest);
+    std::string_view toAccNum = kind == PostingKind::TRANSFER ? nextField(rest) : std::string_view();
+    std::string_view amountText = nextField(rest);
+    Money amount;
+    if (!rest.empty()) {
+        line.error = "Too many fields";
+    } else if (!isAccountNumber(accNum) || (kind == PostingKind::TRANSFER && !isAccountNumber(toAccNum))) {
+        line.error = "Invalid account number";
+    } else if (!Money::parse(amountText, amount) || !isValidAmount(amount)) {
+        line.error = "Invalid amount";
+    } else {
+        line.kind = BatchLine::Kind::POSTING;
+        line.posting = requests.size();
+        requests.emplace_back(kind, std::string(accNum), std::string(toAccNum), amount);
+    }
+}
+
+// Validate and commit one batch, then append its result rows to out.
+// Returns false if a commit failed.
+bool processBatch(std::vector<BatchLine>& lines, const std::vector<PostingRequest>& requests,
+                  std::string& out, BatchSummary& summary) {
+    // Registrations first, saved by rewriting the shard files they land in so
+    // that the batch's postings only ever journal accounts that are on disk
+    std::vector<uint64_t> newKeys;
+    std::vector<BatchLine*> registrations;
+    size_t unnumbered = 0;
+    for (auto& line : lines) {
+        if (line.kind == BatchLine::Kind::REGISTER) {
+            registrations.push_back(&line);
+            unnumbered += line.accountNumber.empty();
+        }
+    }
+    // One allocator-state write for the whole batch
+    bool numbersReserved = unnumbered == 0 || UserAuth::reserveAccountNumbers(unnumbered);
+    if (!numbersReserved) {
+        std::cerr << "Error: Could not reserve account numbers; the batch's unnumbered registrations fail." << std::endl;
+    }
+    // Hashing a PIN is the slow part of a registration (see PinHash), so
+    // every PIN of the batch is hashed on several threads up front
+    parallelFor(registrations.size(), 16, [&registrations](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            registrations[i]->credential = PinHash::hash(registrations[i]->pin);
+        }
+    });
+    for (BatchLine* registration : registrations) {
+        BatchLine& line = *registration;
+        if (line.accountNumber.empty()) {
+            if (numbersReserved) {
+                line.detail = UserAuth::createAccount(line.credential, line.initialDeposit, line.ownerName,
+                                                      line.accountType, Account::NO_ACCOUNT_KEY);
+            }
+            line.succeeded = !line.detail.empty();
+            if (!line.succeeded) {
+                line.detail = "Could not allocate an account number";
+            }
+        } else if (UserAuth::addAccount(Account(line.accountNumber, line.credential, line.initialDeposit,
+                                                line.ownerName, line.accountType))) {
+            line.detail = line.accountNumber;
+            line.succeeded = true;
+        } else {
+            line.detail = "Account number already exists";
+        }
+        uint64_t key;
+        if (line.succeeded && packAccountNumber(line.detail, key)) {
+            newKeys.push_back(key);
+        }
+    }
+    // A shard file that could not be written takes its new accounts back out of memory
+    std::vector<bool> saved;
+    bool committed = newKeys.empty() || UserAuth::saveNewAccounts(newKeys, saved);
+    size_t next = 0;
+    for (auto& line : lines) {
+        if (line.kind == BatchLine::Kind::REGISTER && line.succeeded && !saved.empty() && !saved[next++]) {
+            line.succeeded = false;
+            line.detail = "Could not save accounts file";
+        }
+    }
+
+    std::vector<PostingResult> results;
+    bool registrationsSaved = committed;
+    if (committed && !requests.empty()) {
+        PostingEngine::applyBatch(requests, results);
+        // A failed journal commit rolls back every posting and reports it as PERSIST_FAILED
+        for (PostingResult result : results) {
+            if (result == PostingResult::PERSIST_FAILED) {
+                committed = false;
+                break;
+            }
+        }
+    }
+
+    for (auto& line : lines) {
+        switch (line.kind) {
+            case BatchLine::Kind::REGISTER:
+                break;
+            case BatchLine::Kind::POSTING:
+                if (!registrationsSaved) {
+                    line.detail = "Batch not applied";
+                } else if (results[line.posting] == PostingResult::SUCCESS) {
+                    line.succeeded = true;
+                } else {
+                    line.detail = postingResultToString(results[line.posting]);
+                }
+                break;
+            case BatchLine::Kind::INVALID:
+                line.detail = line.error;
+                break;
+        }
+        out += std::to_string(line.lineNumber);
+        out += line.succeeded ? ",OK," : ",FAILED,";
+        out += line.detail;
+        out += '\n';
+        if (line.succeeded) {
+            ++summary.succeeded;
+        } else {
+            ++summary.failed;
+        }
+    }
+    ++summary.batches;
+    return committed;
+}
+
+} // namespace
+
+// Run every operation in the input file, one batch at a time
+bool BatchProcessor::run(const BatchOptions& options, BatchSummary& summary) {
+    auto start = std::chrono::steady_clock::now();
+    summary = BatchSummary();
+
+    std::ifstream in(options.inputPath);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open batch input file " << options.inputPath << "." << std::endl;
+        return false;
+    }
+    std::string resultsPath = options.resultsPath.empty() ? options.inputPath + ".results" : options.resultsPath;
+    std::ofstream results(resultsPath, std::ios::trunc);
+    if (!results.is_open()) {
+        std::cerr << "Error: Could not open batch results file " << resultsPath << "." << std::endl;
+        return false;
+    }
+
+    size_t batchSize = options.batchSize == 0 ? 1 : options.batchSize;
+    std::vector<BatchLine> lines;
+    std::vector<PostingRequest> requests;
+    std::string out;
+    std::string text;
+    size_t lineNumber = 0;
+    bool ok = true;
+    lines.reserve(batchSize);
+    requests.reserve(batchSize);
+
+    while (ok) {
+        bool more = static_cast<bool>(std::getline(in, text));
+        if (more) {
+            ++lineNumber;
+            if (!text.empty() && text.back() == '\r') {
+                text.pop_back(); // Tolerate CRLF line endings
+            }
+            if (text.empty() || text[0] == '#') {
+                continue;
+            }
+            lines.emplace_back();
+            BatchLine& line = lines.back();
+            line.lineNumber = lineNumber;
+            line.succeeded = false;
+            parseLine(text, line, requests);
+            ++summary.lines;
+        }
+        if (lines.size() == batchSize || (!more && !lines.empty())) {
+            ok = processBatch(lines, requests, out, summary);
+            results << out;
+            if (!ok) {
+                std::cerr << "Error: Batch run stopped after line " << lineNumber << " because a commit failed." << std::endl;
+            }
+            out.clear();
+            lines.clear();
+            requests.clear();
+        }
+        if (!more) {
+            break;
+        }
+    }
+    results.flush();
+    if (!results) {
+        std::cerr << "Error: Could not write batch results file " << resultsPath << "." << std::endl;
+        ok = false;
+    }
+    if (!flushTransactionLog()) {
+        ok = false;
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+// Print the totals and throughput of a run
+void BatchProcessor::printSummary(const BatchSummary& summary) {
+    std::cout << "Batch complete: " << summary.lines << " operation(s), "
+              << summary.succeeded << " succeeded, " << summary.failed << " failed, "
+              << summary.batches << " commit(s)." << std::endl;
+    double rate = summary.seconds > 0.0 ? summary.lines / summary.seconds : 0.0;
+    std::cout << "Elapsed " << summary.seconds << " s (" << static_cast<size_t>(rate)
+              << " operations/sec)." << std::endl;
+}
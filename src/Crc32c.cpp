@@ -0,0 +1,100 @@
+// src/Crc32c.cpp
+#include "Crc32c.h"
+#include <cstring>     // For std::memcpy
+#if defined(__x86_64__)
+#include <immintrin.h> // For _mm_crc32_u64, _mm_crc32_u8
+#define CRC32C_HAVE_SSE42 1
+#endif
+
+namespace {
+
+const uint32_t CASTAGNOLI = 0x82f63b78; // Reversed CRC32C polynomial
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes
+struct Tables {
+    uint32_t table[8][256];
+
+    Tables() {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (CASTAGNOLI & (0u - (crc & 1)));
+            }
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+            }
+        }
+    }
+};
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+// Table-driven version, eight bytes per step (any CPU)
+uint32_t crcSoftware(const unsigned char* p, size_t size, uint32_t crc) {
+    const Tables& t = tables();
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word)); // Little-endian load
+        word ^= crc;
+        crc = t.table[7][word & 0xff] ^ t.table[6][(word >> 8) & 0xff] ^
+              t.table[5][(word >> 16) & 0xff] ^ t.table[4][(word >> 24) & 0xff] ^
+              t.table[3][(word >> 32) & 0xff] ^ t.table[2][(word >> 40) & 0xff] ^
+              t.table[1][(word >> 48) & 0xff] ^ t.table[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t.table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2"))) uint32_t crcHardware(const unsigned char* p, size_t size, uint32_t crc) {
+    uint64_t wide = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(wide);
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif // CRC32C_HAVE_SSE42
+
+bool detectHardware() {
+#ifdef CRC32C_HAVE_SSE42
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+bool crc32cIsHardware() {
+    static const bool hardware = detectHardware();
+    return hardware;
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#ifdef CRC32C_HAVE_SSE42
+    if (crc32cIsHardware()) {
+        return ~crcHardware(p, size, crc);
+    }
+#endif
+    return ~crcSoftware(p, size, crc);
+}
@@ -0,0 +1,348 @@
+// src/JobEngine.cpp
+#include "JobEngine.h"
+#include "Journal.h"     // For JournalRecord
+#include "Metrics.h"
+#include "Transaction.h" // For logTransactions
+#include "UserAuth.h"
+#include "Utility.h"     // For parallelFor, currentTimestamp
+#include <algorithm>     // For std::min, std::copy
+#include <chrono>        // For std::chrono::steady_clock
+#include <cstdio>        // For std::snprintf
+#include <iomanip>       // For std::setprecision
+#include <iostream>
+
+static const Histogram jobSeconds("bms_job_seconds", "Time to run a batch job over every account");
+static const Counter jobPostings("bms_job_postings_total", "Postings made by batch jobs");
+
+namespace {
+
+// One shard's part of a run
+struct ShardRun {
+    std::vector<uint32_t> byType;             // Positions of the shard's accounts, grouped by type
+    size_t typeStart[ACCOUNT_TYPE_COUNT + 1] = {}; // Accounts of type t are byType[typeStart[t], typeStart[t + 1])
+    std::vector<JournalRecord> records;       // Changes made, in order
+    std::vector<TransactionType> types;       // Log row type of each change
+    JobTypeTotals totals[ACCOUNT_TYPE_COUNT];
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t typeIndex(AccountType type) {
+    return std::min(static_cast<size_t>(type), ACCOUNT_TYPE_COUNT - 1);
+}
+
+// Sort the positions of a shard's accounts by type (a counting sort)
+void groupByType(const std::deque<Account>& accounts, ShardRun& run) {
+    size_t counts[ACCOUNT_TYPE_COUNT] = {};
+    for (const auto& acc : accounts) {
+        ++counts[typeIndex(acc.getAccountType())];
+    }
+    run.typeStart[0] = 0;
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        run.typeStart[t + 1] = run.typeStart[t] + counts[t];
+    }
+
+    run.byType.resize(accounts.size());
+    size_t next[ACCOUNT_TYPE_COUNT];
+    std::copy(run.typeStart, run.typeStart + ACCOUNT_TYPE_COUNT, next);
+    uint32_t position = 0;
+    for (const auto& acc : accounts) {
+        run.byType[next[typeIndex(acc.getAccountType())]++] = position++;
+    }
+}
+
+// Interest for one month on a balance at an annual rate in basis points,
+// rounded down to the paisa. Returns false if it would overflow.
+bool monthlyInterest(Money balance, uint32_t annualRateBasisPoints, Money& interest) {
+    const int64_t divisor = 10000 * 12;
+    const int64_t rate = annualRateBasisPoints;
+    int64_t paisa = std::max<int64_t>(balance.toPaisa(), 0); // No interest on an overdrawn balance
+    int64_t whole = 0;
+    int64_t total = 0;
+    if (__builtin_mul_overflow(paisa / divisor, rate, &whole) ||
+        __builtin_add_overflow(whole, paisa % divisor * rate / divisor, &total)) {
+        return false;
+    }
+    interest = Money::fromPaisa(total);
+    return true;
+}
+
+// Apply a signed change that has already been checked to an account the run has locked
+void record(Account& acc, Money delta, TransactionType type, ShardRun& run, JobTypeTotals& totals) {
+    Money newBalance;
+    acc.getBalance().add(delta, newBalance);
+    acc.setBalance(newBalance);
+    JournalRecord rec;
+    rec.accountKey = acc.getAccountKey();
+    rec.delta = delta;
+    rec.newBalance = newBalance;
+    rec.following = 0;
+    rec.reserved = 0;
+    run.records.push_back(rec);
+    run.types.push_back(type);
+    ++totals.postings;
+    if (delta > Money()) {
+        totals.credited.add(delta, totals.credited);
+    } else {
+        totals.debited.subtract(delta, totals.debited);
+    }
+}
+
+// Apply a signed change to an account the run has locked, under the same
+// rules as a posting: a debit may not overdraw the account
+void post(Account& acc, Money delta, ShardRun& run, JobTypeTotals& totals) {
+    Money newBalance;
+    if (!acc.getBalance().add(delta, newBalance) || (delta < Money() && newBalance < Money())) {
+        ++totals.skipped;
+        return;
+    }
+    record(acc, delta, delta > Money() ? TransactionType::DEPOSIT : TransactionType::WITHDRAWAL, run, totals);
+}
+
+// Move an installment into an account from its funding account, under the
+// same rules as a transfer. Both legs are checked before either is applied,
+// so a refused installment changes nothing.
+void fundInstallment(Account& acc, Account* funding, Money amount, ShardRun& run, JobTypeTotals& totals) {
+    Money fundingBalance;
+    Money newBalance;
+    Money debit;
+    if (!funding || funding == &acc || !funding->getBalance().subtract(amount, fundingBalance) ||
+        fundingBalance < Money() || !acc.getBalance().add(amount, newBalance) || !Money().subtract(amount, debit)) {
+        ++totals.skipped;
+        return;
+    }
+    record(*funding, debit, TransactionType::TRANSFER_OUT, run, totals);
+    record(acc, amount, TransactionType::TRANSFER_IN, run, totals);
+}
+
+// Run every rule over the accounts of its type in one shard
+void applyRules(std::deque<Account>& accounts, const std::vector<JobRule>& rules, ShardRun& run) {
+    for (const auto& rule : rules) {
+        size_t t = typeIndex(rule.type);
+        JobTypeTotals& totals = run.totals[t];
+        const uint32_t* first = run.byType.data() + run.typeStart[t];
+        const uint32_t* last = run.byType.data() + run.typeStart[t + 1];
+        for (const uint32_t* position = first; position != last; ++position) {
+            Account& acc = accounts[*position];
+            if (rule.annualRateBasisPoints != 0) {
+                Money interest;
+                if (!monthlyInterest(acc.getBalance(), rule.annualRateBasisPoints, interest)) {
+                    ++totals.skipped;
+                } else if (interest > Money()) {
+                    post(acc, interest, run, totals);
+                }
+            }
+            if (rule.installment < Money()) {
+                post(acc, rule.installment, run, totals); // Funded installments run after every shard
+            }
+        }
+    }
+}
+
+} // namespace
+
+// The month-end rules applied by --month-end
+std::vector<JobRule> JobEngine::monthEndRules() {
+    return {
+        JobRule(AccountType::SAVINGS, 350, Money()),
+        JobRule(AccountType::JOINT, 350, Money()),
+        JobRule(AccountType::SALARY, 350, Money()),
+        JobRule(AccountType::STUDENT, 400, Money()),
+        JobRule(AccountType::FIXED_DEPOSIT, 700, Money()),
+        JobRule(AccountType::RECURRING_DEPOSIT, 650, Money::fromPaisa(1000 * 100)), // TK. 1000 installment
+        JobRule(AccountType::LOAN, 0, Money::fromPaisa(-2500 * 100)),               // TK. 2500 EMI
+    };
+}
+
+// Parse "YYYY-MM" into YYYYMM
+bool JobEngine::parsePeriod(const std::string& text, uint32_t& period) {
+    if (text.size() != 7 || text[4] != '-') {
+        return false;
+    }
+    uint32_t value = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (i == 4) {
+            continue;
+        }
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint32_t>(text[i] - '0');
+    }
+    if (value % 100 < 1 || value % 100 > 12) {
+        return false;
+    }
+    period = value;
+    return true;
+}
+
+// Format YYYYMM as "YYYY-MM"
+std::string JobEngine::formatPeriod(uint32_t period) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04u-%02u", period / 100, period % 100);
+    return text;
+}
+
+// Apply the rules to every account and persist the result, with the period's marker, as one journal group
+bool JobEngine::run(const std::vector<JobRule>& rules, uint32_t period, JobSummary& summary) {
+    ScopedTimer timer(jobSeconds);
+    auto start = std::chrono::steady_clock::now();
+    summary = JobSummary();
+    summary.period = period;
+    // One run per shard, then one for the funded installments
+    std::vector<ShardRun> runs(UserAuth::SHARD_COUNT + 1);
+    {
+        // Every shard locked exclusively: no other posting can run, so no stripe locks are needed
+        auto locks = UserAuth::lockAllShards();
+        if (period <= UserAuth::jobPeriod) {
+            std::cerr << "Error: The month-end jobs for " << formatPeriod(period)
+                      << " were already applied (last applied: " << formatPeriod(UserAuth::jobPeriod)
+                      << "); nothing was posted." << std::endl;
+            summary.refused = true;
+            return false;
+        }
+        auto phaseStart = std::chrono::steady_clock::now();
+        parallelFor(UserAuth::SHARD_COUNT, 1, [&runs](size_t first, size_t last) {
+            for (size_t s = first; s < last; ++s) {
+                groupByType(UserAuth::shards[s].accounts, runs[s]);
+            }
+        });
+        summary.groupMs = millisecondsSince(phaseStart);
+
+        phaseStart = std::chrono::steady_clock::now();
+        parallelFor(UserAuth::SHARD_COUNT, 1, [&runs, &rules](size_t first, size_t last) {
+            for (size_t s = first; s < last; ++s) {
+                applyRules(UserAuth::shards[s].accounts, rules, runs[s]);
+            }
+        });
+
+        // Funded installments debit an account that may sit in any shard
+        ShardRun& funded = runs[UserAuth::SHARD_COUNT];
+        for (const auto& rule : rules) {
+            if (rule.installment <= Money()) {
+                continue;
+            }
+            size_t t = typeIndex(rule.type);
+            for (size_t s = 0; s < UserAuth::SHARD_COUNT; ++s) {
+                for (size_t i = runs[s].typeStart[t]; i < runs[s].typeStart[t + 1]; ++i) {
+                    Account& acc = UserAuth::shards[s].accounts[runs[s].byType[i]];
+                    uint64_t fundingKey = acc.getFundingAccountKey();
+                    Account* funding = fundingKey == Account::NO_ACCOUNT_KEY
+                                           ? nullptr
+                                           : UserAuth::shardFor(fundingKey).index.find(fundingKey);
+                    fundInstallment(acc, funding, rule.installment, funded, funded.totals[t]);
+                }
+            }
+        }
+
+        // Gather every shard's changes into one journal group and their log rows
+        std::vector<size_t> offset(runs.size() + 1, 0);
+        for (size_t s = 0; s < runs.size(); ++s) {
+            offset[s + 1] = offset[s] + runs[s].records.size();
+        }
+        std::vector<JournalRecord> records(offset.back());
+        std::vector<Transaction> rows(offset.back());
+        int64_t now = currentTimestamp();
+        parallelFor(runs.size(), 1, [&](size_t first, size_t last) {
+            for (size_t s = first; s < last; ++s) {
+                for (size_t i = 0; i < runs[s].records.size(); ++i) {
+                    const JournalRecord& rec = runs[s].records[i];
+                    Money amount = rec.delta;
+                    if (rec.delta < Money()) {
+                        Money().subtract(rec.delta, amount); // Log rows carry the unsigned amount
+                    }
+                    records[offset[s] + i] = rec;
+                    rows[offset[s] + i] = Transaction(rec.accountKey, runs[s].types[i], amount, now);
+                }
+                std::vector<JournalRecord>().swap(runs[s].records); // Copied; free it before the next shard
+                std::vector<TransactionType>().swap(runs[s].types);
+            }
+        });
+        summary.applyMs = millisecondsSince(phaseStart);
+
+        // One journal group, one write and one fsync for the whole run; the
+        // period's marker comes last, so it commits with the postings
+        phaseStart = std::chrono::steady_clock::now();
+        size_t postings = records.size();
+        JournalRecord marker{};
+        marker.accountKey = JOURNAL_PERIOD_KEY;
+        marker.newBalance = Money::fromPaisa(period);
+        records.push_back(marker);
+        // Every journaled change must keep its log row, so refuse the run while the logger cannot hold them
+        bool logAccepts = transactionLogAccepts(rows.size());
+        summary.persisted = logAccepts && UserAuth::recordPostings(records.data(), records.size(), true);
+        if (summary.persisted) {
+            UserAuth::recordJobPeriod(period);
+        } else {
+            // Not durable, so put back every balance (in reverse, as each record knows the one it replaced)
+            for (size_t i = postings; i-- > 0;) {
+                Money oldBalance;
+                records[i].newBalance.subtract(records[i].delta, oldBalance);
+                UserAuth::shardFor(records[i].accountKey).index.find(records[i].accountKey)->setBalance(oldBalance);
+            }
+            std::cerr << "Error: Could not " << (logAccepts ? "journal" : "log") << " the job's " << postings
+                      << " posting(s); every balance was left as it was." << std::endl;
+        }
+        summary.journalMs = millisecondsSince(phaseStart);
+
+        phaseStart = std::chrono::steady_clock::now();
+        if (summary.persisted) {
+            summary.logged = logTransactions(rows.data(), rows.size());
+        }
+        summary.logMs = millisecondsSince(phaseStart);
+    }
+    UserAuth::checkpointIfDue(); // Writes the run's balances to the shard files in the background
+
+    bool covered[ACCOUNT_TYPE_COUNT] = {};
+    for (const auto& rule : rules) {
+        covered[typeIndex(rule.type)] = true;
+    }
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        JobTypeTotals& totals = summary.byType[t];
+        for (const auto& run : runs) {
+            totals.accounts += covered[t] ? run.typeStart[t + 1] - run.typeStart[t] : 0;
+            totals.postings += run.totals[t].postings;
+            totals.skipped += run.totals[t].skipped;
+            totals.credited.add(run.totals[t].credited, totals.credited);
+            totals.debited.add(run.totals[t].debited, totals.debited);
+        }
+        summary.postings += totals.postings;
+        summary.skipped += totals.skipped;
+    }
+    for (const auto& run : runs) {
+        summary.accounts += run.byType.size();
+    }
+    if (summary.persisted) {
+        jobPostings.add(summary.postings);
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary.persisted;
+}
+
+// Print the per-type totals and the timing of a run
+void JobEngine::printSummary(const JobSummary& summary) {
+    if (summary.refused) {
+        return;
+    }
+    std::cout << "Job run for " << formatPeriod(summary.period) << " "
+              << (summary.persisted ? "complete" : "rolled back") << ": " << summary.accounts
+              << " account(s), " << summary.postings << " posting(s), " << summary.skipped << " skipped."
+              << std::endl;
+    for (size_t t = 0; t < ACCOUNT_TYPE_COUNT; ++t) {
+        const JobTypeTotals& totals = summary.byType[t];
+        if (totals.accounts == 0) {
+            continue;
+        }
+        std::cout << "  " << accountTypeToString(static_cast<AccountType>(t)) << ": " << totals.accounts
+                  << " account(s), " << totals.postings << " posting(s), " << totals.skipped
+                  << " skipped, credited TK. " << totals.credited << ", debited TK. " << totals.debited << std::endl;
+    }
+    if (summary.persisted && !summary.logged) {
+        std::cout << "  The log rows could not all be written; the rest are held in memory and retried." << std::endl;
+    }
+    std::cout << std::fixed << std::setprecision(1) << "Elapsed " << summary.seconds * 1000.0 << " ms (group "
+              << summary.groupMs << ", rules " << summary.applyMs << ", journal " << summary.journalMs << ", log "
+              << summary.logMs << ")." << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,274 @@
+// src/Journal.cpp
+#include "Journal.h"
+#include <cstring>    // For std::memcmp, std::memcpy
+#include <filesystem> // For std::filesystem::resize_file
+#include <iostream>
+#include <vector>
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For fsync, fdatasync, ftruncate
+
+// Flush a stdio stream and push its data to stable storage; false if either step failed
+static bool syncFile(std::FILE* f) {
+    return std::fflush(f) == 0 && fdatasync(fileno(f)) == 0;
+}
+
+// Make a rename in the directory holding path durable
+static void syncDirectoryOf(const std::string& path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+}
+
+// Read current-format records up to the end of in. A group is applied only
+// once its last record has been read. Returns the number of records applied.
+static size_t readGroups(std::FILE* in, const std::function<void(const JournalRecord&)>& apply) {
+    std::vector<JournalRecord> group;
+    JournalRecord record;
+    size_t committed = 0;
+    while (std::fread(&record, sizeof(record), 1, in) == 1) {
+        group.push_back(record);
+        if (record.following != 0) {
+            continue;
+        }
+        for (const auto& rec : group) {
+            apply(rec);
+        }
+        committed += group.size();
+        group.clear();
+    }
+    return committed;
+}
+
+Journal::Journal(const std::string& filePath, size_t recordsPerSync)
+    : path(filePath), rotatedPath(filePath + ".prev"), file(nullptr), groupSize(recordsPerSync == 0 ? 1 : recordsPerSync),
+      pendingSync(0), recordCount(0), torn(false) {}
+
+Journal::~Journal() {
+    if (file) {
+        syncLocked();
+        std::fclose(file);
+    }
+}
+
+// Open the journal file for appending (creating it with a header if needed)
+bool Journal::openForAppend() {
+    if (file) {
+        return true;
+    }
+    if (torn) {
+        return false;
+    }
+    file = std::fopen(path.c_str(), "ab");
+    if (!file) {
+        std::cerr << "Error: Could not open journal file for writing." << std::endl;
+        return false;
+    }
+    // Groups are written through at once anyway; with no stdio buffer a failed
+    // write leaves nothing behind to reach the file after it is cut back
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    std::fseek(file, 0, SEEK_END);
+    if (std::ftell(file) == 0) {
+        JournalHeader header;
+        std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+        header.version = JOURNAL_VERSION;
+        header.recordSize = sizeof(JournalRecord);
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1 || std::fflush(file) != 0) {
+            std::cerr << "Error: Could not write journal file header." << std::endl;
+            if (ftruncate(fileno(file), 0) != 0) {
+                torn = true; // A partial header would make the file unreadable
+            }
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append an all-or-nothing group of records
+bool Journal::appendGroup(JournalRecord* records, size_t count, bool syncNow) {
+    for (size_t i = 0; i < count; ++i) {
+        records[i].following = static_cast<uint32_t>(count - 1 - i);
+        records[i].reserved = 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!openForAppend()) {
+        return false;
+    }
+    long start = std::ftell(file);
+    if (start < 0) {
+        std::cerr << "Error: Could not write to journal file." << std::endl;
+        return false;
+    }
+    // Hand the group to the OS so a process crash cannot lose it
+    bool written = std::fwrite(records, sizeof(JournalRecord), count, file) == count && std::fflush(file) == 0;
+    if (written) {
+        pendingSync += count;
+        if (syncNow || pendingSync >= groupSize) {
+            written = syncLocked();
+        }
+        if (!written) {
+            pendingSync -= count;
+        }
+    }
+    if (!written) {
+        std::cerr << "Error: Could not write to journal file." << std::endl;
+        // Cut the group off: replay would otherwise join its records to the next group
+        if (ftruncate(fileno(file), start) != 0) {
+            std::cerr << "Error: Could not remove a partly written journal group; refusing further postings." << std::endl;
+            torn = true;
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+        std::clearerr(file);
+        std::fseek(file, 0, SEEK_END);
+        return false;
+    }
+    recordCount += count;
+    return true;
+}
+
+// Returns false if the pending records could not be forced to stable storage
+bool Journal::syncLocked() {
+    if (file && pendingSync > 0) {
+        if (!syncFile(file)) {
+            return false;
+        }
+        pendingSync = 0;
+    }
+    return true;
+}
+
+// Replay the records of a rotated journal left by a checkpoint that did not
+// finish; the caller holds the mutex. It was written by this version, so it
+// has a header and current-format records.
+size_t Journal::replayRotated(const std::function<void(const JournalRecord&)>& apply) {
+    std::FILE* in = std::fopen(rotatedPath.c_str(), "rb");
+    if (!in) {
+        return 0;
+    }
+    JournalHeader header;
+    size_t count = 0;
+    bool damaged = false;
+    if (std::fread(&header, sizeof(header), 1, in) == 1) { // An empty file holds nothing to replay
+        damaged = std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+                  header.version != JOURNAL_VERSION || header.recordSize != sizeof(JournalRecord);
+        if (!damaged) {
+            count = readGroups(in, apply);
+        }
+    }
+    std::fclose(in);
+    if (damaged) {
+        std::cerr << "Error: Rotated journal file is damaged; not replayed." << std::endl;
+    } else if (count == 0) {
+        std::remove(rotatedPath.c_str()); // Holds nothing a checkpoint still needs
+    }
+    return count;
+}
+
+// Replay every complete record in the journal, rotated records first
+size_t Journal::replay(const std::function<void(const JournalRecord&)>& apply) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t rotated = replayRotated(apply);
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        recordCount = 0;
+        return rotated; // No journal yet
+    }
+
+    JournalHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1) {
+        std::fclose(in);
+        std::remove(path.c_str()); // Empty, or a header torn by a crash: holds no records
+        recordCount = 0;
+        return rotated;
+    }
+    const char* problem = nullptr;
+    if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0) {
+        problem = "is damaged";
+    } else if (header.version != JOURNAL_VERSION) {
+        problem = "was written by an unknown version";
+    } else if (header.recordSize != sizeof(JournalRecord)) {
+        problem = "has an unexpected record size";
+    }
+    if (problem) {
+        // Move it aside: appending to it would mix formats, and the next reset would destroy it
+        std::fclose(in);
+        std::rename(path.c_str(), (path + ".corrupt").c_str()); // Later appends start a clean file
+        std::cerr << "Error: Journal file " << problem << "; not replayed and kept as " << path << ".corrupt."
+                  << std::endl;
+        recordCount = 0;
+        return rotated;
+    }
+    size_t count = readGroups(in, apply);
+    size_t validBytes = sizeof(JournalHeader) + count * sizeof(JournalRecord);
+    std::fclose(in);
+
+    // Drop a torn tail so later appends stay record-aligned
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) != validBytes && !ec) {
+        std::filesystem::resize_file(path, validBytes, ec);
+    }
+    recordCount = count;
+    return rotated + count;
+}
+
+// Discard all records
+void Journal::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    std::FILE* f = std::fopen(path.c_str(), "wb"); // Truncate
+    if (f) {
+        syncFile(f);
+        std::fclose(f);
+    }
+    std::remove(rotatedPath.c_str());
+    pendingSync = 0;
+    recordCount = 0;
+    torn = false; // The file no longer holds the group that could not be removed
+}
+
+// Move the records so far aside and start an empty journal
+bool Journal::rotate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code ec;
+    if (std::filesystem::exists(rotatedPath, ec)) {
+        return false; // The last rotated records are not in a saved snapshot yet
+    }
+    if (file) {
+        std::fclose(file); // Flushes; the next append opens the new file
+        file = nullptr;
+    }
+    if (std::filesystem::exists(path, ec) && std::rename(path.c_str(), rotatedPath.c_str()) != 0) {
+        return false;
+    }
+    pendingSync = 0; // Left to syncRotated
+    recordCount = 0;
+    return true;
+}
+
+// fsync the rotated file and the rename that created it
+void Journal::syncRotated() {
+    std::FILE* f = std::fopen(rotatedPath.c_str(), "ab");
+    if (f) {
+        syncFile(f);
+        std::fclose(f);
+    }
+    syncDirectoryOf(rotatedPath);
+}
+
+void Journal::discardRotated() {
+    std::remove(rotatedPath.c_str());
+}
+
+size_t Journal::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recordCount;
+}
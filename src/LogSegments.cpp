@@ -0,0 +1,745 @@
+// src/LogSegments.cpp
+#include "LogSegments.h"
+#include "AccountIndex.h"      // For packAccountNumber
+#include "Metrics.h"
+#include "Money.h"
+#include "Transaction.h"       // For stringToTransactionType
+#include "TransactionLogReader.h"
+#include "TransactionLogger.h"
+#include "Utility.h"           // For parseDateTime, formatTimestamp
+#include <algorithm>           // For std::stable_sort, std::lower_bound, std::max
+#include <chrono>              // For std::chrono::seconds
+#include <cstdio>              // For std::rename, std::remove
+#include <cstring>             // For std::memcmp, std::memcpy
+#include <fcntl.h>             // For open
+#include <filesystem>          // For std::filesystem::create_directories, directory_iterator
+#include <fstream>
+#include <iostream>
+#include <string_view>         // For std::string_view
+#include <sys/mman.h>          // For mmap, munmap
+#include <sys/stat.h>          // For fstat, stat
+#include <unistd.h>            // For write, pwrite, fsync, close
+
+static const Counter blocksDecoded("bms_segment_blocks_decoded_total", "Sealed log blocks decoded by queries");
+static const Counter blocksSkipped("bms_segment_blocks_skipped_total", "Sealed log blocks queries ruled out by their RowRange");
+
+// How long the sealer waits before retrying a segment it could not seal
+static const std::chrono::seconds SEAL_RETRY_DELAY(1);
+
+// fsync a directory, making the renames in it durable
+static bool syncDirectory(const std::string& directory) {
+    int dir = ::open(directory.c_str(), O_RDONLY);
+    if (dir < 0) {
+        return false;
+    }
+    bool synced = fsync(dir) == 0;
+    ::close(dir);
+    return synced;
+}
+
+namespace {
+
+// Append v as an LEB128 varint
+void putVarint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Read a varint, advancing p; returns false if it runs past end
+bool getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Map signed values onto unsigned ones so small magnitudes stay short
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+template <typename T>
+void putRaw(std::vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// Encode rows [first, last) as one block of four columns
+void encodeBlock(const Transaction* first, const Transaction* last, SegmentEncoding encoding, std::vector<char>& out) {
+    out.clear();
+    if (encoding == SegmentEncoding::RAW) {
+        for (const Transaction* r = first; r != last; ++r) putRaw(out, r->accountKey);
+        for (const Transaction* r = first; r != last; ++r) out.push_back(static_cast<char>(r->type));
+        for (const Transaction* r = first; r != last; ++r) putRaw(out, r->amount.toPaisa());
+        for (const Transaction* r = first; r != last; ++r) putRaw(out, r->timestamp);
+        return;
+    }
+    // Keys are sorted, so their deltas are small and never negative
+    uint64_t previousKey = 0;
+    for (const Transaction* r = first; r != last; ++r) {
+        putVarint(out, r->accountKey - previousKey);
+        previousKey = r->accountKey;
+    }
+    for (const Transaction* r = first; r != last; ++r) out.push_back(static_cast<char>(r->type));
+    for (const Transaction* r = first; r != last; ++r) putVarint(out, zigzag(r->amount.toPaisa()));
+    // Timestamps step back when the account changes, hence zigzag
+    int64_t previousTime = 0;
+    for (const Transaction* r = first; r != last; ++r) {
+        putVarint(out, zigzag(r->timestamp - previousTime));
+        previousTime = r->timestamp;
+    }
+}
+
+// Decode one block into rows; returns false if the block is damaged
+bool decodeBlock(const char* data, const SegmentBlock& block, SegmentEncoding encoding, std::vector<Transaction>& rows) {
+    rows.resize(block.rows);
+    const char* p = data + block.offset;
+    const char* end = p + block.size;
+    if (encoding == SegmentEncoding::RAW) {
+        if (block.size != static_cast<uint64_t>(block.rows) * 25) {
+            return false;
+        }
+        for (auto& r : rows) { std::memcpy(&r.accountKey, p, 8); p += 8; }
+        for (auto& r : rows) { r.type = static_cast<TransactionType>(*p++); }
+        for (auto& r : rows) { int64_t paisa; std::memcpy(&paisa, p, 8); r.amount = Money::fromPaisa(paisa); p += 8; }
+        for (auto& r : rows) { std::memcpy(&r.timestamp, p, 8); p += 8; }
+        return true;
+    }
+    uint64_t v;
+    uint64_t key = 0;
+    for (auto& r : rows) {
+        if (!getVarint(p, end, v)) return false;
+        key += v;
+        r.accountKey = key;
+    }
+    if (static_cast<size_t>(end - p) < rows.size()) {
+        return false;
+    }
+    for (auto& r : rows) { r.type = static_cast<TransactionType>(*p++); }
+    for (auto& r : rows) {
+        if (!getVarint(p, end, v)) return false;
+        r.amount = Money::fromPaisa(unzigzag(v));
+    }
+    int64_t time = 0;
+    for (auto& r : rows) {
+        if (!getVarint(p, end, v)) return false;
+        time += unzigzag(v);
+        r.timestamp = time;
+    }
+    return p == end;
+}
+
+// Parse a legacy CSV log row "account,type,amount,YYYY-MM-DD HH:MM:SS"
+bool parseCsvRow(std::string_view line, Transaction& row) {
+    size_t c1 = line.find(',');
+    size_t c2 = c1 == std::string_view::npos ? c1 : line.find(',', c1 + 1);
+    size_t c3 = c2 == std::string_view::npos ? c2 : line.find(',', c2 + 1);
+    if (c3 == std::string_view::npos) {
+        return false;
+    }
+    Money amount;
+    if (!packAccountNumber(std::string(line.substr(0, c1)), row.accountKey) ||
+        !Money::parse(line.substr(c2 + 1, c3 - c2 - 1), amount) ||
+        !parseDateTime(line.substr(c3 + 1), row.timestamp)) {
+        return false;
+    }
+    row.type = stringToTransactionType(std::string(line.substr(c1 + 1, c2 - c1 - 1)));
+    row.amount = amount;
+    return true;
+}
+
+// Local YYYYMMDD of epoch seconds
+uint32_t dayOfTimestamp(int64_t timestamp) {
+    char date[TIMESTAMP_TEXT_LENGTH];
+    formatTimestamp(timestamp, date); // Cached per minute, so this is cheap on every append
+    uint32_t day = 0;
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        day = day * 10 + static_cast<uint32_t>(date[i] - '0');
+    }
+    return day;
+}
+
+// Write all of data at the current file position
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+// A sealed segment, mapped read-only for as long as it is published
+struct LogSegments::Segment {
+    uint64_t number;
+    int fd;
+    const char* data;
+    size_t size;
+
+    Segment() : number(0), fd(-1), data(nullptr), size(0) {}
+
+    ~Segment() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    const SegmentHeader& header() const { return *reinterpret_cast<const SegmentHeader*>(data); }
+    const SegmentBlock* blocks() const { return reinterpret_cast<const SegmentBlock*>(data + header().directoryOffset); }
+    SegmentEncoding encoding() const { return static_cast<SegmentEncoding>(header().encoding); }
+
+    // Summary of block b
+    RowRange range(uint64_t b) const {
+        RowRange r;
+        std::memcpy(&r, data + header().rangeOffset + b * sizeof(RowRange), sizeof(r));
+        return r;
+    }
+
+    // Whether any row of the segment can fall within the filter's times
+    bool overlaps(const RowFilter& filter) const {
+        return header().firstTimestamp <= filter.toTimestamp && header().lastTimestamp >= filter.fromTimestamp;
+    }
+
+    // Check that the header, RowRange array and block directory describe this file
+    bool valid() const {
+        if (size < sizeof(SegmentHeader)) {
+            return false;
+        }
+        const SegmentHeader& hdr = header();
+        if (std::memcmp(hdr.magic, SEGMENT_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != SEGMENT_VERSION ||
+            hdr.encoding > static_cast<uint32_t>(SegmentEncoding::VARINT) ||
+            hdr.directoryOffset < sizeof(SegmentHeader) || hdr.directoryOffset > size ||
+            (size - hdr.directoryOffset) / sizeof(SegmentBlock) != hdr.blockCount ||
+            (size - hdr.directoryOffset) % sizeof(SegmentBlock) != 0 ||
+            hdr.rangeOffset < sizeof(SegmentHeader) || hdr.rangeOffset > hdr.directoryOffset ||
+            hdr.directoryOffset - hdr.rangeOffset != hdr.blockCount * sizeof(RowRange)) {
+            return false;
+        }
+        // Block data ends where the RowRange array starts
+        uint64_t dataEnd = hdr.rangeOffset;
+        for (uint64_t b = 0; b < hdr.blockCount; ++b) {
+            const SegmentBlock& block = blocks()[b];
+            if (block.offset < sizeof(SegmentHeader) || block.offset + block.size > dataEnd ||
+                block.rows == 0 || block.rows > SEGMENT_BLOCK_ROWS) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+LogSegments::LogSegments(const std::string& activeLogFile, const std::string& segmentDirectory,
+                         const SegmentPolicy& segmentPolicy)
+    : activePath(activeLogFile), directory(segmentDirectory), policy(segmentPolicy),
+      nextNumber(1), activeDay(0), sealing(0), stopping(false) {}
+
+LogSegments::~LogSegments() {
+    {
+        std::lock_guard<std::mutex> lock(sealMutex);
+        stopping = true;
+    }
+    sealChanged.notify_all();
+    if (sealer.joinable()) {
+        sealer.join(); // Closed segments still queued are sealed on the next open()
+    }
+}
+
+// Path of segment number with the given extension, e.g. data/logs/00000042.seg
+std::string LogSegments::pathFor(uint64_t number, const char* extension) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%08llu%s", static_cast<unsigned long long>(number), extension);
+    return directory + "/" + name;
+}
+
+// Path of a closed segment: binary, or CSV if it predates the binary log
+std::string LogSegments::closedPathFor(uint64_t number) const {
+    std::string binary = pathFor(number, ".dat");
+    struct stat st;
+    return stat(binary.c_str(), &st) == 0 ? binary : pathFor(number, ".csv");
+}
+
+// Map a sealed segment and publish it; the caller holds segmentsMutex exclusively or is open()
+bool LogSegments::mapSegment(uint64_t number) {
+    std::unique_ptr<Segment> segment(new Segment());
+    segment->number = number;
+    segment->fd = ::open(pathFor(number, ".seg").c_str(), O_RDONLY);
+    struct stat st;
+    if (segment->fd < 0 || fstat(segment->fd, &st) != 0 || st.st_size == 0) {
+        return false;
+    }
+    segment->size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, segment->size, PROT_READ, MAP_SHARED, segment->fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    segment->data = static_cast<const char*>(mapping);
+    if (!segment->valid()) {
+        return false;
+    }
+    // Segments are published in number order; keep the vector sorted if one arrives late
+    auto position = std::lower_bound(segments.begin(), segments.end(), number,
+                                     [](const std::unique_ptr<Segment>& s, uint64_t n) { return s->number < n; });
+    segments.insert(position, std::move(segment));
+    return true;
+}
+
+// Map the sealed segments and queue closed ones that were never sealed
+bool LogSegments::open() {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create log segment directory " << directory << "." << std::endl;
+        return false;
+    }
+
+    std::vector<uint64_t> sealed;
+    std::vector<uint64_t> closed;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() != 12 || name.find_first_not_of("0123456789") != 8) {
+            continue;
+        }
+        uint64_t number = std::stoull(name.substr(0, 8));
+        std::string extension = name.substr(8);
+        if (extension == ".seg") {
+            sealed.push_back(number);
+        } else if (extension == ".dat" || extension == ".csv") {
+            closed.push_back(number);
+        }
+        nextNumber = std::max(nextNumber, number + 1);
+    }
+    std::sort(sealed.begin(), sealed.end());
+    std::sort(closed.begin(), closed.end());
+
+    for (uint64_t number : sealed) {
+        bool haveClosed = std::binary_search(closed.begin(), closed.end(), number);
+        if (!mapSegment(number)) {
+            if (haveClosed) {
+                std::remove(pathFor(number, ".seg").c_str()); // Reseal it from the CSV below
+            } else {
+                std::cerr << "Error: Log segment " << pathFor(number, ".seg") << " is damaged; skipping it." << std::endl;
+            }
+        }
+    }
+    for (uint64_t number : closed) {
+        bool isSealed = std::any_of(segments.begin(), segments.end(),
+                                    [number](const std::unique_ptr<Segment>& s) { return s->number == number; });
+        if (isSealed) {
+            std::remove(closedPathFor(number).c_str()); // Crashed between sealing and cleanup
+        } else {
+            toSeal.push_back(number);
+        }
+    }
+
+    // The active segment's day is the day of its first row
+    TransactionLogReader active;
+    if (active.open(activePath) && active.size() > 0) {
+        activeDay = dayOfTimestamp(active.begin()->timestamp);
+    }
+
+    sealer = std::thread(&LogSegments::sealerLoop, this);
+    return true;
+}
+
+void LogSegments::rollOverIfDue(TransactionLogger& logger, int64_t timestamp) {
+    uint32_t day = policy.rollDaily ? dayOfTimestamp(timestamp) : 0;
+    uint32_t current = activeDay.load(std::memory_order_relaxed);
+    bool newDay = day != 0 && current != 0 && day > current;
+    bool full = policy.maxActiveBytes != 0 && logger.size() >= policy.maxActiveBytes;
+    if (!newDay && !full) {
+        if (day != 0 && current == 0) {
+            activeDay.compare_exchange_strong(current, day); // First row of an empty log
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(rollMutex);
+    // Re-check: another thread may have closed the segment while we waited
+    current = activeDay.load(std::memory_order_relaxed);
+    newDay = day != 0 && current != 0 && day > current;
+    full = policy.maxActiveBytes != 0 && logger.size() >= policy.maxActiveBytes;
+    if (newDay || full) {
+        rollOverLocked(logger, day);
+    }
+}
+
+bool LogSegments::rollOver(TransactionLogger& logger) {
+    std::lock_guard<std::mutex> lock(rollMutex);
+    return rollOverLocked(logger, 0);
+}
+
+// Move the active log into the segment directory and queue it for sealing
+bool LogSegments::rollOverLocked(TransactionLogger& logger, uint32_t day) {
+    // Nothing to close if the log holds no records (the logger opens it lazily)
+    struct stat st;
+    bool empty = logger.size() <= sizeof(TransactionLogHeader) &&
+                 (stat(activePath.c_str(), &st) != 0 || static_cast<size_t>(st.st_size) <= sizeof(TransactionLogHeader));
+    if (!empty) {
+        std::unique_lock<std::shared_mutex> lock(segmentsMutex);
+        uint64_t number = nextNumber;
+        if (!logger.rollOver(pathFor(number, ".dat"))) {
+            return false;
+        }
+        ++nextNumber;
+        {
+            // Queued while readers are still excluded, so none can miss the closed rows
+            std::lock_guard<std::mutex> sealLock(sealMutex);
+            toSeal.push_back(number);
+        }
+        sealChanged.notify_all();
+    }
+    activeDay = day;
+    return true;
+}
+
+// Move a pre-binary CSV log into the segment directory as a closed segment
+bool LogSegments::adoptLegacyLog(const std::string& csvPath) {
+    std::lock_guard<std::mutex> lock(rollMutex);
+    std::unique_lock<std::shared_mutex> segmentsLock(segmentsMutex);
+    uint64_t number = nextNumber;
+    if (std::rename(csvPath.c_str(), pathFor(number, ".csv").c_str()) != 0) {
+        std::cerr << "Error: Could not move " << csvPath << " into " << directory << "." << std::endl;
+        return false;
+    }
+    ++nextNumber;
+    {
+        std::lock_guard<std::mutex> sealLock(sealMutex);
+        toSeal.push_back(number);
+    }
+    sealChanged.notify_all();
+    return true;
+}
+
+// Background thread: seal closed segments one at a time
+void LogSegments::sealerLoop() {
+    std::unique_lock<std::mutex> lock(sealMutex);
+    while (true) {
+        sealChanged.wait(lock, [this] { return stopping || !toSeal.empty(); });
+        if (stopping) {
+            return;
+        }
+        uint64_t number = toSeal.front();
+        toSeal.pop_front();
+        ++sealing;
+        lock.unlock();
+        bool sealed = sealOne(number);
+        lock.lock();
+        --sealing;
+        if (!sealed) {
+            // Keep it pending, so readers wait for its rows rather than miss them
+            toSeal.push_front(number);
+            sealChanged.wait_for(lock, SEAL_RETRY_DELAY, [this] { return stopping; });
+        }
+        sealChanged.notify_all();
+    }
+}
+
+// Seal one closed segment, publish it and drop the closed file. Returns
+// false if it stays closed, to be retried.
+bool LogSegments::sealOne(uint64_t number) {
+    std::string closedPath = closedPathFor(number);
+    std::string segmentPath = pathFor(number, ".seg");
+    if (!seal(closedPath, segmentPath, policy.compress)) {
+        std::cerr << "Error: Could not seal log segment " << closedPath << "; retrying." << std::endl;
+        return false;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(segmentsMutex);
+        if (!mapSegment(number)) {
+            std::cerr << "Error: Could not open sealed log segment " << segmentPath << "; retrying." << std::endl;
+            return false;
+        }
+    }
+    // The segment's rename must be durable before the only other copy of its rows goes
+    if (syncDirectory(directory)) {
+        std::remove(closedPath.c_str());
+    }
+    return true;
+}
+
+// Wait until no closed segment is waiting to be sealed, then share segmentsMutex
+std::shared_lock<std::shared_mutex> LogSegments::lockForReading() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sealMutex);
+            sealChanged.wait(lock, [this] { return stopping || (toSeal.empty() && sealing == 0); });
+        }
+        std::shared_lock<std::shared_mutex> reading(segmentsMutex);
+        std::lock_guard<std::mutex> lock(sealMutex);
+        if (stopping || (toSeal.empty() && sealing == 0)) {
+            return reading;
+        }
+        // A rollover slipped in between; wait for that seal too
+    }
+}
+
+// Visit one account's sealed rows, newest segment first
+void LogSegments::forEachAccountRow(uint64_t accountKey, const std::function<bool(const Transaction&)>& visit,
+                                    const RowFilter& bounds, bool keepNewer) const {
+    RowFilter account = bounds;
+    account.allAccounts = false;
+    account.accountKey = accountKey;
+    // First block whose key range reaches accountKey; the account's blocks follow it
+    auto firstBlockOf = [accountKey](const Segment& segment) {
+        const SegmentBlock* first = segment.blocks();
+        return std::lower_bound(first, first + segment.header().blockCount, accountKey,
+                                [](const SegmentBlock& b, uint64_t key) { return b.lastKey < key; });
+    };
+
+    // With keepNewer, find the oldest block that may hold a match: segments
+    // and blocks are in log order, so the walk can stop after it
+    size_t oldestSegment = 0;
+    uint64_t oldestBlock = 0;
+    if (keepNewer) {
+        oldestSegment = segments.size();
+        for (size_t i = 0; i < segments.size() && oldestSegment == segments.size(); ++i) {
+            const Segment& segment = *segments[i];
+            if (!segment.overlaps(account)) {
+                continue;
+            }
+            const SegmentBlock* first = segment.blocks();
+            const SegmentBlock* last = first + segment.header().blockCount;
+            for (const SegmentBlock* block = firstBlockOf(segment); block != last && block->firstKey <= accountKey;
+                 ++block) {
+                if (account.mayMatch(segment.range(static_cast<uint64_t>(block - first)))) {
+                    oldestSegment = i;
+                    oldestBlock = static_cast<uint64_t>(block - first);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Transaction> decoded;
+    std::vector<Transaction> matches;
+    size_t decodedBlocks = 0;
+    size_t skippedBlocks = 0;
+    for (size_t i = segments.size(); i-- > oldestSegment;) {
+        const Segment& segment = *segments[i];
+        if (!keepNewer && !segment.overlaps(account)) {
+            continue;
+        }
+        const SegmentBlock* first = segment.blocks();
+        const SegmentBlock* last = first + segment.header().blockCount;
+        matches.clear();
+        for (const SegmentBlock* block = firstBlockOf(segment); block != last && block->firstKey <= accountKey;
+             ++block) {
+            uint64_t b = static_cast<uint64_t>(block - first);
+            if (keepNewer ? (i == oldestSegment && b < oldestBlock) : !account.mayMatch(segment.range(b))) {
+                ++skippedBlocks;
+                continue;
+            }
+            ++decodedBlocks;
+            if (!decodeBlock(segment.data, *block, segment.encoding(), decoded)) {
+                break;
+            }
+            for (const auto& row : decoded) {
+                if (row.accountKey == accountKey) {
+                    matches.push_back(row);
+                }
+            }
+        }
+        // Rows of an account keep their logged order within a segment
+        for (auto row = matches.rbegin(); row != matches.rend(); ++row) {
+            if (!visit(*row)) {
+                blocksDecoded.add(decodedBlocks);
+                blocksSkipped.add(skippedBlocks);
+                return;
+            }
+        }
+    }
+    blocksDecoded.add(decodedBlocks);
+    blocksSkipped.add(skippedBlocks);
+}
+
+// Visit every sealed row, one decoded block at a time
+void LogSegments::forEachRow(const std::function<bool(const Transaction&)>& visit) const {
+    std::vector<Transaction> decoded;
+    for (const auto& segment : segments) {
+        const SegmentBlock* blocks = segment->blocks();
+        for (uint64_t b = 0; b < segment->header().blockCount; ++b) {
+            if (!decodeBlock(segment->data, blocks[b], segment->encoding(), decoded)) {
+                break;
+            }
+            for (const auto& row : decoded) {
+                if (!visit(row)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Visit a segment's matching rows, decoding only the blocks that may hold one;
+// returns false once visit does
+bool LogSegments::visitMatches(const Segment& segment, const RowFilter& filter,
+                               const std::function<bool(const Transaction&)>& visit, size_t& decoded, size_t& skipped) {
+    std::vector<Transaction> rows;
+    const SegmentBlock* blocks = segment.blocks();
+    for (uint64_t b = 0; b < segment.header().blockCount; ++b) {
+        if (!filter.mayMatch(segment.range(b))) {
+            ++skipped;
+            continue;
+        }
+        ++decoded;
+        if (!decodeBlock(segment.data, blocks[b], segment.encoding(), rows)) {
+            break;
+        }
+        for (const auto& row : rows) {
+            if (filter.matches(row) && !visit(row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void LogSegments::forEachMatchingRow(const RowFilter& filter, const std::function<bool(const Transaction&)>& visit) const {
+    size_t decodedBlocks = 0;
+    size_t skippedBlocks = 0;
+    for (const auto& segment : segments) {
+        if (!segment->overlaps(filter)) {
+            skippedBlocks += segment->header().blockCount;
+        } else if (!visitMatches(*segment, filter, visit, decodedBlocks, skippedBlocks)) {
+            break;
+        }
+    }
+    blocksDecoded.add(decodedBlocks);
+    blocksSkipped.add(skippedBlocks);
+}
+
+void LogSegments::forEachRecentMatchingRow(const RowFilter& filter, const std::function<bool(int64_t, int64_t)>& enter,
+                                           const std::function<bool(const Transaction&)>& visit) const {
+    size_t decodedBlocks = 0;
+    size_t skippedBlocks = 0;
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        const Segment& segment = **it;
+        if (!segment.overlaps(filter) || !enter(segment.header().firstTimestamp, segment.header().lastTimestamp)) {
+            skippedBlocks += segment.header().blockCount;
+        } else if (!visitMatches(segment, filter, visit, decodedBlocks, skippedBlocks)) {
+            break;
+        }
+    }
+    blocksDecoded.add(decodedBlocks);
+    blocksSkipped.add(skippedBlocks);
+}
+
+size_t LogSegments::segmentCount() const {
+    std::shared_lock<std::shared_mutex> lock(segmentsMutex);
+    return segments.size();
+}
+
+uint64_t LogSegments::activeSegment() const {
+    std::shared_lock<std::shared_mutex> lock(segmentsMutex);
+    return nextNumber;
+}
+
+// Read a closed segment, sort it by account and write it as a sealed segment
+bool LogSegments::seal(const std::string& closedPath, const std::string& segmentPath, bool compress) {
+    std::vector<Transaction> rows;
+    if (closedPath.size() >= 4 && closedPath.compare(closedPath.size() - 4, 4, ".csv") == 0) {
+        std::ifstream ifs(closedPath, std::ios::binary);
+        if (!ifs.is_open()) {
+            return false;
+        }
+        std::string line;
+        Transaction row;
+        while (std::getline(ifs, line)) {
+            if (parseCsvRow(line, row)) {
+                rows.push_back(row); // Malformed rows were never indexed either; drop them
+            }
+        }
+        if (ifs.bad()) {
+            return false;
+        }
+    } else {
+        TransactionLogReader reader;
+        if (!reader.open(closedPath)) {
+            return false;
+        }
+        rows.assign(reader.begin(), reader.end());
+    }
+
+    // Stable, so each account's rows stay in logged order
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Transaction& a, const Transaction& b) { return a.accountKey < b.accountKey; });
+
+    SegmentHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = SEGMENT_VERSION;
+    SegmentEncoding encoding = compress ? SegmentEncoding::VARINT : SegmentEncoding::RAW;
+    header.encoding = static_cast<uint32_t>(encoding);
+    header.rowCount = rows.size();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i == 0 || rows[i].timestamp < header.firstTimestamp) header.firstTimestamp = rows[i].timestamp;
+        if (i == 0 || rows[i].timestamp > header.lastTimestamp) header.lastTimestamp = rows[i].timestamp;
+    }
+
+    // Write to a temporary name and rename, so a crash never leaves a partial segment
+    std::string tempPath = segmentPath + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<SegmentBlock> directoryEntries;
+    std::vector<RowRange> ranges;
+    std::vector<char> bytes;
+    uint64_t offset = sizeof(header);
+    for (size_t start = 0; ok && start < rows.size(); start += SEGMENT_BLOCK_ROWS) {
+        size_t end = std::min(rows.size(), start + SEGMENT_BLOCK_ROWS);
+        encodeBlock(rows.data() + start, rows.data() + end, encoding, bytes);
+        SegmentBlock block;
+        block.firstKey = rows[start].accountKey;
+        block.lastKey = rows[end - 1].accountKey;
+        block.offset = offset;
+        block.size = static_cast<uint32_t>(bytes.size());
+        block.rows = static_cast<uint32_t>(end - start);
+        directoryEntries.push_back(block);
+        RowRange range;
+        for (size_t i = start; i < end; ++i) {
+            range.include(rows[i]);
+        }
+        ranges.push_back(range);
+        ok = writeAll(fd, bytes.data(), bytes.size());
+        offset += bytes.size();
+    }
+    header.blockCount = directoryEntries.size();
+    header.rangeOffset = offset;
+    header.directoryOffset = offset + ranges.size() * sizeof(RowRange);
+    ok = ok && writeAll(fd, reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(RowRange)) &&
+         writeAll(fd, reinterpret_cast<const char*>(directoryEntries.data()),
+                        directoryEntries.size() * sizeof(SegmentBlock)) &&
+         pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+         fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tempPath.c_str(), segmentPath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
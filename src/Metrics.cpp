@@ -0,0 +1,336 @@
+// src/Metrics.cpp
+#include "Metrics.h"
+#include <chrono>    // For std::chrono::steady_clock
+#include <cstdio>    // For std::rename
+#include <cstdlib>   // For std::atexit
+#include <fstream>
+#include <iomanip>   // For std::setprecision
+#include <iostream>
+#include <mutex>     // For std::mutex, std::lock_guard
+#include <pthread.h> // For pthread_sigmask
+#include <signal.h>  // For sigwait, SIGUSR1
+#include <thread>    // For std::thread
+#include <vector>
+
+namespace {
+
+struct MetricInfo {
+    std::string name;
+    std::string help;
+    uint32_t sampleEvery;                // Histograms only
+    const std::atomic<int64_t>* gauge;   // Gauges only
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<MetricInfo> counters;
+    std::vector<MetricInfo> histograms;
+    std::vector<MetricInfo> gauges;
+    std::vector<MetricShard*> shards; // Shards of live threads
+    MetricShard retired;              // Sum of the shards of exited threads
+    uint64_t startTicks;              // For converting ticks to seconds
+    std::chrono::steady_clock::time_point startTime;
+    std::string dumpPath;
+
+    Registry() : startTicks(Metrics::ticks()), startTime(std::chrono::steady_clock::now()) {}
+};
+
+// Never destroyed: threads can still exit, and the exit-time dump still run,
+// while other static objects are being torn down
+Registry& registry() {
+    static Registry* r = new Registry();
+    return *r;
+}
+
+// Add every cell of from into into
+void foldShard(MetricShard& into, const MetricShard& from) {
+    for (size_t i = 0; i <= MAX_COUNTERS; ++i) {
+        Metrics::bump(into.counters[i], from.counters[i].load(std::memory_order_relaxed));
+    }
+    for (size_t h = 0; h <= MAX_HISTOGRAMS; ++h) {
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            Metrics::bump(into.buckets[h][b], from.buckets[h][b].load(std::memory_order_relaxed));
+        }
+        Metrics::bump(into.tickSums[h], from.tickSums[h].load(std::memory_order_relaxed));
+    }
+}
+
+// Owns the calling thread's shard and retires it when the thread exits
+struct ShardOwner {
+    MetricShard* shard = nullptr;
+
+    ~ShardOwner() {
+        if (!shard) {
+            return;
+        }
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            foldShard(r.retired, *shard);
+            for (size_t i = 0; i < r.shards.size(); ++i) {
+                if (r.shards[i] == shard) {
+                    r.shards[i] = r.shards.back();
+                    r.shards.pop_back();
+                    break;
+                }
+            }
+        }
+        delete shard;
+        // Events from later thread_local destructors are dropped: several
+        // exiting threads at once would race on shared cells, since bump()
+        // is not an atomic add
+        static thread_local MetricShard discarded;
+        Metrics::localShard = &discarded;
+    }
+};
+
+// Totals over every shard, taken under the registry lock
+struct Totals {
+    std::vector<uint64_t> counters;
+    std::vector<std::vector<uint64_t>> buckets;
+    std::vector<uint64_t> tickSums;
+};
+
+Totals collect(Registry& r) {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Totals t;
+    t.counters.assign(r.counters.size(), 0);
+    t.buckets.assign(r.histograms.size(), std::vector<uint64_t>(HISTOGRAM_BUCKETS, 0));
+    t.tickSums.assign(r.histograms.size(), 0);
+    auto add = [&](const MetricShard& s) {
+        for (size_t i = 0; i < t.counters.size(); ++i) {
+            t.counters[i] += s.counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t h = 0; h < t.buckets.size(); ++h) {
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                t.buckets[h][b] += s.buckets[h][b].load(std::memory_order_relaxed);
+            }
+            t.tickSums[h] += s.tickSums[h].load(std::memory_order_relaxed);
+        }
+    };
+    add(r.retired);
+    for (const MetricShard* s : r.shards) {
+        add(*s);
+    }
+    return t;
+}
+
+// Clock ticks per second, measured over the life of the process
+double ticksPerSecond(const Registry& r) {
+#if defined(__x86_64__) || defined(__i386__)
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.startTime).count();
+    uint64_t elapsed = Metrics::ticks() - r.startTicks;
+    return seconds > 0.0 && elapsed > 0 ? elapsed / seconds : 1e9;
+#else
+    return 1e9;
+#endif
+}
+
+// Upper bound of bucket b, in seconds
+double bucketBound(size_t b, double tickRate) {
+    return static_cast<double>(1ULL << (b + HISTOGRAM_MIN_SHIFT)) / tickRate;
+}
+
+// Smallest bucket bound below which at least fraction q of the observations fall
+double quantileBound(const std::vector<uint64_t>& buckets, double q, double tickRate) {
+    uint64_t count = 0;
+    for (uint64_t n : buckets) {
+        count += n;
+    }
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b + 1 < HISTOGRAM_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= q * count) {
+            return bucketBound(b, tickRate);
+        }
+    }
+    return bucketBound(HISTOGRAM_BUCKETS - 1, tickRate);
+}
+
+std::string histogramHelp(const MetricInfo& info) {
+    if (info.sampleEvery <= 1) {
+        return info.help;
+    }
+    return info.help + " (timed 1 in " + std::to_string(info.sampleEvery) + " events)";
+}
+
+void dumpAtExit() {
+    Metrics::dumpToFile(registry().dumpPath);
+}
+
+} // namespace
+
+MetricShard& Metrics::attachThread() {
+    static thread_local ShardOwner owner;
+    MetricShard* s = new MetricShard();
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.shards.push_back(s);
+    }
+    owner.shard = s;
+    localShard = s;
+    return *s;
+}
+
+size_t Metrics::registerCounter(const char* name, const char* help) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.counters.size() >= MAX_COUNTERS) {
+        std::cerr << "Error: Too many counters; " << name << " will not be exported." << std::endl;
+        return MAX_COUNTERS;
+    }
+    r.counters.push_back(MetricInfo{name, help, 1, nullptr});
+    return r.counters.size() - 1;
+}
+
+size_t Metrics::registerHistogram(const char* name, const char* help, uint32_t sampleEvery) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.histograms.size() >= MAX_HISTOGRAMS) {
+        std::cerr << "Error: Too many histograms; " << name << " will not be exported." << std::endl;
+        return MAX_HISTOGRAMS;
+    }
+    r.histograms.push_back(MetricInfo{name, help, sampleEvery, nullptr});
+    return r.histograms.size() - 1;
+}
+
+void Metrics::registerGauge(const char* name, const char* help, const std::atomic<int64_t>* value) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.gauges.push_back(MetricInfo{name, help, 1, value});
+}
+
+Histogram::Histogram(const char* name, const char* help, uint32_t sampleEvery) {
+    uint32_t every = 1;
+    while (every * 2 <= sampleEvery && every < (1U << 30)) {
+        every *= 2;
+    }
+    sampleMask = every - 1;
+    slot = Metrics::registerHistogram(name, help, every);
+}
+
+void Metrics::writePrometheus(std::ostream& out) {
+    Registry& r = registry();
+    Totals t = collect(r);
+    double tickRate = ticksPerSecond(r);
+    out << std::setprecision(6);
+    for (size_t i = 0; i < t.counters.size(); ++i) {
+        const MetricInfo& info = r.counters[i];
+        out << "# HELP " << info.name << ' ' << info.help << '\n'
+            << "# TYPE " << info.name << " counter\n"
+            << info.name << ' ' << t.counters[i] << '\n';
+    }
+    for (const MetricInfo& info : r.gauges) {
+        out << "# HELP " << info.name << ' ' << info.help << '\n'
+            << "# TYPE " << info.name << " gauge\n"
+            << info.name << ' ' << info.gauge->load(std::memory_order_relaxed) << '\n';
+    }
+    for (size_t h = 0; h < t.buckets.size(); ++h) {
+        const MetricInfo& info = r.histograms[h];
+        out << "# HELP " << info.name << ' ' << histogramHelp(info) << '\n'
+            << "# TYPE " << info.name << " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b + 1 < HISTOGRAM_BUCKETS; ++b) {
+            cumulative += t.buckets[h][b];
+            out << info.name << "_bucket{le=\"" << bucketBound(b, tickRate) << "\"} " << cumulative << '\n';
+        }
+        cumulative += t.buckets[h][HISTOGRAM_BUCKETS - 1];
+        out << info.name << "_bucket{le=\"+Inf\"} " << cumulative << '\n'
+            << info.name << "_sum " << t.tickSums[h] / tickRate << '\n'
+            << info.name << "_count " << cumulative << '\n';
+    }
+}
+
+void Metrics::writeJson(std::ostream& out) {
+    Registry& r = registry();
+    Totals t = collect(r);
+    double tickRate = ticksPerSecond(r);
+    out << std::setprecision(6);
+    out << "{\n  \"counters\": {";
+    for (size_t i = 0; i < t.counters.size(); ++i) {
+        out << (i ? ",\n" : "\n") << "    \"" << r.counters[i].name << "\": " << t.counters[i];
+    }
+    out << "\n  },\n  \"gauges\": {";
+    for (size_t i = 0; i < r.gauges.size(); ++i) {
+        out << (i ? ",\n" : "\n") << "    \"" << r.gauges[i].name << "\": "
+            << r.gauges[i].gauge->load(std::memory_order_relaxed);
+    }
+    out << "\n  },\n  \"histograms\": {";
+    for (size_t h = 0; h < t.buckets.size(); ++h) {
+        uint64_t count = 0;
+        for (uint64_t n : t.buckets[h]) {
+            count += n;
+        }
+        out << (h ? ",\n" : "\n") << "    \"" << r.histograms[h].name << "\": {\"count\": " << count
+            << ", \"sample_every\": " << r.histograms[h].sampleEvery
+            << ", \"sum_seconds\": " << t.tickSums[h] / tickRate
+            << ", \"p50_seconds\": " << quantileBound(t.buckets[h], 0.50, tickRate)
+            << ", \"p99_seconds\": " << quantileBound(t.buckets[h], 0.99, tickRate)
+            << ", \"buckets\": [";
+        // Only the non-empty buckets, as [upper bound in seconds, observations]
+        bool first = true;
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            if (t.buckets[h][b] == 0) {
+                continue;
+            }
+            out << (first ? "" : ", ") << '[';
+            if (b + 1 < HISTOGRAM_BUCKETS) {
+                out << bucketBound(b, tickRate);
+            } else {
+                out << "null"; // Overflow bucket
+            }
+            out << ", " << t.buckets[h][b] << ']';
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+}
+
+bool Metrics::dumpToFile(const std::string& path) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not write metrics to " << tempPath << "." << std::endl;
+            return false;
+        }
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (json) {
+            writeJson(out);
+        } else {
+            writePrometheus(out);
+        }
+        if (!out) {
+            std::cerr << "Error: Could not write metrics to " << tempPath << "." << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not replace " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Metrics::enableDump(const std::string& path) {
+    registry().dumpPath = path;
+    std::atexit(dumpAtExit);
+
+    // SIGUSR1 is taken synchronously by one thread, so the dump runs as
+    // ordinary code rather than inside a signal handler
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread([signals, path]() {
+        int received;
+        while (sigwait(&signals, &received) == 0) {
+            dumpToFile(path);
+        }
+    }).detach();
+}
@@ -0,0 +1,335 @@
+// src/PinHash.cpp
+#include "PinHash.h"
+#include "AccountIndex.h" // For hashAccountKey
+#include "Metrics.h"
+#include <algorithm> // For std::min
+#include <atomic>  // For std::atomic
+#include <chrono>  // For std::chrono::steady_clock
+#include <cstring> // For std::memcpy, std::memset
+#include <mutex>   // For std::mutex, std::lock_guard
+#include <random>  // For std::random_device
+
+static const Counter kdfChecks("bms_pin_kdf_checks_total", "PIN checks that ran the full KDF");
+static const Counter sessionHits("bms_session_cache_hits_total", "PIN checks answered from the session cache");
+
+namespace {
+
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadBigEndian(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void storeBigEndian(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+// One SHA-256 compression of a block given as 16 big-endian words
+void compress(uint32_t state[8], const uint32_t block[16]) {
+    uint32_t w[64];
+    std::memcpy(w, block, sizeof(uint32_t) * 16);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// Streaming SHA-256
+struct Sha256 {
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered;
+    uint64_t totalBytes;
+
+    Sha256() : buffered(0), totalBytes(0) {
+        std::memcpy(state, INITIAL_STATE, sizeof(state));
+    }
+
+    // Continue from a saved state that has absorbed whole blocks only
+    Sha256(const uint32_t saved[8], uint64_t absorbed) : buffered(0), totalBytes(absorbed) {
+        std::memcpy(state, saved, sizeof(state));
+    }
+
+    void compressBuffer() {
+        uint32_t words[16];
+        for (int i = 0; i < 16; ++i) {
+            words[i] = loadBigEndian(buffer + 4 * i);
+        }
+        compress(state, words);
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        totalBytes += length;
+        while (length > 0) {
+            size_t take = std::min(length, sizeof(buffer) - buffered);
+            std::memcpy(buffer + buffered, data, take);
+            buffered += take;
+            data += take;
+            length -= take;
+            if (buffered == sizeof(buffer)) {
+                compressBuffer();
+                buffered = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t digest[32]) {
+        uint64_t bits = totalBytes * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        uint8_t zero = 0;
+        while (buffered != 56) {
+            update(&zero, 1);
+        }
+        uint8_t length[8];
+        for (int i = 0; i < 8; ++i) {
+            length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(length, sizeof(length));
+        for (int i = 0; i < 8; ++i) {
+            storeBigEndian(digest + 4 * i, state[i]);
+        }
+    }
+};
+
+// HMAC-SHA256 key, kept as the hash states after absorbing key^ipad and
+// key^opad, so each HMAC skips those two compressions
+struct HmacKey {
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+    HmacKey(const uint8_t* key, size_t length) {
+        uint8_t block[64] = {};
+        if (length > sizeof(block)) {
+            Sha256 h;
+            h.update(key, length);
+            h.finish(block);
+        } else {
+            std::memcpy(block, key, length);
+        }
+        uint32_t ipad[16], opad[16];
+        for (int i = 0; i < 16; ++i) {
+            uint32_t word = loadBigEndian(block + 4 * i);
+            ipad[i] = word ^ 0x36363636;
+            opad[i] = word ^ 0x5c5c5c5c;
+        }
+        std::memcpy(inner, INITIAL_STATE, sizeof(inner));
+        compress(inner, ipad);
+        std::memcpy(outer, INITIAL_STATE, sizeof(outer));
+        compress(outer, opad);
+    }
+
+    // HMAC of an arbitrary message
+    void sign(const uint8_t* message, size_t length, uint8_t mac[32]) const {
+        uint8_t innerDigest[32];
+        Sha256 in(inner, 64);
+        in.update(message, length);
+        in.finish(innerDigest);
+        Sha256 out(outer, 64);
+        out.update(innerDigest, sizeof(innerDigest));
+        out.finish(mac);
+    }
+
+    // HMAC of a 32-byte message held as 8 words, as PBKDF2 iterates it:
+    // the message and its padding fill exactly one block on each side
+    void signWords(const uint32_t message[8], uint32_t mac[8]) const {
+        uint32_t block[16];
+        std::memcpy(block, message, sizeof(uint32_t) * 8);
+        block[8] = 0x80000000;
+        std::memset(block + 9, 0, sizeof(uint32_t) * 6);
+        block[15] = (64 + 32) * 8; // Bits hashed: the pad block and the message
+        uint32_t state[8];
+        std::memcpy(state, inner, sizeof(state));
+        compress(state, block);
+        std::memcpy(block, state, sizeof(state));
+        std::memcpy(mac, outer, sizeof(outer));
+        compress(mac, block);
+    }
+};
+
+// PBKDF2-HMAC-SHA256 with a single 32-byte output block
+void pbkdf2(std::string_view pin, const uint8_t salt[16], uint32_t iterations, uint8_t out[32]) {
+    HmacKey key(reinterpret_cast<const uint8_t*>(pin.data()), pin.size());
+    uint8_t first[16 + 4];
+    std::memcpy(first, salt, 16);
+    storeBigEndian(first + 16, 1); // Block index
+    uint8_t u[32];
+    key.sign(first, sizeof(first), u);
+
+    uint32_t chain[8], total[8];
+    for (int i = 0; i < 8; ++i) {
+        chain[i] = total[i] = loadBigEndian(u + 4 * i);
+    }
+    for (uint32_t round = 1; round < iterations; ++round) {
+        key.signWords(chain, chain);
+        for (int i = 0; i < 8; ++i) {
+            total[i] ^= chain[i];
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian(out + 4 * i, total[i]);
+    }
+}
+
+std::atomic<uint32_t> currentIterations(PinHash::DEFAULT_ITERATIONS);
+
+void randomBytes(uint8_t* out, size_t length) {
+    thread_local std::random_device device;
+    for (size_t i = 0; i < length; i += 4) {
+        uint32_t word = device();
+        std::memcpy(out + i, &word, std::min<size_t>(4, length - i));
+    }
+}
+
+// Key for the session cache tags, fresh for every run of the program
+const HmacKey& sessionKey() {
+    static const HmacKey key = []() {
+        uint8_t secret[32];
+        randomBytes(secret, sizeof(secret));
+        return HmacKey(secret, sizeof(secret));
+    }();
+    return key;
+}
+
+struct SessionSlot {
+    uint64_t accountKey;
+    int64_t expires; // Steady-clock seconds; 0 marks an empty slot
+    uint8_t tag[32];
+};
+
+const size_t SESSION_STRIPES = 64;
+SessionSlot sessionSlots[PinHash::SESSION_CACHE_SLOTS];
+std::mutex sessionStripes[SESSION_STRIPES];
+
+int64_t steadySeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() + 1; // Never 0
+}
+
+// Keyed tag binding the account, its current credential and the PIN entered
+void sessionTag(uint64_t accountKey, const PinCredential& credential, std::string_view pin, uint8_t tag[32]) {
+    uint8_t message[8 + sizeof(credential.salt) + sizeof(credential.hash) + 64];
+    size_t pinBytes = std::min(pin.size(), static_cast<size_t>(64));
+    std::memcpy(message, &accountKey, 8);
+    std::memcpy(message + 8, credential.salt, sizeof(credential.salt));
+    std::memcpy(message + 8 + sizeof(credential.salt), credential.hash, sizeof(credential.hash));
+    std::memcpy(message + 8 + sizeof(credential.salt) + sizeof(credential.hash), pin.data(), pinBytes);
+    sessionKey().sign(message, 8 + sizeof(credential.salt) + sizeof(credential.hash) + pinBytes, tag);
+}
+
+} // namespace
+
+void PinHash::setIterations(uint32_t iterations) {
+    currentIterations.store(iterations > 0 ? iterations : 1, std::memory_order_relaxed);
+}
+
+uint32_t PinHash::iterations() {
+    return currentIterations.load(std::memory_order_relaxed);
+}
+
+PinCredential PinHash::hash(std::string_view pin) {
+    uint8_t salt[16];
+    randomBytes(salt, sizeof(salt));
+    return hash(pin, salt, iterations());
+}
+
+PinCredential PinHash::hash(std::string_view pin, const uint8_t salt[16], uint32_t iterations) {
+    PinCredential credential;
+    credential.iterations = iterations;
+    std::memcpy(credential.salt, salt, sizeof(credential.salt));
+    pbkdf2(pin, credential.salt, iterations, credential.hash);
+    return credential;
+}
+
+bool PinHash::verify(const PinCredential& credential, std::string_view pin) {
+    if (credential.iterations == 0) {
+        return false;
+    }
+    kdfChecks.add();
+    uint8_t derived[32];
+    pbkdf2(pin, credential.salt, credential.iterations, derived);
+    return constantTimeEqual(derived, credential.hash, sizeof(derived));
+}
+
+bool PinHash::verifyCached(uint64_t accountKey, const PinCredential& credential, std::string_view pin) {
+    if (credential.iterations == 0) {
+        return false;
+    }
+    uint8_t tag[32];
+    sessionTag(accountKey, credential, pin, tag);
+    size_t index = hashAccountKey(accountKey) & (SESSION_CACHE_SLOTS - 1);
+    SessionSlot& slot = sessionSlots[index];
+    int64_t now = steadySeconds();
+    {
+        std::lock_guard<std::mutex> lock(sessionStripes[index % SESSION_STRIPES]);
+        if (slot.expires > now && slot.accountKey == accountKey && constantTimeEqual(slot.tag, tag, sizeof(tag))) {
+            sessionHits.add();
+            return true;
+        }
+    }
+    if (!verify(credential, pin)) {
+        return false; // A failed check leaves the slot alone, so it cannot evict a live session
+    }
+    std::lock_guard<std::mutex> lock(sessionStripes[index % SESSION_STRIPES]);
+    slot.accountKey = accountKey;
+    slot.expires = now + SESSION_TTL_SECONDS;
+    std::memcpy(slot.tag, tag, sizeof(tag));
+    return true;
+}
+
+void PinHash::clearSessionCache() {
+    for (size_t i = 0; i < SESSION_CACHE_SLOTS; ++i) {
+        std::lock_guard<std::mutex> lock(sessionStripes[i % SESSION_STRIPES]);
+        sessionSlots[i].expires = 0;
+    }
+}
+
+bool PinHash::constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t length) {
+    volatile uint8_t difference = 0; // volatile: keep the compiler from exiting the loop early
+    for (size_t i = 0; i < length; ++i) {
+        difference = difference | (a[i] ^ b[i]);
+    }
+    return difference == 0;
+}
@@ -0,0 +1,386 @@
+// src/PostingEngine.cpp
+#include "PostingEngine.h"
+#include "Account.h"
+#include "AccountIndex.h" // For packAccountNumber, hashAccountKey
+#include "Metrics.h"
+#include "Transaction.h"  // For logTransaction
+#include "UserAuth.h"
+#include "Utility.h"      // For currentTimestamp, isValidAmount
+#include <shared_mutex>   // For std::shared_lock
+
+std::mutex PostingEngine::stripes[PostingEngine::LOCK_STRIPES];
+
+static const Histogram depositSeconds("bms_deposit_seconds", "Time to post and persist a deposit");
+static const Histogram withdrawSeconds("bms_withdraw_seconds", "Time to post and persist a withdrawal");
+static const Counter depositFailures("bms_deposit_failures_total", "Deposits that were rejected or not persisted");
+static const Counter withdrawFailures("bms_withdraw_failures_total", "Withdrawals that were rejected or not persisted");
+static const Histogram transferSeconds("bms_transfer_seconds", "Time to post and persist both legs of a transfer");
+static const Counter transferFailures("bms_transfer_failures_total", "Transfers that were rejected or not persisted");
+static const Histogram balanceSeconds("bms_balance_read_seconds", "Time to read an account balance");
+static const Histogram batchSeconds("bms_batch_seconds", "Time to apply and persist a batch of postings");
+static const Counter batchPostings("bms_batch_postings_total", "Postings submitted in batches");
+static const Counter batchFailures("bms_batch_failures_total", "Batched postings that were rejected or not persisted");
+
+// Helper to count a failed posting on its way out
+static PostingResult counted(const Counter& failures, PostingResult result) {
+    if (result != PostingResult::SUCCESS) {
+        failures.add();
+    }
+    return result;
+}
+
+// Helper function to describe a posting result to the user
+std::string postingResultToString(PostingResult result) {
+    switch (result) {
+        case PostingResult::SUCCESS: return "Success";
+        case PostingResult::ACCOUNT_NOT_FOUND: return "Account not found";
+        case PostingResult::INVALID_AMOUNT: return "Invalid amount";
+        case PostingResult::INSUFFICIENT_FUNDS: return "Insufficient funds";
+        case PostingResult::SAME_ACCOUNT: return "Cannot transfer to the same account";
+        case PostingResult::PERSIST_FAILED: return "Could not save the transaction";
+        default: return "Unknown error";
+    }
+}
+
+// Look up target.key, unless it is mistyped; the caller holds the lock of its shard
+bool PostingEngine::resolve(Target& target) {
+    target.account = UserAuth::acceptsAccountNumber(target.key) ? UserAuth::shardFor(target.key).index.find(target.key)
+                                                                : nullptr;
+    return target.account != nullptr;
+}
+
+size_t PostingEngine::stripeOf(uint64_t key) {
+    return hashAccountKey(key) % LOCK_STRIPES;
+}
+
+// Apply a signed change to an account whose stripe is locked
+PostingResult PostingEngine::apply(const Target& target, Money delta, JournalRecord& rec) {
+    Money newBalance;
+    if (!target.account->getBalance().add(delta, newBalance)) {
+        return PostingResult::INVALID_AMOUNT;
+    }
+    if (newBalance < Money() && delta < Money()) {
+        return PostingResult::INSUFFICIENT_FUNDS;
+    }
+    target.account->setBalance(newBalance);
+    rec.accountKey = target.key;
+    rec.delta = delta;
+    rec.newBalance = newBalance;
+    return PostingResult::SUCCESS;
+}
+
+// Put back the balance an applied change replaced
+void PostingEngine::revert(const Target& target, const JournalRecord& rec) {
+    Money oldBalance;
+    rec.newBalance.subtract(rec.delta, oldBalance); // Cannot overflow: apply() computed the reverse
+    target.account->setBalance(oldBalance);
+}
+
+// Write the transaction log row for an applied change
+bool PostingEngine::logPosting(const Target& target, Money delta, TransactionType type, int64_t timestamp) {
+    Money amount = delta;
+    if (delta < Money()) {
+        Money().subtract(delta, amount); // Log rows carry the unsigned amount
+    }
+    return logTransaction(Transaction(target.account->getAccountKey(), type, amount, timestamp));
+}
+
+// Journal applied changes as one group, reverting them all if that fails or
+// if the logger could not keep their rows
+PostingResult PostingEngine::persist(const Target* targets, JournalRecord* records, size_t count, bool syncNow) {
+    if (transactionLogAccepts(count) && UserAuth::recordPostings(records, count, syncNow)) {
+        return PostingResult::SUCCESS;
+    }
+    for (size_t i = count; i-- > 0;) {
+        revert(targets[i], records[i]); // Not durable, so do not keep it
+    }
+    return PostingResult::PERSIST_FAILED;
+}
+
+PostingResult PostingEngine::deposit(const std::string& accNum, Money amount) {
+    Money newBalance;
+    return deposit(accNum, amount, newBalance);
+}
+
+PostingResult PostingEngine::deposit(const std::string& accNum, Money amount, Money& newBalance) {
+    ScopedTimer timer(depositSeconds);
+    if (!isValidAmount(amount)) {
+        return counted(depositFailures, PostingResult::INVALID_AMOUNT);
+    }
+    Target target;
+    if (!packAccountNumber(accNum, target.key)) {
+        return counted(depositFailures, PostingResult::ACCOUNT_NOT_FOUND);
+    }
+    PostingResult result;
+    {
+        std::shared_lock<std::shared_mutex> shardLock(UserAuth::shardFor(target.key).mutex);
+        if (!resolve(target)) {
+            return counted(depositFailures, PostingResult::ACCOUNT_NOT_FOUND);
+        }
+        std::lock_guard<std::mutex> lock(stripes[stripeOf(target.key)]);
+        JournalRecord rec;
+        result = apply(target, amount, rec);
+        if (result == PostingResult::SUCCESS) {
+            result = persist(&target, &rec, 1, false);
+        }
+        if (result == PostingResult::SUCCESS) {
+            logPosting(target, amount, TransactionType::DEPOSIT, currentTimestamp());
+            newBalance = rec.newBalance;
+        }
+    }
+    UserAuth::checkpointIfDue(); // Needs every shard lock exclusively, so only after releasing ours
+    return counted(depositFailures, result);
+}
+
+PostingResult PostingEngine::withdraw(const std::string& accNum, Money amount) {
+    Money newBalance;
+    return withdraw(accNum, amount, newBalance);
+}
+
+PostingResult PostingEngine::withdraw(const std::string& accNum, Money amount, Money& newBalance) {
+    ScopedTimer timer(withdrawSeconds);
+    Money delta;
+    if (!isValidAmount(amount) || !Money().subtract(amount, delta)) {
+        return counted(withdrawFailures, PostingResult::INVALID_AMOUNT);
+    }
+    Target target;
+    if (!packAccountNumber(accNum, target.key)) {
+        return counted(withdrawFailures, PostingResult::ACCOUNT_NOT_FOUND);
+    }
+    PostingResult result;
+    {
+        std::shared_lock<std::shared_mutex> shardLock(UserAuth::shardFor(target.key).mutex);
+        if (!resolve(target)) {
+            return counted(withdrawFailures, PostingResult::ACCOUNT_NOT_FOUND);
+        }
+        std::lock_guard<std::mutex> lock(stripes[stripeOf(target.key)]);
+        JournalRecord rec;
+        result = apply(target, delta, rec);
+        if (result == PostingResult::SUCCESS) {
+            result = persist(&target, &rec, 1, false);
+        }
+        if (result == PostingResult::SUCCESS) {
+            logPosting(target, delta, TransactionType::WITHDRAWAL, currentTimestamp());
+            newBalance = rec.newBalance;
+        }
+    }
+    UserAuth::checkpointIfDue();
+    return counted(withdrawFailures, result);
+}
+
+PostingResult PostingEngine::transfer(const std::string& fromAccNum, const std::string& toAccNum, Money amount) {
+    ScopedTimer timer(transferSeconds);
+    Money delta;
+    if (!isValidAmount(amount) || !Money().subtract(amount, delta)) {
+        return counted(transferFailures, PostingResult::INVALID_AMOUNT);
+    }
+    Target legs[2];
+    if (!packAccountNumber(fromAccNum, legs[0].key) || !packAccountNumber(toAccNum, legs[1].key)) {
+        return counted(transferFailures, PostingResult::ACCOUNT_NOT_FOUND);
+    }
+    PostingResult result;
+    {
+        // Both shards, lower shard first (once if they coincide)
+        size_t firstShard = UserAuth::shardOf(legs[0].key);
+        size_t secondShard = UserAuth::shardOf(legs[1].key);
+        if (secondShard < firstShard) {
+            std::swap(firstShard, secondShard);
+        }
+        std::shared_lock<std::shared_mutex> firstShardLock(UserAuth::shards[firstShard].mutex);
+        std::shared_lock<std::shared_mutex> secondShardLock;
+        if (secondShard != firstShard) {
+            secondShardLock = std::shared_lock<std::shared_mutex>(UserAuth::shards[secondShard].mutex);
+        }
+        if (!resolve(legs[0]) || !resolve(legs[1])) {
+            return counted(transferFailures, PostingResult::ACCOUNT_NOT_FOUND);
+        }
+        if (legs[0].key == legs[1].key) {
+            return counted(transferFailures, PostingResult::SAME_ACCOUNT);
+        }
+
+        // Lock order: lower stripe first, so opposing transfers cannot deadlock
+        size_t first = stripeOf(legs[0].key);
+        size_t second = stripeOf(legs[1].key);
+        if (second < first) {
+            std::swap(first, second);
+        }
+        std::unique_lock<std::mutex> firstLock(stripes[first]);
+        std::unique_lock<std::mutex> secondLock;
+        if (second != first) {
+            secondLock = std::unique_lock<std::mutex>(stripes[second]);
+        }
+
+        JournalRecord records[2];
+        result = apply(legs[0], delta, records[0]);
+        if (result == PostingResult::SUCCESS) {
+            result = apply(legs[1], amount, records[1]);
+            if (result != PostingResult::SUCCESS) {
+                revert(legs[0], records[0]);
+            }
+        }
+        if (result == PostingResult::SUCCESS) {
+            result = persist(legs, records, 2, false); // Both legs in one journal group
+        }
+        if (result == PostingResult::SUCCESS) {
+            int64_t now = currentTimestamp();
+            logPosting(legs[0], delta, TransactionType::TRANSFER_OUT, now);
+            logPosting(legs[1], amount, TransactionType::TRANSFER_IN, now);
+        }
+    }
+    UserAuth::checkpointIfDue();
+    return counted(transferFailures, result);
+}
+
+// Validate and apply one batch request in memory; every shard is locked exclusively
+PostingResult PostingEngine::applyRequest(const PostingRequest& request, std::vector<Target>& targets,
+                                          std::vector<JournalRecord>& records) {
+    Money debit;
+    if (!isValidAmount(request.amount) || !Money().subtract(request.amount, debit)) {
+        return PostingResult::INVALID_AMOUNT;
+    }
+    Target first;
+    if (!packAccountNumber(request.account, first.key) || !resolve(first)) {
+        return PostingResult::ACCOUNT_NOT_FOUND;
+    }
+
+    JournalRecord rec;
+    PostingResult result;
+    switch (request.kind) {
+        case PostingKind::DEPOSIT:
+            result = apply(first, request.amount, rec);
+            break;
+        case PostingKind::WITHDRAWAL:
+            result = apply(first, debit, rec);
+            break;
+        case PostingKind::TRANSFER: {
+            Target second;
+            if (!packAccountNumber(request.toAccount, second.key) || !resolve(second)) {
+                return PostingResult::ACCOUNT_NOT_FOUND;
+            }
+            if (first.key == second.key) {
+                return PostingResult::SAME_ACCOUNT;
+            }
+            result = apply(first, debit, rec);
+            if (result != PostingResult::SUCCESS) {
+                return result;
+            }
+            JournalRecord credit;
+            result = apply(second, request.amount, credit);
+            if (result != PostingResult::SUCCESS) {
+                revert(first, rec);
+                return result;
+            }
+            targets.push_back(first);
+            records.push_back(rec);
+            targets.push_back(second);
+            records.push_back(credit);
+            return PostingResult::SUCCESS;
+        }
+        default:
+            return PostingResult::INVALID_AMOUNT;
+    }
+    if (result == PostingResult::SUCCESS) {
+        targets.push_back(first);
+        records.push_back(rec);
+    }
+    return result;
+}
+
+size_t PostingEngine::applyBatch(const std::vector<PostingRequest>& requests, std::vector<PostingResult>& results) {
+    ScopedTimer timer(batchSeconds);
+    results.assign(requests.size(), PostingResult::SUCCESS);
+    std::vector<Target> targets;
+    std::vector<JournalRecord> records;
+    std::vector<size_t> applied; // Indexes of the requests whose legs are in targets/records
+    targets.reserve(requests.size() * 2);
+    records.reserve(requests.size() * 2);
+    {
+        // Every shard locked exclusively: no other posting can run, so no stripe locks are needed
+        auto shardLocks = UserAuth::lockAllShards();
+        for (size_t i = 0; i < requests.size(); ++i) {
+            results[i] = applyRequest(requests[i], targets, records);
+            if (results[i] == PostingResult::SUCCESS) {
+                applied.push_back(i);
+            }
+        }
+
+        // One journal group, one write and one fsync for the whole batch
+        if (!records.empty() &&
+            persist(targets.data(), records.data(), records.size(), true) != PostingResult::SUCCESS) {
+            for (size_t i : applied) {
+                results[i] = PostingResult::PERSIST_FAILED;
+            }
+            applied.clear();
+        }
+
+        // Log the legs in request order; transfers contributed two legs each
+        int64_t now = currentTimestamp();
+        size_t leg = 0;
+        for (size_t i : applied) {
+            switch (requests[i].kind) {
+                case PostingKind::DEPOSIT:
+                    logPosting(targets[leg], records[leg].delta, TransactionType::DEPOSIT, now);
+                    leg += 1;
+                    break;
+                case PostingKind::WITHDRAWAL:
+                    logPosting(targets[leg], records[leg].delta, TransactionType::WITHDRAWAL, now);
+                    leg += 1;
+                    break;
+                case PostingKind::TRANSFER:
+                    logPosting(targets[leg], records[leg].delta, TransactionType::TRANSFER_OUT, now);
+                    logPosting(targets[leg + 1], records[leg + 1].delta, TransactionType::TRANSFER_IN, now);
+                    leg += 2;
+                    break;
+            }
+        }
+    }
+    UserAuth::checkpointIfDue();
+    batchPostings.add(requests.size());
+    batchFailures.add(requests.size() - applied.size());
+    return applied.size();
+}
+
+size_t PostingEngine::settleBatch(const std::vector<TransferRequest>& transfers, std::vector<PostingResult>& results) {
+    std::vector<PostingRequest> requests;
+    requests.reserve(transfers.size());
+    for (const auto& transfer : transfers) {
+        requests.emplace_back(PostingKind::TRANSFER, transfer.fromAccount, transfer.toAccount, transfer.amount);
+    }
+    return applyBatch(requests, results);
+}
+
+bool PostingEngine::getBalance(const std::string& accNum, Money& balance) {
+    ScopedTimer timer(balanceSeconds);
+    Target target;
+    if (!packAccountNumber(accNum, target.key)) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> shardLock(UserAuth::shardFor(target.key).mutex);
+    if (!resolve(target)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(stripes[stripeOf(target.key)]);
+    balance = target.account->getBalance();
+    return true;
+}
+
+bool PostingEngine::statement(const std::string& accNum, const StatementQuery& query, StatementPage& page) {
+    Target target;
+    if (!packAccountNumber(accNum, target.key)) {
+        return false;
+    }
+    // Only the balance and the log's end are read under the account's locks;
+    // the rows are read after releasing them
+    auto snapshot = [&target](Money& balance, LogPosition& end) {
+        std::shared_lock<std::shared_mutex> shardLock(UserAuth::shardFor(target.key).mutex);
+        if (!resolve(target)) {
+            return false;
+        }
+        // Postings log their rows under this lock, so every row behind the balance is before end
+        std::lock_guard<std::mutex> lock(stripes[stripeOf(target.key)]);
+        balance = target.account->getBalance();
+        end = transactionLogEnd();
+        return true;
+    };
+    return findStatementPage(accNum, query, snapshot, page);
+}
@@ -0,0 +1,782 @@
+// src/RequestServer.cpp
+#include "RequestServer.h"
+#include "Account.h"
+#include "AccountIndex.h"  // For packAccountNumber
+#include "Metrics.h"
+#include "Money.h"
+#include "PinHash.h"
+#include "PostingEngine.h"
+#include "Transaction.h"   // For findStatementRows
+#include "UserAuth.h"
+#include "Utility.h"       // For isValidAmount, formatTimestamp
+#include <algorithm>       // For std::max
+#include <cerrno>          // For errno
+#include <cstring>         // For std::memchr, std::strerror
+#include <fcntl.h>         // For O_NONBLOCK, O_CLOEXEC
+#include <iostream>
+#include <poll.h>          // For poll
+#include <sys/epoll.h>     // For epoll_create1, epoll_ctl, epoll_wait
+#include <sys/socket.h>    // For socket, bind, listen, accept4
+#include <sys/stat.h>      // For lstat, S_ISSOCK
+#include <sys/un.h>        // For sockaddr_un
+#include <unistd.h>        // For read, write, close, pipe2, unlink
+
+static const Counter serverConnections("bms_server_connections_total", "Client connections accepted in service mode");
+static const Counter serverRequests("bms_server_requests_total", "Requests answered in service mode");
+static const Counter serverErrors("bms_server_request_errors_total", "Requests answered with ERR in service mode");
+static const Counter serverLoginLockouts("bms_server_login_lockouts_total",
+                                         "Logins refused because the account had too many failed attempts");
+static const Histogram serverRequestSeconds("bms_server_request_seconds", "Time for a worker to run one request");
+static Gauge serverOpenConnections("bms_server_open_connections", "Client connections open in service mode");
+
+// Longest request line accepted; a longer one ends the connection
+static const size_t MAX_REQUEST_LENGTH = 1024;
+// Failed logins that end a connection
+static const uint32_t MAX_CONNECTION_LOGIN_FAILURES = 3;
+// Consecutive failed logins that lock an account, and for how long
+static const uint32_t MAX_ACCOUNT_LOGIN_FAILURES = 5;
+static const std::chrono::minutes ACCOUNT_LOCKOUT(15);
+// Unwritten responses a connection may hold before it stops being read
+static const size_t MAX_UNSENT_BYTES = 1 << 20;
+// Bytes read from one connection per wakeup, so one busy client cannot starve the rest
+static const size_t READ_CHUNK = 16 * 1024;
+static const int READS_PER_WAKEUP = 4;
+
+// A credential no account holds. A login for a missing or locked account is
+// checked against it, so that it costs a full KDF like a wrong PIN does.
+static const PinCredential& dummyCredential() {
+    static const PinCredential credential = PinHash::hash("0000");
+    return credential;
+}
+
+// One parsed request line
+struct RequestServer::Request {
+    enum class Op { LOGIN, BALANCE, DEPOSIT, WITHDRAW, STATEMENT, LOGOUT, QUIT, INVALID };
+
+    Op op;
+    std::string account; // Login only
+    std::string pin;     // Login only
+    Money amount;        // Deposit and withdraw
+    size_t rows;         // Statement; 0 for every row
+    std::string error;   // Why an INVALID request was rejected
+
+    Request() : op(Op::INVALID), account(""), pin(""), amount(), rows(0), error("") {}
+};
+
+// A client, on a socket or on stdin/stdout. The I/O thread alone touches
+// partial and the worker running the connection alone touches account;
+// everything else is guarded by mutex.
+struct RequestServer::Connection {
+    int inFd;
+    int outFd;
+    std::string partial;         // Start of a request line whose end has not arrived
+    std::string account;         // Logged-in account number; empty when logged out
+    uint32_t failedLogins;       // Failed logins so far; the worker alone touches it, like account
+    bool closing;                // Too many failed logins: close once the response is written
+
+    std::mutex mutex;
+    std::deque<Request> pending; // Parsed requests not yet run
+    std::string output;          // Responses not yet written
+    bool scheduled;              // Queued for, or being run by, a worker
+    bool inputClosed;            // No more requests will be read (end of input, quit or error)
+    bool broken;                 // The client is gone; responses are dropped
+    bool readPaused;             // maxPipeline requests queued; reading resumes when a worker takes them
+    bool closed;                 // The socket has been closed
+    uint32_t watched;            // epoll events registered for the socket (0 when not registered)
+
+    Connection(int in, int out)
+        : inFd(in), outFd(out), partial(""), account(""), failedLogins(0), closing(false), scheduled(false), inputClosed(false), broken(false),
+          readPaused(false), closed(false), watched(0) {}
+};
+
+RequestServer::RequestServer(const ServerOptions& serverOptions)
+    : options(serverOptions), listenFd(-1), epollFd(-1), wakeFds{-1, -1}, stopping(false), workersStopping(false) {
+    if (options.workers == 0) {
+        // Workers block on journal syncs, so run more of them than there are cores
+        options.workers = 2 * std::max(1u, std::thread::hardware_concurrency());
+    }
+    options.maxPipeline = std::max<size_t>(options.maxPipeline, 1);
+    if (pipe2(wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        wakeFds[0] = wakeFds[1] = -1;
+    }
+}
+
+RequestServer::~RequestServer() {
+    stopWorkers();
+    for (int fd : {listenFd, epollFd, wakeFds[0], wakeFds[1]}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+bool RequestServer::run() {
+    if (wakeFds[0] < 0) {
+        std::cerr << "Error: Could not create the server's wakeup pipe." << std::endl;
+        return false;
+    }
+    dummyCredential(); // Hashed now, so the first failed login costs no more than later ones
+    return options.socketPath.empty() ? serveStream(STDIN_FILENO, STDOUT_FILENO) : serveSocket();
+}
+
+void RequestServer::stop() {
+    stopping.store(true);
+    wake();
+}
+
+// Wake the I/O thread; a full pipe already holds a wakeup, so a failed write is fine
+void RequestServer::wake() {
+    char byte = 1;
+    ssize_t written = ::write(wakeFds[1], &byte, 1);
+    (void)written;
+}
+
+std::vector<std::shared_ptr<RequestServer::Connection>> RequestServer::takeAttention() {
+    char buffer[64];
+    while (::read(wakeFds[0], buffer, sizeof(buffer)) > 0) {
+    }
+    std::vector<std::shared_ptr<Connection>> released;
+    std::lock_guard<std::mutex> lock(queueMutex);
+    released.swap(attention);
+    return released;
+}
+
+// Parse and validate one request line. Requests that fail validation come
+// back as INVALID with the reason, to be answered in turn by a worker.
+RequestServer::Request RequestServer::parseRequest(std::string_view line) {
+    Request request;
+    if (line.size() > MAX_REQUEST_LENGTH) {
+        request.error = "Request too long";
+        return request;
+    }
+    std::string_view words[4];
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t start = line.find_first_not_of(" \t", pos);
+        if (start == std::string_view::npos) {
+            break;
+        }
+        size_t end = std::min(line.find_first_of(" \t", start), line.size());
+        if (count == 4) {
+            count = 5; // Too many words for any request
+            break;
+        }
+        words[count++] = line.substr(start, end - start);
+        pos = end;
+    }
+
+    std::string_view op = words[0];
+    bool wrongCount = false;
+    if (op == "login") {
+        wrongCount = count != 3;
+        if (!wrongCount) {
+            uint64_t key;
+            request.account = std::string(words[1]);
+            request.pin = std::string(words[2]);
+            if (!packAccountNumber(request.account, key) || !UserAuth::acceptsAccountNumber(key)) {
+                request.error = "Invalid account number";
+            } else {
+                request.op = Request::Op::LOGIN;
+            }
+        }
+    } else if (op == "deposit" || op == "withdraw") {
+        wrongCount = count != 2;
+        if (!wrongCount) {
+            if (!Money::parse(words[1], request.amount) || !isValidAmount(request.amount)) {
+                request.error = "Invalid amount";
+            } else {
+                request.op = op == "deposit" ? Request::Op::DEPOSIT : Request::Op::WITHDRAW;
+            }
+        }
+    } else if (op == "statement") {
+        wrongCount = count != 1 && count != 2;
+        if (!wrongCount) {
+            bool valid = count == 1 || (!words[1].empty() && words[1].size() <= 9);
+            for (size_t i = 0; valid && count == 2 && i < words[1].size(); ++i) {
+                valid = words[1][i] >= '0' && words[1][i] <= '9';
+                request.rows = request.rows * 10 + static_cast<size_t>(words[1][i] - '0');
+            }
+            if (!valid) {
+                request.error = "Invalid row count";
+            } else {
+                request.op = Request::Op::STATEMENT;
+            }
+        }
+    } else if (op == "balance" || op == "logout" || op == "quit") {
+        wrongCount = count != 1;
+        if (!wrongCount) {
+            request.op = op == "balance" ? Request::Op::BALANCE
+                       : op == "logout"  ? Request::Op::LOGOUT
+                                         : Request::Op::QUIT;
+        }
+    } else {
+        request.error = "Unknown request";
+    }
+    if (wrongCount) {
+        request.error = "Wrong number of arguments";
+    }
+    return request;
+}
+
+// Split newly read bytes into request lines, parse them, and queue them on
+// the connection (handing it to the workers if none has it yet)
+void RequestServer::receive(const std::shared_ptr<Connection>& conn, const char* data, size_t size) {
+    std::vector<Request> parsed;
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+        if (!newline) {
+            conn->partial.append(data, static_cast<size_t>(end - data));
+            break;
+        }
+        std::string_view line(data, static_cast<size_t>(newline - data));
+        if (!conn->partial.empty()) {
+            conn->partial.append(line);
+            line = conn->partial;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.find_first_not_of(" \t") != std::string_view::npos) {
+            parsed.push_back(parseRequest(line));
+        }
+        conn->partial.clear();
+        data = newline + 1;
+    }
+    bool tooLong = conn->partial.size() > MAX_REQUEST_LENGTH;
+    if (tooLong) {
+        parsed.push_back(parseRequest(conn->partial)); // Answered "Request too long"
+        conn->partial.clear();
+    }
+    if (parsed.empty()) {
+        return;
+    }
+
+    bool handOff = false;
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (conn->inputClosed) {
+            return; // The client quit; later requests are ignored
+        }
+        for (Request& request : parsed) {
+            conn->pending.push_back(std::move(request));
+        }
+        conn->inputClosed = tooLong; // The rest of an overlong line cannot be framed
+        conn->readPaused = conn->pending.size() >= options.maxPipeline;
+        handOff = !conn->scheduled;
+        conn->scheduled = true;
+    }
+    if (handOff) {
+        schedule(conn);
+    }
+}
+
+// Read what the client has sent, a bounded amount per call
+void RequestServer::readFrom(const std::shared_ptr<Connection>& conn) {
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (conn->inputClosed) {
+            return;
+        }
+    }
+    char buffer[READ_CHUNK];
+    for (int i = 0; i < READS_PER_WAKEUP; ++i) {
+        ssize_t n = ::read(conn->inFd, buffer, sizeof(buffer));
+        if (n > 0) {
+            receive(conn, buffer, static_cast<size_t>(n));
+            if (static_cast<size_t>(n) < sizeof(buffer)) {
+                return; // Drained for now
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        // End of input: a last line without a newline still counts
+        if (n == 0 && !conn->partial.empty()) {
+            receive(conn, "\n", 1);
+        }
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        conn->inputClosed = true;
+        if (n < 0) {
+            conn->broken = true;
+            conn->output.clear();
+        }
+        return;
+    }
+}
+
+// Write as much pending output as the client takes without blocking
+void RequestServer::flushLocked(Connection& conn) {
+    size_t written = 0;
+    while (written < conn.output.size()) {
+        ssize_t n = ::write(conn.outFd, conn.output.data() + written, conn.output.size() - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            conn.broken = true; // The client stopped reading for good
+            conn.inputClosed = true;
+            break;
+        }
+    }
+    if (conn.broken) {
+        conn.output.clear();
+    } else {
+        conn.output.erase(0, written);
+    }
+}
+
+// Nothing more will be read, run or written
+bool RequestServer::finishedLocked(const Connection& conn) {
+    return conn.inputClosed && !conn.scheduled && conn.output.empty();
+}
+
+// Register the socket for the events its state calls for. Hangups are
+// reported whether asked for or not, so a socket with nothing to do is
+// removed from the epoll set until a worker hands it back.
+void RequestServer::watchLocked(Connection& conn) {
+    uint32_t wanted = 0;
+    if (!conn.broken && !conn.closed) {
+        if (!conn.inputClosed && !conn.readPaused && conn.output.size() < MAX_UNSENT_BYTES) {
+            wanted |= EPOLLIN;
+        }
+        if (!conn.output.empty()) {
+            wanted |= EPOLLOUT;
+        }
+    }
+    if (wanted == conn.watched) {
+        return;
+    }
+    epoll_event event = {};
+    event.events = wanted;
+    event.data.ptr = &conn;
+    int op = conn.watched == 0 ? EPOLL_CTL_ADD : wanted == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    if (epoll_ctl(epollFd, op, conn.inFd, &event) == 0) {
+        conn.watched = wanted;
+    }
+}
+
+void RequestServer::acceptConnections(std::unordered_map<Connection*, std::shared_ptr<Connection>>& connections) {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Error: Could not accept a connection: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        std::shared_ptr<Connection> conn = std::make_shared<Connection>(fd, fd);
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            watchLocked(*conn);
+        }
+        connections.emplace(conn.get(), conn);
+        serverConnections.add();
+        serverOpenConnections.add(1);
+    }
+}
+
+bool RequestServer::serveSocket() {
+    const std::string& path = options.socketPath;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path " << path << " is too long." << std::endl;
+        return false;
+    }
+    path.copy(address.sun_path, path.size());
+
+    // A socket file left behind by an earlier run would make bind fail
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            std::cerr << "Error: " << path << " exists and is not a socket." << std::endl;
+            return false;
+        }
+        ::unlink(path.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event listenEvent = {};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = &listenFd;
+    epoll_event wakeEvent = {};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.ptr = wakeFds;
+    if (listenFd < 0 || epollFd < 0 ||
+        bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFds[0], &wakeEvent) != 0) {
+        std::cerr << "Error: Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    startWorkers();
+    std::cerr << "Listening on " << path << " with " << workers.size() << " worker thread(s)." << std::endl;
+
+    std::unordered_map<Connection*, std::shared_ptr<Connection>> connections;
+    std::vector<std::shared_ptr<Connection>> closedThisRound; // Keeps addresses unique within one epoll_wait
+
+    // Close a connection that is done, or update what its socket is watched for
+    auto settle = [&](const std::shared_ptr<Connection>& conn) {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (conn->closed) {
+            return;
+        }
+        if (!finishedLocked(*conn) && !conn->broken) {
+            watchLocked(*conn);
+            return;
+        }
+        if (conn->scheduled) {
+            watchLocked(*conn); // Broken: unwatch until the worker lets go of it
+            return;
+        }
+        ::close(conn->inFd); // Also removes it from the epoll set
+        conn->closed = true;
+        conn->watched = 0;
+        closedThisRound.push_back(conn);
+        connections.erase(conn.get());
+        serverOpenConnections.add(-1);
+    };
+
+    epoll_event events[64];
+    while (!stopping.load()) {
+        closedThisRound.clear();
+        int n = epoll_wait(epollFd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: Could not wait for connections: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &listenFd) {
+                acceptConnections(connections);
+                continue;
+            }
+            if (tag == wakeFds) {
+                for (const std::shared_ptr<Connection>& conn : takeAttention()) {
+                    settle(conn);
+                }
+                continue;
+            }
+            auto found = connections.find(static_cast<Connection*>(tag));
+            if (found == connections.end()) {
+                continue; // Closed earlier in this round
+            }
+            std::shared_ptr<Connection> conn = found->second;
+            uint32_t ready = events[i].events;
+            if (ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                readFrom(conn); // Requests sent just before a hangup are still run
+            }
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (ready & (EPOLLHUP | EPOLLERR)) {
+                    conn->broken = true;
+                    conn->inputClosed = true;
+                    conn->output.clear();
+                } else if (ready & EPOLLOUT) {
+                    flushLocked(*conn);
+                }
+            }
+            settle(conn);
+        }
+    }
+
+    // Answer what has been read already, then close everything
+    ::close(listenFd);
+    listenFd = -1;
+    ::unlink(path.c_str());
+    stopWorkers();
+    for (auto& entry : connections) {
+        std::lock_guard<std::mutex> lock(entry.second->mutex);
+        flushLocked(*entry.second);
+        ::close(entry.second->inFd);
+        entry.second->closed = true;
+    }
+    serverOpenConnections.add(-static_cast<int64_t>(connections.size()));
+    return true;
+}
+
+bool RequestServer::serveStream(int inFd, int outFd) {
+    std::shared_ptr<Connection> conn = std::make_shared<Connection>(inFd, outFd);
+    startWorkers();
+    serverConnections.add();
+
+    while (!stopping.load()) {
+        pollfd fds[3] = {{wakeFds[0], POLLIN, 0}, {-1, POLLIN, 0}, {-1, POLLOUT, 0}};
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if (finishedLocked(*conn)) {
+                break;
+            }
+            if (!conn->inputClosed && !conn->readPaused && conn->output.size() < MAX_UNSENT_BYTES) {
+                fds[1].fd = inFd;
+            }
+            if (!conn->output.empty()) {
+                fds[2].fd = outFd; // Only if outFd was left non-blocking
+            }
+        }
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: Could not wait for input: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[0].revents) {
+            takeAttention(); // One connection: just look at its state again
+        }
+        if (fds[1].revents) {
+            readFrom(conn);
+        }
+        if (fds[2].revents) {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            flushLocked(*conn);
+        }
+    }
+    stopWorkers();
+    return true;
+}
+
+void RequestServer::startWorkers() {
+    workersStopping = false;
+    for (size_t i = 0; i < options.workers; ++i) {
+        workers.emplace_back(&RequestServer::workerLoop, this);
+    }
+}
+
+// Let the workers run every connection already queued, then join them
+void RequestServer::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        workersStopping = true;
+    }
+    queueReady.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void RequestServer::schedule(const std::shared_ptr<Connection>& conn) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        ready.push_back(conn);
+    }
+    queueReady.notify_one();
+}
+
+void RequestServer::workerLoop() {
+    for (;;) {
+        std::shared_ptr<Connection> conn;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return !ready.empty() || workersStopping; });
+            if (ready.empty()) {
+                return;
+            }
+            conn = std::move(ready.front());
+            ready.pop_front();
+        }
+        runRequests(conn);
+    }
+}
+
+// Run every request queued on a connection so far and write their responses
+// together. A connection that queued more meanwhile goes to the back of the
+// line, so that one pipelining client cannot hold a worker forever.
+void RequestServer::runRequests(const std::shared_ptr<Connection>& conn) {
+    std::deque<Request> batch;
+    bool resumed;
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        batch.swap(conn->pending);
+        resumed = conn->readPaused;
+        conn->readPaused = false;
+    }
+
+    std::string out;
+    bool quit = false;
+    for (const Request& request : batch) {
+        execute(*conn, request, out);
+        if (request.op == Request::Op::QUIT || conn->closing) {
+            quit = true;
+            break;
+        }
+    }
+
+    bool again;
+    bool needsAttention;
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (quit) {
+            conn->inputClosed = true;
+            conn->pending.clear();
+        }
+        if (!conn->broken) {
+            conn->output += out;
+            flushLocked(*conn);
+        }
+        again = !conn->pending.empty();
+        conn->scheduled = again;
+        // The I/O thread must resume or stop reading, wait to write, or close
+        needsAttention = resumed || quit || conn->broken || !conn->output.empty() || finishedLocked(*conn);
+    }
+    if (again) {
+        schedule(conn);
+    }
+    if (needsAttention) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            attention.push_back(conn);
+        }
+        wake();
+    }
+}
+
+// Whether an account may try to log in, or is locked after too many failures
+bool RequestServer::loginAllowed(uint64_t key) {
+    std::lock_guard<std::mutex> lock(loginMutex);
+    auto it = loginFailures.find(key);
+    if (it == loginFailures.end() || it->second.count < MAX_ACCOUNT_LOGIN_FAILURES) {
+        return true;
+    }
+    if (std::chrono::steady_clock::now() >= it->second.lockedUntil) {
+        loginFailures.erase(it); // Locked out long enough; start counting again
+        return true;
+    }
+    serverLoginLockouts.add();
+    return false;
+}
+
+// Count a failed login towards the account's lockout, or clear its count after a success
+void RequestServer::recordLogin(uint64_t key, bool succeeded) {
+    std::lock_guard<std::mutex> lock(loginMutex);
+    if (succeeded) {
+        loginFailures.erase(key);
+        return;
+    }
+    LoginFailures& failures = loginFailures[key]; // Value-initialized to no failures
+    if (++failures.count >= MAX_ACCOUNT_LOGIN_FAILURES) {
+        failures.lockedUntil = std::chrono::steady_clock::now() + ACCOUNT_LOCKOUT;
+    }
+}
+
+// Append an amount and a newline to a response
+static void appendAmountLine(std::string& out, Money amount) {
+    char text[Money::MAX_TEXT_LENGTH];
+    out.append(text, amount.format(text));
+    out += '\n';
+}
+
+// Run one request for the connection and append its response to out
+void RequestServer::execute(Connection& conn, const Request& request, std::string& out) {
+    ScopedTimer timer(serverRequestSeconds);
+    serverRequests.add();
+    auto fail = [&out](const std::string& reason) {
+        serverErrors.add();
+        out += "ERR ";
+        out += reason;
+        out += '\n';
+    };
+
+    switch (request.op) {
+        case Request::Op::INVALID:
+            fail(request.error);
+            return;
+        case Request::Op::QUIT:
+            out += "OK\n";
+            return;
+        case Request::Op::LOGIN: {
+            // The same answer, after the same work, for every failure, so
+            // that numbers cannot be probed by the reply or its timing
+            Account* account = UserAuth::findAccount(request.account);
+            bool allowed = account && loginAllowed(account->getAccountKey());
+            bool succeeded = allowed && account->authenticate(request.pin);
+            if (allowed) {
+                recordLogin(account->getAccountKey(), succeeded);
+            } else {
+                PinHash::verify(dummyCredential(), request.pin); // Result ignored: only the time matters
+            }
+            if (!succeeded) {
+                if (++conn.failedLogins >= MAX_CONNECTION_LOGIN_FAILURES) {
+                    conn.closing = true;
+                    fail("Too many failed logins");
+                } else {
+                    fail("Invalid account number or PIN");
+                }
+                return;
+            }
+            conn.account = request.account;
+            out += "OK ";
+            out += account->getOwnerName();
+            out += '\n';
+            return;
+        }
+        default:
+            break;
+    }
+
+    if (conn.account.empty()) {
+        fail("Not logged in");
+        return;
+    }
+    PostingResult result = PostingResult::SUCCESS;
+    Money balance; // After the posting, read under the same lock
+    switch (request.op) {
+        case Request::Op::LOGOUT:
+            conn.account.clear();
+            out += "OK\n";
+            return;
+        case Request::Op::STATEMENT: {
+            StatementQuery query;
+            query.pageSize = request.rows;
+            std::vector<Transaction> rows = findStatementRows(conn.account, query);
+            out += "OK " + std::to_string(rows.size()) + '\n';
+            for (const Transaction& trans : rows) {
+                char date[TIMESTAMP_TEXT_LENGTH];
+                formatTimestamp(trans.timestamp, date);
+                out.append(date, sizeof(date));
+                out += ',';
+                out += transactionTypeToString(trans.type);
+                out += ',';
+                appendAmountLine(out, trans.amount);
+            }
+            return;
+        }
+        case Request::Op::DEPOSIT:
+            result = PostingEngine::deposit(conn.account, request.amount, balance);
+            break;
+        case Request::Op::WITHDRAW:
+            result = PostingEngine::withdraw(conn.account, request.amount, balance);
+            break;
+        default:
+            if (!PostingEngine::getBalance(conn.account, balance)) { // Balance
+                result = PostingResult::ACCOUNT_NOT_FOUND;
+            }
+            break;
+    }
+
+    if (result != PostingResult::SUCCESS) {
+        fail(postingResultToString(result));
+        return;
+    }
+    out += "OK ";
+    appendAmountLine(out, balance);
+}
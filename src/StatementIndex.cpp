@@ -0,0 +1,347 @@
+// src/StatementIndex.cpp
+#include "StatementIndex.h"
+#include "AccountIndex.h" // For hashAccountKey
+#include "TransactionLogReader.h"
+#include <algorithm>      // For std::min
+#include <cstring>        // For std::memcmp, std::memcpy, std::memset
+#include <fcntl.h>        // For open
+#include <iostream>
+#include <limits>         // For std::numeric_limits
+#include <sys/mman.h>     // For mmap, munmap
+#include <sys/stat.h>     // For fstat
+#include <unistd.h>       // For pread, pwrite, ftruncate, close
+#include <vector>
+
+const uint64_t StatementIndex::NO_ENTRY = std::numeric_limits<uint64_t>::max();
+
+// Heads files without this magic are rebuilt from the log
+static const char HEADS_MAGIC[8] = {'B', 'M', 'S', 'S', 'I', 'D', 'X', '2'};
+static const uint64_t EMPTY_HEAD = std::numeric_limits<uint64_t>::max();
+static const uint64_t INITIAL_HEADS_CAPACITY = 1024;
+static const size_t BATCH_CHUNK_ROWS = size_t(1) << 20; // Rows per entries write in addBatch
+
+struct StatementIndex::HeadsHeader {
+    char magic[8];
+    uint64_t capacity;     // Number of slots (a power of two)
+    uint64_t used;         // Occupied slots
+    uint64_t entryCount;   // Entries in the entries file
+    uint64_t coveredBytes; // Log bytes reflected in the index
+    uint64_t reserved[3];
+};
+
+struct StatementIndex::HeadSlot {
+    uint64_t accountKey; // EMPTY_HEAD when unused
+    uint64_t newest;     // Newest entry for this account
+};
+
+StatementIndex::StatementIndex(const std::string& logFile, const std::string& entriesFile, const std::string& headsFile)
+    : logPath(logFile), entriesPath(entriesFile), headsPath(headsFile),
+      entriesFd(-1), headsFd(-1), heads(nullptr), headsSize(0) {}
+
+StatementIndex::~StatementIndex() {
+    close();
+}
+
+StatementIndex::HeadsHeader& StatementIndex::header() const {
+    return *reinterpret_cast<HeadsHeader*>(heads);
+}
+
+StatementIndex::HeadSlot* StatementIndex::slots() const {
+    return reinterpret_cast<HeadSlot*>(heads + sizeof(HeadsHeader));
+}
+
+// Find the slot holding accountKey, or the empty slot where it would go
+StatementIndex::HeadSlot& StatementIndex::probe(uint64_t accountKey) const {
+    uint64_t mask = header().capacity - 1;
+    uint64_t i = hashAccountKey(accountKey) & mask;
+    HeadSlot* table = slots();
+    while (table[i].accountKey != EMPTY_HEAD && table[i].accountKey != accountKey) {
+        i = (i + 1) & mask;
+    }
+    return table[i];
+}
+
+// Map the heads file and validate its header
+bool StatementIndex::mapHeads() {
+    struct stat st;
+    if (fstat(headsFd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(HeadsHeader)) {
+        return false;
+    }
+    headsSize = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, headsSize, PROT_READ | PROT_WRITE, MAP_SHARED, headsFd, 0);
+    if (mapping == MAP_FAILED) {
+        heads = nullptr;
+        return false;
+    }
+    heads = static_cast<char*>(mapping);
+    const HeadsHeader& hdr = header();
+    uint64_t capacity = hdr.capacity;
+    return std::memcmp(hdr.magic, HEADS_MAGIC, sizeof(hdr.magic)) == 0 &&
+           capacity != 0 && (capacity & (capacity - 1)) == 0 &&
+           headsSize == sizeof(HeadsHeader) + capacity * sizeof(HeadSlot);
+}
+
+// Create an empty heads table with the given capacity
+bool StatementIndex::createHeads(uint64_t capacity) {
+    if (heads) {
+        munmap(heads, headsSize);
+        heads = nullptr;
+    }
+    size_t size = sizeof(HeadsHeader) + capacity * sizeof(HeadSlot);
+    if (ftruncate(headsFd, 0) != 0 || ftruncate(headsFd, size) != 0) {
+        return false;
+    }
+    if (!mapHeads()) {
+        // A fresh file has no magic yet; map it raw and initialize it
+        if (!heads) {
+            return false;
+        }
+    }
+    HeadsHeader& hdr = header();
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, HEADS_MAGIC, sizeof(hdr.magic));
+    hdr.capacity = capacity;
+    HeadSlot* table = slots();
+    for (uint64_t i = 0; i < capacity; ++i) {
+        table[i].accountKey = EMPTY_HEAD;
+        table[i].newest = NO_ENTRY;
+    }
+    return true;
+}
+
+// Double the heads table, keeping every account's newest entry
+bool StatementIndex::growHeads() {
+    const HeadsHeader& hdr = header();
+    std::vector<HeadSlot> live;
+    live.reserve(hdr.used);
+    for (uint64_t i = 0; i < hdr.capacity; ++i) {
+        if (slots()[i].accountKey != EMPTY_HEAD) {
+            live.push_back(slots()[i]);
+        }
+    }
+    uint64_t entryCount = hdr.entryCount;
+    uint64_t coveredBytes = hdr.coveredBytes;
+    if (!createHeads(hdr.capacity * 2)) {
+        return false;
+    }
+    for (const auto& slot : live) {
+        probe(slot.accountKey) = slot;
+    }
+    header().used = live.size();
+    header().entryCount = entryCount;
+    header().coveredBytes = coveredBytes;
+    return true;
+}
+
+// Open the sidecars and bring them up to date with the log
+bool StatementIndex::open() {
+    if (heads) {
+        return true;
+    }
+    entriesFd = ::open(entriesPath.c_str(), O_RDWR | O_CREAT, 0644);
+    headsFd = ::open(headsPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (entriesFd < 0 || headsFd < 0) {
+        close();
+        return false;
+    }
+    if (!mapHeads()) {
+        // Missing or damaged heads file: start over from the log
+        return rebuild();
+    }
+
+    struct stat st;
+    if (stat(logPath.c_str(), &st) != 0) {
+        st.st_size = 0;
+    }
+    if (header().coveredBytes > static_cast<uint64_t>(st.st_size)) {
+        return rebuild(); // The log was replaced or truncated
+    }
+    // Drop entries written after the last header update (crash mid-add)
+    if (ftruncate(entriesFd, header().entryCount * sizeof(StatementIndexEntry)) != 0) {
+        return rebuild();
+    }
+    return catchUp();
+}
+
+void StatementIndex::close() {
+    if (heads) {
+        munmap(heads, headsSize);
+        heads = nullptr;
+    }
+    if (entriesFd >= 0) {
+        ::close(entriesFd);
+        entriesFd = -1;
+    }
+    if (headsFd >= 0) {
+        ::close(headsFd);
+        headsFd = -1;
+    }
+}
+
+// Record a row that was just appended to the log
+bool StatementIndex::add(uint64_t accountKey, uint64_t offset, uint32_t length) {
+    if (!heads) {
+        return false;
+    }
+    if ((header().used + 1) * 2 > header().capacity && !growHeads()) {
+        return false;
+    }
+
+    HeadSlot& slot = probe(accountKey);
+    StatementIndexEntry entry;
+    entry.accountKey = accountKey;
+    entry.offset = offset;
+    entry.prev = slot.accountKey == accountKey ? slot.newest : NO_ENTRY;
+    entry.length = length;
+    entry.reserved = 0;
+
+    // Write the entry first; the header only counts it once it is on disk
+    uint64_t entryNumber = header().entryCount;
+    off_t position = static_cast<off_t>(entryNumber * sizeof(entry));
+    if (pwrite(entriesFd, &entry, sizeof(entry), position) != static_cast<ssize_t>(sizeof(entry))) {
+        return false;
+    }
+    if (slot.accountKey != accountKey) {
+        slot.accountKey = accountKey;
+        ++header().used;
+    }
+    slot.newest = entryNumber;
+    header().entryCount = entryNumber + 1;
+    header().coveredBytes = offset + length;
+    return true;
+}
+
+// Record rows appended to the log, a chunk at a time
+bool StatementIndex::addBatch(const Transaction* rows, size_t count, uint64_t firstOffset) {
+    if (!heads) {
+        return false;
+    }
+    for (size_t done = 0; done < count; done += BATCH_CHUNK_ROWS) {
+        size_t rowsInChunk = std::min(count - done, BATCH_CHUNK_ROWS);
+        if (!addChunk(rows + done, rowsInChunk, firstOffset + done * sizeof(Transaction))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Record a run of rows appended to the log with one write of their entries
+bool StatementIndex::addChunk(const Transaction* rows, size_t count, uint64_t firstOffset) {
+    // Chain the batch's entries through a table of its own accounts first,
+    // so the heads are only touched once the entries are on disk
+    uint64_t capacity = INITIAL_HEADS_CAPACITY;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    std::vector<HeadSlot> newest(capacity, HeadSlot{EMPTY_HEAD, NO_ENTRY});
+    std::vector<StatementIndexEntry> entries;
+    entries.reserve(count);
+    uint64_t firstEntry = header().entryCount;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t accountKey = rows[i].accountKey;
+        if (accountKey == EMPTY_HEAD) {
+            continue; // No account to file it under
+        }
+        uint64_t slot = hashAccountKey(accountKey) & (capacity - 1);
+        while (newest[slot].accountKey != EMPTY_HEAD && newest[slot].accountKey != accountKey) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        StatementIndexEntry entry;
+        entry.accountKey = accountKey;
+        entry.offset = firstOffset + i * sizeof(Transaction);
+        if (newest[slot].accountKey == accountKey) {
+            entry.prev = newest[slot].newest;
+        } else {
+            const HeadSlot& head = probe(accountKey);
+            entry.prev = head.accountKey == accountKey ? head.newest : NO_ENTRY;
+            newest[slot].accountKey = accountKey;
+        }
+        entry.length = sizeof(Transaction);
+        entry.reserved = 0;
+        newest[slot].newest = firstEntry + entries.size();
+        entries.push_back(entry);
+    }
+
+    size_t bytes = entries.size() * sizeof(StatementIndexEntry);
+    off_t position = static_cast<off_t>(firstEntry * sizeof(StatementIndexEntry));
+    if (pwrite(entriesFd, entries.data(), bytes, position) != static_cast<ssize_t>(bytes)) {
+        return false;
+    }
+    for (const auto& batchHead : newest) {
+        if (batchHead.accountKey == EMPTY_HEAD) {
+            continue;
+        }
+        if ((header().used + 1) * 2 > header().capacity && !growHeads()) {
+            return false;
+        }
+        HeadSlot& slot = probe(batchHead.accountKey);
+        if (slot.accountKey != batchHead.accountKey) {
+            slot.accountKey = batchHead.accountKey;
+            ++header().used;
+        }
+        slot.newest = batchHead.newest;
+    }
+    header().entryCount = firstEntry + entries.size();
+    header().coveredBytes = firstOffset + count * sizeof(Transaction);
+    return true;
+}
+
+// Index every complete log record past the covered byte count
+bool StatementIndex::catchUp() {
+    TransactionLogReader reader;
+    if (!reader.open(logPath)) {
+        return true; // No log yet (or not one we can read), nothing to index
+    }
+    uint64_t first = header().coveredBytes > sizeof(TransactionLogHeader)
+                         ? (header().coveredBytes - sizeof(TransactionLogHeader)) / sizeof(Transaction)
+                         : 0;
+    const Transaction* records = reader.begin();
+    for (uint64_t i = first; i < reader.size(); ++i) {
+        uint64_t offset = sizeof(TransactionLogHeader) + i * sizeof(Transaction);
+        if (records[i].accountKey == EMPTY_HEAD) {
+            header().coveredBytes = offset + sizeof(Transaction); // No account to file it under
+            continue;
+        }
+        if (!add(records[i].accountKey, offset, sizeof(Transaction))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rebuild both sidecars from the log in a single streaming pass
+bool StatementIndex::rebuild() {
+    if (entriesFd < 0 || headsFd < 0) {
+        return false;
+    }
+    if (ftruncate(entriesFd, 0) != 0 || !createHeads(INITIAL_HEADS_CAPACITY)) {
+        close();
+        return false;
+    }
+    return catchUp();
+}
+
+// Visit the rows of an account newest first
+void StatementIndex::forEachRow(uint64_t accountKey,
+                                const std::function<bool(uint64_t offset, uint32_t length)>& visit) const {
+    if (!heads) {
+        return;
+    }
+    const HeadSlot& slot = probe(accountKey);
+    if (slot.accountKey != accountKey) {
+        return;
+    }
+    uint64_t entryNumber = slot.newest;
+    StatementIndexEntry entry;
+    while (entryNumber != NO_ENTRY) {
+        off_t position = static_cast<off_t>(entryNumber * sizeof(entry));
+        if (pread(entriesFd, &entry, sizeof(entry), position) != static_cast<ssize_t>(sizeof(entry)) ||
+            entry.accountKey != accountKey || (entry.prev >= entryNumber && entry.prev != NO_ENTRY)) {
+            return; // Damaged chain; stop rather than loop
+        }
+        if (!visit(entry.offset, entry.length)) {
+            return;
+        }
+        entryNumber = entry.prev;
+    }
+}
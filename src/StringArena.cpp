@@ -0,0 +1,61 @@
+// src/StringArena.cpp
+#include "StringArena.h"
+#include <cstring> // For std::memcpy
+
+const size_t StringArena::BLOCK_SIZE = 1 << 20; // 1 MiB
+
+StringArena::StringArena() : cursor(nullptr), remaining(0), used(0), reserved(0) {}
+
+// Carve n bytes out of the current block, starting a new one if it is full
+char* StringArena::allocateLocked(size_t n) {
+    if (n > remaining) {
+        size_t size = n > BLOCK_SIZE / 4 ? n : BLOCK_SIZE;
+        blocks.emplace_back(new char[size]);
+        reserved += size;
+        if (size != BLOCK_SIZE) {
+            // Oversized request: give it a dedicated block and keep filling the current one
+            used += n;
+            return blocks.back().get();
+        }
+        cursor = blocks.back().get();
+        remaining = size;
+    }
+    char* result = cursor;
+    cursor += n;
+    remaining -= n;
+    used += n;
+    return result;
+}
+
+// Copy text into the arena
+std::string_view StringArena::store(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    char* copy = allocateLocked(text.size());
+    std::memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+}
+
+// Reserve space for the caller to fill
+char* StringArena::allocate(size_t n) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocateLocked(n);
+}
+
+size_t StringArena::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+size_t StringArena::bytesReserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reserved;
+}
+
+// Function-local static so it is ready before any other static initializer uses it
+StringArena& StringArena::names() {
+    static StringArena arena;
+    return arena;
+}
@@ -1,69 +1,514 @@
 // src/Transaction.cpp
 #include "Transaction.h"
-#include <fstream>  // For std::ofstream, std::ifstream
+#include "AccountIndex.h"   // For packAccountNumber
+#include "LogSegments.h"
+#include "Metrics.h"
+#include "PostingEngine.h"  // For PostingEngine::statement
+#include "StatementIndex.h"
+#include "TransactionLogReader.h"
+#include "TransactionLogger.h"
+#include "Utility.h"        // For formatTimestamp, formatDateTime, parseDateTime
+#include <algorithm> // For std::reverse, std::stable_sort, std::min
+#include <cstdio>   // For std::rename
+#include <fstream>  // For std::ofstream
+#include <functional> // For std::function
 #include <iostream> // For std::cout, std::endl
-#include <iomanip>  // For std::fixed, std::setprecision
-#include <sstream>  // For std::getline
+#include <iomanip>  // For std::setw
+#include <queue>    // For std::priority_queue
+#include <shared_mutex> // For std::shared_lock
+#include <sys/stat.h>   // For stat
 
-// Path to the transaction logs file
-const std::string LOGS_FILE = "data/logs.txt";
+// Path to the transaction logs file (binary Transaction records)
+const std::string LOGS_FILE = "data/logs.dat";
+
+// Path of the CSV log written by earlier versions; folded into the segments on first start
+const std::string LEGACY_LOGS_FILE = "data/logs.txt";
+
+// Sidecar files of the per-account statement index over LOGS_FILE
+const std::string LOGS_INDEX_FILE = "data/logs.idx";
+const std::string LOGS_HEADS_FILE = "data/logs.heads";
+
+// Directory holding closed (rolled-over) segments of LOGS_FILE
+const std::string LOGS_SEGMENT_DIR = "data/logs";
+
+static const Histogram logAppendSeconds("bms_log_append_seconds", "Time to append a row to the transaction log", 16);
+static const Counter logAppends("bms_log_appends_total", "Rows appended to the transaction log");
+static const Counter logAppendErrors("bms_log_append_errors_total", "Rows the transaction log could not take");
+static const Histogram statementSeconds("bms_statement_seconds", "Time to find the rows of an account statement");
+static const Counter statementRows("bms_statement_rows_total", "Rows found for account statements");
+static const Histogram querySeconds("bms_query_seconds", "Time to run an audit query over every account");
+static const Counter queryRows("bms_query_rows_total", "Rows returned by audit queries");
+static const Counter logBlocksScanned("bms_log_blocks_scanned_total", "Active log blocks read by audit queries");
+static const Counter logBlocksSkipped("bms_log_blocks_skipped_total", "Active log blocks audit queries ruled out by their RowRange");
+
+// Helper function to convert TransactionType enum to string
+std::string transactionTypeToString(TransactionType type) {
+    switch (type) {
+        case TransactionType::DEPOSIT: return "Deposit";
+        case TransactionType::WITHDRAWAL: return "Withdrawal";
+        case TransactionType::TRANSFER_OUT: return "Transfer Out";
+        case TransactionType::TRANSFER_IN: return "Transfer In";
+        default: return "Unknown";
+    }
+}
+
+// Helper function to convert string to TransactionType enum
+TransactionType stringToTransactionType(const std::string& typeStr) {
+    if (typeStr == "Deposit") return TransactionType::DEPOSIT;
+    if (typeStr == "Withdrawal") return TransactionType::WITHDRAWAL;
+    if (typeStr == "Transfer Out") return TransactionType::TRANSFER_OUT;
+    if (typeStr == "Transfer In") return TransactionType::TRANSFER_IN;
+    return TransactionType::UNKNOWN;
+}
+
+// The statement index, opened (and brought up to date with the log) on first use
+static StatementIndex& statementIndex() {
+    static StatementIndex index(LOGS_FILE, LOGS_INDEX_FILE, LOGS_HEADS_FILE);
+    index.open();
+    return index;
+}
+
+// The buffered log writer, created on first use and flushed at program exit
+static TransactionLogger& transactionLogger() {
+    static TransactionLogger logger(LOGS_FILE, LoggerPolicy(), &statementIndex());
+    return logger;
+}
+
+// The closed segments of the log, opened once on first use
+static LogSegments& logSegments() {
+    static LogSegments segments(LOGS_FILE, LOGS_SEGMENT_DIR, SegmentPolicy());
+    static bool opened = [] {
+        if (!segments.open()) {
+            return false;
+        }
+        struct stat st;
+        return stat(LEGACY_LOGS_FILE.c_str(), &st) != 0 || segments.adoptLegacyLog(LEGACY_LOGS_FILE);
+    }();
+    (void)opened;
+    return segments;
+}
+
+// Open the log, its statement index and its segments ahead of the first posting
+void openTransactionLog() {
+    transactionLogger();
+    logSegments();
+}
+
+// Convert a query date to epoch seconds; a bare "YYYY-MM-DD" means the start
+// of that day, or its last second for an upper bound
+static bool parseQueryDate(const std::string& text, bool endOfDay, int64_t& epochSeconds) {
+    std::string full = text.size() == 10 ? text + (endOfDay ? " 23:59:59" : " 00:00:00") : text;
+    if (!parseDateTime(full, epochSeconds)) {
+        return false;
+    }
+    // parseDateTime lets mktime carry out-of-range fields over (month 13 becomes January)
+    int month = (full[5] - '0') * 10 + (full[6] - '0');
+    int day = (full[8] - '0') * 10 + (full[9] - '0');
+    int hour = (full[11] - '0') * 10 + (full[12] - '0');
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31 && hour <= 23 && full[14] <= '5' && full[17] <= '5';
+}
+
+// Function to turn a query into a RowFilter
+bool compileQuery(const std::string& accountNumber, const StatementQuery& query, RowFilter& filter) {
+    filter = RowFilter();
+    if (!accountNumber.empty()) {
+        filter.allAccounts = false;
+        if (!packAccountNumber(accountNumber, filter.accountKey)) {
+            return false;
+        }
+    }
+    if ((!query.fromDate.empty() && !parseQueryDate(query.fromDate, false, filter.fromTimestamp)) ||
+        (!query.toDate.empty() && !parseQueryDate(query.toDate, true, filter.toTimestamp))) {
+        return false;
+    }
+    filter.types = query.types != 0 ? query.types : ~0u;
+    filter.minAmount = query.minAmount;
+    filter.maxAmount = query.maxAmount;
+    return true;
+}
+
+// Write a transaction as an "account,type,amount,YYYY-MM-DD HH:MM:SS" CSV row
+static void writeCsvRow(std::ostream& os, const Transaction& trans) {
+    char amount[Money::MAX_TEXT_LENGTH];
+    char date[TIMESTAMP_TEXT_LENGTH];
+    size_t amountLength = trans.amount.format(amount);
+    formatTimestamp(trans.timestamp, date);
+    os << unpackAccountNumber(trans.accountKey) << ',' << transactionTypeToString(trans.type) << ',';
+    os.write(amount, static_cast<std::streamsize>(amountLength));
+    os.put(',');
+    os.write(date, sizeof(date));
+    os.put('\n');
+}
 
 // Function to log a transaction to the logs file
-void logTransaction(const Transaction& trans) {
-    // Open the logs file in append mode
-    std::ofstream ofs(LOGS_FILE, std::ios::app);
-    if (!ofs.is_open()) {
-        std::cerr << "Error: Could not open logs file for writing." << std::endl;
-        return;
+bool logTransaction(const Transaction& trans) {
+    ScopedTimer timer(logAppendSeconds);
+    logAppends.add();
+    // Start a new segment first if the active one is full or this row begins a new day
+    logSegments().rollOverIfDue(transactionLogger(), trans.timestamp);
+    // Rows are buffered and written in groups; see LoggerPolicy for the flush rules
+    if (!transactionLogger().append(trans)) {
+        logAppendErrors.add();
+        std::cerr << "Error: Could not log transaction; the logs file cannot be written." << std::endl;
+        return false;
     }
+    return true;
+}
 
-    // Write transaction details in a comma-separated format
-    ofs << trans.accountNumber << ","
-        << trans.type << ","
-        << std::fixed << std::setprecision(2) << trans.amount << ","
-        << trans.date << std::endl;
+// Function to log many transactions with one write to the logs file
+bool logTransactions(const Transaction* rows, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    logAppends.add(count);
+    // The whole batch goes to one segment, chosen by its first row
+    logSegments().rollOverIfDue(transactionLogger(), rows[0].timestamp);
+    if (!transactionLogger().appendBatch(rows, count)) {
+        logAppendErrors.add();
+        std::cerr << "Error: Could not log " << count << " transaction(s)." << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    ofs.close();
+// Function to check that the logger can hold count more rows
+bool transactionLogAccepts(size_t count) {
+    return transactionLogger().accepts(count);
+}
+
+// Function to write any buffered transactions to the logs file
+bool flushTransactionLog() {
+    if (!transactionLogger().flush()) {
+        logAppendErrors.add();
+        std::cerr << "Error: Could not write buffered transactions to the logs file." << std::endl;
+        return false;
+    }
+    return true;
 }
 
 // Function to view all transactions for a specific account
 void viewAccountStatement(const std::string& accountNumber) {
-    std::ifstream ifs(LOGS_FILE);
-    if (!ifs.is_open()) {
+    viewAccountStatement(accountNumber, StatementQuery());
+}
+
+// This thread's mapping of the active log, brought up to date. Each thread
+// keeps its own, sized for a full segment, so this usually costs a single
+// stat. The caller holds logSegments().lockForReading().
+static TransactionLogReader& activeLogReader() {
+    thread_local TransactionLogReader log;
+    if (!log.refresh()) {
+        log.open(LOGS_FILE, SegmentPolicy().maxActiveBytes); // May fail if nothing is logged yet
+    }
+    return log;
+}
+
+// Walk an account's records newest first until visit returns false: the
+// active log (read in place through the statement index) up to logEnd
+// bytes, then the sealed segments, skipping blocks with no row within
+// bounds (see LogSegments::forEachAccountRow for keepNewer). Timestamps
+// are not assumed to grow with log order, so visit sees rows outside
+// bounds. The caller flushed the log and holds logSegments().lockForReading().
+static void forEachAccountRow(uint64_t key, const RowFilter& bounds, bool keepNewer, uint64_t logEnd,
+                              const std::function<bool(const Transaction&)>& visit) {
+    TransactionLogReader& log = activeLogReader();
+    bool more = true;
+    statementIndex().forEachRow(key, [&](uint64_t offset, uint32_t) {
+        if (offset >= logEnd) {
+            return true; // Logged after the caller's snapshot
+        }
+        const Transaction* trans = log.at(offset);
+        if (!trans) {
+            return false; // Index runs past the log; the segments still hold older rows
+        }
+        if (trans->accountKey != key) {
+            return true; // Stale entry; ignore it
+        }
+        return more = visit(*trans);
+    });
+    if (more) {
+        logSegments().forEachAccountRow(key, visit, bounds, keepNewer);
+    }
+}
+
+// Function to note where the log ends now
+LogPosition transactionLogEnd() {
+    LogPosition end;
+    do {
+        end.segment = logSegments().activeSegment();
+        end.bytes = transactionLogger().size();
+    } while (logSegments().activeSegment() != end.segment); // Both from the same segment
+    return end;
+}
+
+// Undo a row's effect on an account's balance, giving the balance before it
+static void takeBack(const Transaction& trans, Money& balance) {
+    switch (trans.type) {
+        case TransactionType::DEPOSIT:
+        case TransactionType::TRANSFER_IN:
+            balance.subtract(trans.amount, balance);
+            break;
+        case TransactionType::WITHDRAWAL:
+        case TransactionType::TRANSFER_OUT:
+            balance.add(trans.amount, balance);
+            break;
+        default:
+            break; // Rows of unknown type (from damaged legacy logs) carry no direction
+    }
+}
+
+// Function to collect the transactions of an account that match a query
+std::vector<Transaction> findStatementRows(const std::string& accountNumber, const StatementQuery& query) {
+    ScopedTimer timer(statementSeconds);
+    std::vector<Transaction> rows;
+    RowFilter filter;
+    if (!compileQuery(accountNumber, query, filter)) {
+        std::cerr << "Error: Invalid statement query." << std::endl;
+        return rows;
+    }
+    flushTransactionLog(); // Make the latest transactions visible to the reader
+
+    // Keep rows from moving between the active log and the segments while we read
+    std::shared_lock<std::shared_mutex> reading = logSegments().lockForReading();
+    size_t toSkip = query.pageSize * query.page;
+    forEachAccountRow(filter.accountKey, filter, false, UINT64_MAX, [&](const Transaction& trans) {
+        if (!filter.matches(trans)) {
+            return true;
+        }
+        if (toSkip > 0) {
+            --toSkip;
+            return true;
+        }
+        rows.push_back(trans);
+        return query.pageSize == 0 || rows.size() < query.pageSize;
+    });
+    std::reverse(rows.begin(), rows.end()); // Oldest first
+    statementRows.add(rows.size());
+    return rows;
+}
+
+// Function to collect one page of an account's statement with running balances
+bool findStatementPage(const std::string& accountNumber, const StatementQuery& query,
+                       const std::function<bool(Money&, LogPosition&)>& snapshot, StatementPage& page) {
+    ScopedTimer timer(statementSeconds);
+    page = StatementPage();
+    RowFilter filter;
+    if (!compileQuery(accountNumber, query, filter)) {
+        return false;
+    }
+    Money balance;
+    LogPosition end;
+    std::shared_lock<std::shared_mutex> reading;
+    while (true) {
+        if (!snapshot(balance, end)) {
+            return false;
+        }
+        flushTransactionLog(); // The rows before end may still be buffered
+        reading = logSegments().lockForReading();
+        if (logSegments().activeSegment() == end.segment) {
+            break;
+        }
+        // The active segment was closed since the snapshot, and a sealed
+        // segment no longer shows which rows came after it: take a new one
+        reading.unlock();
+    }
+
+    // The balance is carried back through every row logged after the oldest
+    // one that may match, whatever its type, amount or timestamp (the clock
+    // can step back); only blocks logged before that one can be skipped
+    size_t toSkip = query.pageSize * query.page;
+    forEachAccountRow(filter.accountKey, filter, true, end.bytes, [&](const Transaction& trans) {
+        if (filter.matches(trans)) {
+            if (toSkip > 0) {
+                --toSkip;
+            } else if (query.pageSize != 0 && page.rows.size() == query.pageSize) {
+                page.hasMore = true;
+                return false;
+            } else {
+                page.rows.push_back(StatementRow{trans, balance});
+            }
+        }
+        takeBack(trans, balance);
+        return true;
+    });
+    std::reverse(page.rows.begin(), page.rows.end()); // Oldest first
+    statementRows.add(page.rows.size());
+    return true;
+}
+
+// Function to collect the transactions of every account that match a query
+std::vector<Transaction> findTransactions(const StatementQuery& query) {
+    ScopedTimer timer(querySeconds);
+    std::vector<Transaction> rows;
+    RowFilter filter;
+    if (!compileQuery("", query, filter)) {
+        std::cerr << "Error: Invalid transaction query." << std::endl;
+        return rows;
+    }
+    flushTransactionLog();
+    std::shared_lock<std::shared_mutex> reading = logSegments().lockForReading();
+
+    // The active log a block at a time, skipping blocks whose range rules out
+    // a match; rows past the last complete block are checked one by one
+    TransactionLogReader& log = activeLogReader();
+    const std::vector<RowRange>& ranges = log.blockRanges();
+    std::vector<Transaction> active;
+    size_t skipped = 0;
+    for (size_t b = 0; b <= ranges.size(); ++b) {
+        if (b < ranges.size() && !filter.mayMatch(ranges[b])) {
+            ++skipped;
+            continue;
+        }
+        const Transaction* first = log.begin() + b * LOG_RANGE_ROWS;
+        const Transaction* last = b < ranges.size() ? first + LOG_RANGE_ROWS : log.end();
+        for (const Transaction* trans = first; trans < last; ++trans) {
+            if (filter.matches(*trans)) {
+                active.push_back(*trans);
+            }
+        }
+    }
+    logBlocksScanned.add(ranges.size() - skipped);
+    logBlocksSkipped.add(skipped);
+
+    if (query.pageSize == 0) {
+        logSegments().forEachMatchingRow(filter, [&rows](const Transaction& trans) {
+            rows.push_back(trans);
+            return true;
+        });
+        rows.insert(rows.end(), active.begin(), active.end());
+    } else {
+        // Only the newest pageSize * (page + 1) matches can be shown, so once
+        // that many are known, segments whose rows are all older than them are
+        // skipped. Segments come newest first; each one's rows are kept apart
+        // so that they can be put back in log order.
+        size_t wanted = query.pageSize * (query.page + 1);
+        std::priority_queue<int64_t, std::vector<int64_t>, std::greater<int64_t>> newest; // The wanted newest timestamps
+        auto note = [&newest, wanted](int64_t timestamp) {
+            if (newest.size() < wanted) {
+                newest.push(timestamp);
+            } else if (timestamp > newest.top()) {
+                newest.pop();
+                newest.push(timestamp);
+            }
+        };
+        for (const auto& trans : active) {
+            note(trans.timestamp);
+        }
+        std::vector<std::vector<Transaction>> bySegment;
+        logSegments().forEachRecentMatchingRow(
+            filter,
+            [&](int64_t, int64_t lastTimestamp) {
+                if (newest.size() == wanted && lastTimestamp < newest.top()) {
+                    return false;
+                }
+                bySegment.emplace_back();
+                return true;
+            },
+            [&](const Transaction& trans) {
+                bySegment.back().push_back(trans);
+                note(trans.timestamp);
+                return true;
+            });
+        for (auto segment = bySegment.rbegin(); segment != bySegment.rend(); ++segment) {
+            rows.insert(rows.end(), segment->begin(), segment->end());
+        }
+        rows.insert(rows.end(), active.begin(), active.end());
+    }
+
+    // Sealed rows come grouped by account; put every row in time order
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Transaction& a, const Transaction& b) { return a.timestamp < b.timestamp; });
+    if (query.pageSize != 0) {
+        size_t end = rows.size() - std::min(rows.size(), query.pageSize * query.page);
+        size_t begin = end - std::min(end, query.pageSize);
+        rows = std::vector<Transaction>(rows.begin() + begin, rows.begin() + end);
+    }
+    queryRows.add(rows.size());
+    return rows;
+}
+
+// Function to view the transactions of an account that match a query
+void viewAccountStatement(const std::string& accountNumber, const StatementQuery& query) {
+    flushTransactionLog(); // The log file may not exist until its first rows are flushed
+    struct stat st;
+    if (stat(LOGS_FILE.c_str(), &st) != 0 && logSegments().segmentCount() == 0) {
         std::cout << "No transaction history found for this account yet." << std::endl;
         return;
     }
+    StatementPage page;
+    if (!PostingEngine::statement(accountNumber, query, page)) {
+        std::cout << "Could not read the statement: unknown account or invalid query." << std::endl;
+        return;
+    }
 
     std::cout << "\n--- Transaction Statement for Account: " << accountNumber << " ---" << std::endl;
     std::cout << std::setw(20) << std::left << "Date"
               << std::setw(15) << std::left << "Type"
-              << std::setw(15) << std::left << "Amount" << std::endl;
-    std::cout << std::string(50, '-') << std::endl;
-
-    std::string line;
-    bool foundTransactions = false;
-    while (std::getline(ifs, line)) {
-        std::stringstream ss(line);
-        std::string accNum, type, amountStr, date;
-
-        // Parse the comma-separated values
-        if (std::getline(ss, accNum, ',') &&
-            std::getline(ss, type, ',') &&
-            std::getline(ss, amountStr, ',') &&
-            std::getline(ss, date)) {
-
-            if (accNum == accountNumber) {
-                foundTransactions = true;
-                std::cout << std::setw(20) << std::left << date
-                          << std::setw(15) << std::left << type
-                          << std::setw(15) << std::left << "TK: " + amountStr << std::endl;
-            }
-        }
+              << std::setw(15) << std::left << "Amount"
+              << std::setw(15) << std::left << "Balance" << std::endl;
+    std::cout << std::string(65, '-') << std::endl;
+
+    for (const auto& row : page.rows) {
+        std::cout << std::setw(20) << std::left << formatDateTime(row.transaction.timestamp)
+                  << std::setw(15) << std::left << transactionTypeToString(row.transaction.type)
+                  << std::setw(15) << std::left << "TK: " + row.transaction.amount.toString()
+                  << std::setw(15) << std::left << "TK: " + row.balance.toString() << std::endl;
     }
 
-    if (!foundTransactions) {
+    if (page.rows.empty()) {
         std::cout << "No transactions found for this account." << std::endl;
     }
-    std::cout << std::string(50, '-') << std::endl;
-    ifs.close();
+    if (page.hasMore) {
+        std::cout << "Older transactions are on page " << query.page + 2 << "." << std::endl;
+    }
+    std::cout << std::string(65, '-') << std::endl;
+}
+
+// Function to view the transactions of every account that match a query
+void viewTransactions(const StatementQuery& query) {
+    std::vector<Transaction> rows = findTransactions(query);
+    std::cout << std::setw(20) << std::left << "Date"
+              << std::setw(15) << std::left << "Account"
+              << std::setw(15) << std::left << "Type"
+              << std::setw(15) << std::left << "Amount" << std::endl;
+    std::cout << std::string(65, '-') << std::endl;
+    for (const auto& trans : rows) {
+        std::cout << std::setw(20) << std::left << formatDateTime(trans.timestamp)
+                  << std::setw(15) << std::left << unpackAccountNumber(trans.accountKey)
+                  << std::setw(15) << std::left << transactionTypeToString(trans.type)
+                  << std::setw(15) << std::left << "TK: " + trans.amount.toString() << std::endl;
+    }
+    std::cout << std::string(65, '-') << std::endl;
+    std::cout << rows.size() << " transaction(s)." << std::endl;
+}
+
+// Function to export the whole transaction log as CSV
+bool exportTransactionLog(const std::string& csvPath) {
+    flushTransactionLog();
+    std::ofstream ofs(csvPath, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) {
+        std::cerr << "Error: Could not open " << csvPath << " for writing." << std::endl;
+        return false;
+    }
+
+    std::shared_lock<std::shared_mutex> reading = logSegments().lockForReading();
+    size_t exported = 0;
+    logSegments().forEachRow([&](const Transaction& trans) {
+        writeCsvRow(ofs, trans);
+        ++exported;
+        return true;
+    });
+    TransactionLogReader log;
+    if (log.open(LOGS_FILE)) {
+        for (const Transaction& trans : log) {
+            writeCsvRow(ofs, trans);
+            ++exported;
+        }
+    }
+    ofs.close();
+    if (!ofs) {
+        std::cerr << "Error: Could not write " << csvPath << "." << std::endl;
+        return false;
+    }
+    std::cout << "Exported " << exported << " transaction(s) to " << csvPath << "." << std::endl;
+    return true;
 }
@@ -0,0 +1,121 @@
+// src/TransactionLogReader.cpp
+#include "TransactionLogReader.h"
+#include <cstring>    // For std::memcmp
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat, stat
+#include <unistd.h>   // For close
+
+TransactionLogReader::TransactionLogReader()
+    : fd(-1), data(nullptr), mappedBytes(0), reserveBytes(0), inode(0), count(0) {}
+
+TransactionLogReader::~TransactionLogReader() {
+    close();
+}
+
+// Map the file (plus room to grow) and check its header
+bool TransactionLogReader::open(const std::string& logPath, size_t reserve) {
+    close();
+    path = logPath;
+    reserveBytes = reserve;
+    fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        close();
+        return false;
+    }
+    inode = static_cast<uint64_t>(st.st_ino);
+    size_t fileBytes = static_cast<size_t>(st.st_size);
+    if (fileBytes == 0) {
+        return true; // Created but nothing written yet; refresh() maps it once it has a header
+    }
+    if (fileBytes < sizeof(TransactionLogHeader)) {
+        close();
+        return false;
+    }
+    // Pages past the end of the file are never touched: count bounds every access
+    size_t length = fileBytes > reserve ? fileBytes : reserve;
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    data = static_cast<const char*>(mapping);
+    mappedBytes = length;
+    const TransactionLogHeader* header = reinterpret_cast<const TransactionLogHeader*>(data);
+    if (std::memcmp(header->magic, TRANSACTION_LOG_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TRANSACTION_LOG_VERSION || header->recordSize != sizeof(Transaction)) {
+        close();
+        return false;
+    }
+    count = (fileBytes - sizeof(TransactionLogHeader)) / sizeof(Transaction);
+    return true;
+}
+
+void TransactionLogReader::close() {
+    if (data) {
+        munmap(const_cast<char*>(data), mappedBytes);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    mappedBytes = 0;
+    inode = 0;
+    count = 0;
+    ranges.clear();
+}
+
+// Pick up appended records, remapping only when the mapping no longer fits the file
+bool TransactionLogReader::refresh() {
+    if (path.empty()) {
+        return false;
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        close();
+        return false;
+    }
+    size_t fileBytes = static_cast<size_t>(st.st_size);
+    if (data && static_cast<uint64_t>(st.st_ino) == inode && fileBytes <= mappedBytes) {
+        count = (fileBytes - sizeof(TransactionLogHeader)) / sizeof(Transaction);
+        return true;
+    }
+    return open(path, reserveBytes);
+}
+
+size_t TransactionLogReader::size() const {
+    return count;
+}
+
+const Transaction* TransactionLogReader::begin() const {
+    return data ? reinterpret_cast<const Transaction*>(data + sizeof(TransactionLogHeader)) : nullptr;
+}
+
+const Transaction* TransactionLogReader::end() const {
+    return data ? begin() + count : nullptr;
+}
+
+const Transaction* TransactionLogReader::at(uint64_t offset) const {
+    if (offset < sizeof(TransactionLogHeader) || (offset - sizeof(TransactionLogHeader)) % sizeof(Transaction) != 0) {
+        return nullptr;
+    }
+    uint64_t index = (offset - sizeof(TransactionLogHeader)) / sizeof(Transaction);
+    return index < count ? begin() + index : nullptr;
+}
+
+// Summarize the blocks completed since the last call; rows never change once written
+const std::vector<RowRange>& TransactionLogReader::blockRanges() {
+    if (ranges.size() > count / LOG_RANGE_ROWS) {
+        ranges.resize(count / LOG_RANGE_ROWS); // The file was cut back (a torn tail repaired)
+    }
+    for (size_t b = ranges.size(); b < count / LOG_RANGE_ROWS; ++b) {
+        RowRange range;
+        for (const Transaction* row = begin() + b * LOG_RANGE_ROWS; row != begin() + (b + 1) * LOG_RANGE_ROWS; ++row) {
+            range.include(*row);
+        }
+        ranges.push_back(range);
+    }
+    return ranges;
+}
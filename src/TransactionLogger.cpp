@@ -0,0 +1,267 @@
+// src/TransactionLogger.cpp
+#include "TransactionLogger.h"
+#include "StatementIndex.h"
+#include <cerrno>   // For errno, EINTR
+#include <cstdio>   // For std::rename
+#include <cstring>  // For std::memcmp, std::memcpy, std::memset
+#include <fcntl.h>  // For open
+#include <iostream>
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For write, pread, ftruncate, fdatasync, close
+
+TransactionLogger::TransactionLogger(const std::string& logFile, const LoggerPolicy& loggerPolicy,
+                                     StatementIndex* statementIndex)
+    : path(logFile), policy(loggerPolicy), index(statementIndex), fd(-1), fileSize(0), totalBytes(0), writeFailed(false),
+      heldRows(0), stopping(false) {
+    buffer.reserve(policy.bufferBytes);
+    pending.reserve(policy.flushEveryRecords);
+    if (policy.flushInterval.count() > 0) {
+        flusher = std::thread(&TransactionLogger::flusherLoop, this);
+    }
+}
+
+TransactionLogger::~TransactionLogger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeFlusher.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!flushLocked()) {
+        std::cerr << "Error: " << pending.size() << " transaction(s) could not be written to the logs file." << std::endl;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+// Open the log for appending and note where new rows will start
+bool TransactionLogger::openFile() {
+    if (fd >= 0) {
+        return true;
+    }
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open logs file for writing." << std::endl;
+        return false;
+    }
+    struct stat st;
+    fileSize = fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+
+    TransactionLogHeader header;
+    if (fileSize == 0) {
+        // New log: stamp the format before the first record
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TRANSACTION_LOG_MAGIC, sizeof(header.magic));
+        header.version = TRANSACTION_LOG_VERSION;
+        header.recordSize = sizeof(Transaction);
+        if (::write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+            std::cerr << "Error: Could not write to logs file." << std::endl;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        fileSize = sizeof(header);
+    } else if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+               std::memcmp(header.magic, TRANSACTION_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+               header.version != TRANSACTION_LOG_VERSION || header.recordSize != sizeof(Transaction)) {
+        std::cerr << "Error: " << path << " is not a transaction log; not appending to it." << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    } else if ((fileSize - sizeof(header)) % sizeof(Transaction) != 0) {
+        // Torn last record from a crash mid-write: drop it so records stay aligned
+        fileSize -= (fileSize - sizeof(header)) % sizeof(Transaction);
+        if (ftruncate(fd, static_cast<off_t>(fileSize)) != 0) {
+            std::cerr << "Error: Could not repair logs file." << std::endl;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+    }
+    totalBytes.store(fileSize + buffer.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// Copy a transaction record to the end of the buffer, with its index entry
+void TransactionLogger::bufferLocked(const Transaction& trans) {
+    PendingRow entry;
+    entry.accountKey = trans.accountKey;
+    entry.offset = fileSize + buffer.size();
+    entry.length = sizeof(Transaction);
+    pending.push_back(entry);
+    const char* record = reinterpret_cast<const char*>(&trans);
+    buffer.insert(buffer.end(), record, record + sizeof(Transaction));
+    totalBytes.store(fileSize + buffer.size(), std::memory_order_relaxed);
+    if (writeFailed) {
+        heldRows.store(pending.size(), std::memory_order_relaxed);
+    }
+}
+
+// Copy a transaction record into the buffer. While writes fail the row is
+// held there behind the earlier ones; the next flush retries them all.
+bool TransactionLogger::append(const Transaction& trans) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!openFile() && fileSize == 0) {
+        return false; // Never opened: there is no offset to give the row yet
+    }
+    if (writeFailed) {
+        flushLocked();
+    }
+    bufferLocked(trans);
+    if (writeFailed) {
+        return false;
+    }
+    if (pending.size() >= policy.flushEveryRecords) {
+        return flushLocked();
+    }
+    return true;
+}
+
+// Write records straight to the file, behind any buffered rows. Rows that
+// do not reach the file are held in the buffer like appended ones.
+bool TransactionLogger::appendBatch(const Transaction* rows, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!openFile() && fileSize == 0) {
+        return false;
+    }
+    size_t rowsWritten = 0;
+    if (flushLocked()) { // Otherwise hold them all, to keep the file in append order
+        uint64_t start = fileSize;
+        size_t written = writeLocked(reinterpret_cast<const char*>(rows), count * sizeof(Transaction));
+        if (policy.syncOnFlush && fd >= 0 && fdatasync(fd) != 0) {
+            std::cerr << "Error: Could not sync logs file." << std::endl;
+            writeFailed = true; // The next flush syncs again
+        }
+        fileSize += written;
+        totalBytes.store(fileSize, std::memory_order_relaxed);
+        rowsWritten = written / sizeof(Transaction);
+        // The index only ever points at rows that reached the file; if it cannot
+        // take them, it is rebuilt from the file
+        if (index && !index->addBatch(rows, rowsWritten, start)) {
+            index->rebuild();
+        }
+        if (rowsWritten < count) {
+            writeFailed = true;
+        }
+    }
+    for (size_t i = rowsWritten; i < count; ++i) {
+        bufferLocked(rows[i]);
+    }
+    return !writeFailed;
+}
+
+bool TransactionLogger::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flushLocked();
+}
+
+bool TransactionLogger::accepts(size_t count) const {
+    size_t held = heldRows.load(std::memory_order_relaxed);
+    return held == 0 || held + count <= policy.maxHeldRecords;
+}
+
+uint64_t TransactionLogger::size() const {
+    return totalBytes.load(std::memory_order_relaxed);
+}
+
+// Close the current log under a new name and start an empty one
+bool TransactionLogger::rollOver(const std::string& closedPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!flushLocked()) {
+        return false; // The buffered rows' offsets belong to this file; keep it active
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (std::rename(path.c_str(), closedPath.c_str()) != 0) {
+        std::cerr << "Error: Could not move logs file to " << closedPath << "." << std::endl;
+        openFile();
+        return false;
+    }
+    if (!openFile()) {
+        return false;
+    }
+    // Every indexed row now lives in closedPath
+    if (index) {
+        index->rebuild();
+    }
+    return true;
+}
+
+// Write data to the end of the file, retrying short writes. If the write
+// stops early, the file is cut back to the last whole record, so only whole
+// records are ever left in it.
+size_t TransactionLogger::writeLocked(const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::cerr << "Error: Could not write to logs file." << std::endl;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    size_t whole = written - written % sizeof(Transaction);
+    if (whole != written && ftruncate(fd, static_cast<off_t>(fileSize + whole)) != 0) {
+        // The torn record is still there: reopen before the next write,
+        // which drops it (see openFile)
+        std::cerr << "Error: Could not repair logs file." << std::endl;
+        ::close(fd);
+        fd = -1;
+    }
+    return whole;
+}
+
+// Write the buffer in one call, then index the rows that reached the file.
+// Rows that did not stay buffered, at the same offsets, for the next flush.
+// With syncOnFlush, a failed fdatasync also fails the flush and is retried
+// by the next one.
+bool TransactionLogger::flushLocked() {
+    if (buffer.empty() && !writeFailed) {
+        return true;
+    }
+    if (!openFile()) {
+        writeFailed = true;
+        return false;
+    }
+    size_t written = writeLocked(buffer.data(), buffer.size());
+    bool synced = !policy.syncOnFlush || fd < 0 || fdatasync(fd) == 0;
+    if (!synced) {
+        std::cerr << "Error: Could not sync logs file." << std::endl;
+    }
+    fileSize += written;
+
+    // The index only ever points at rows that reached the file
+    size_t rowsWritten = written / sizeof(Transaction);
+    if (index) {
+        for (size_t i = 0; i < rowsWritten; ++i) {
+            const PendingRow& row = pending[i];
+            if (row.accountKey != StatementIndex::NO_ENTRY) {
+                index->add(row.accountKey, row.offset, row.length);
+            }
+        }
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(written));
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(rowsWritten));
+    totalBytes.store(fileSize + buffer.size(), std::memory_order_relaxed);
+    writeFailed = !buffer.empty() || !synced;
+    heldRows.store(writeFailed ? pending.size() : 0, std::memory_order_relaxed);
+    return !writeFailed;
+}
+
+// Background thread: flush whatever is buffered every flushInterval
+void TransactionLogger::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wakeFlusher.wait_for(lock, policy.flushInterval);
+        flushLocked();
+    }
+}
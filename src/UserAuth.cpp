@@ -1,43 +1,69 @@
 
 // src/UserAuth.cpp
 #include "UserAuth.h"
-#include "Utility.h" // For clearScreen(), pressEnterToContinue()
+#include "Metrics.h"
+#include "Utility.h" // For clearScreen(), pressEnterToContinue(), parallelFor
 #include <iostream>
 #include <fstream>
-#include <algorithm> // For std::find_if
-#include <random>    // For std::mt19937, std::uniform_int_distribution
-#include <chrono>    // For std::chrono::system_clock
+#include <cstdio>    // For std::snprintf, std::remove
+#include <filesystem> // For std::filesystem::create_directories
+#include <chrono>    // For std::chrono::steady_clock
+#include <iomanip>   // For std::setprecision
 #include <limits>    // For std::numeric_limits
-#include <iomanip>   // For std::fixed, std::setprecision
+#include <mutex>     // For std::unique_lock
+#include <thread>    // For std::thread
+#include <fcntl.h>   // For open
+#include <unistd.h>  // For fsync
 
 // Initialize static members
-std::vector<Account> UserAuth::accounts;
+UserAuth::Shard UserAuth::shards[UserAuth::SHARD_COUNT];
 const std::string UserAuth::ACCOUNTS_FILE = "data/accounts.dat";
+const std::string UserAuth::SHARD_DIRECTORY = "data/accounts";
+const std::string UserAuth::JOURNAL_FILE = "data/journal.dat";
+const size_t UserAuth::JOURNAL_SYNC_GROUP = 32;
+const size_t UserAuth::CHECKPOINT_INTERVAL = 100000;
+Journal UserAuth::journal(JOURNAL_FILE, JOURNAL_SYNC_GROUP);
+const std::string UserAuth::ALLOCATOR_FILE = "data/accounts.alloc";
+AccountNumberAllocator UserAuth::numberAllocator(ALLOCATOR_FILE);
+std::atomic<size_t> UserAuth::uncheckedNumbers{0};
+const std::string UserAuth::JOB_PERIOD_FILE = "data/jobs.period";
+std::atomic<uint32_t> UserAuth::jobPeriod{0};
+bool UserAuth::jobPeriodSaved = true;
+
+// The thread writing a background checkpoint. Defined after the shards and
+// the journal, so at exit it is joined before they are destroyed.
+static struct CheckpointWriter {
+    std::mutex mutex;                 // Held while a checkpoint is started, or waited for and run
+    std::thread thread;
+    std::atomic<bool> running{false}; // The thread has not finished writing yet
+
+    void join() {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    ~CheckpointWriter() { join(); }
+} checkpointWriter;
+
+static const Histogram loadSeconds("bms_load_seconds", "Time to load the accounts file and replay the journal");
+static const Histogram saveSeconds("bms_save_seconds", "Time to write the changed shard files");
+static const Counter saveFailures("bms_save_failures_total", "Saves that failed, keeping the journal");
+static const Histogram checkpointPauseSeconds("bms_checkpoint_pause_seconds",
+                                              "Time postings waited while a checkpoint took its snapshot");
+static Gauge checkpointSnapshotBytes("bms_checkpoint_snapshot_bytes", "Memory held by the snapshot being written");
+static const Histogram lookupSeconds("bms_lookup_seconds", "Time to find an account by number", 16);
+static const Counter lookups("bms_lookups_total", "Account lookups by number");
+static const Counter lookupMisses("bms_lookup_misses_total", "Account lookups that found no account");
+static Gauge accountsInMemory("bms_accounts", "Accounts in memory");
 
 // Helper function to generate a unique 10-digit account number
 std::string UserAuth::generateAccountNumber() {
-    std::string newAccNum;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 9);
-
-    bool unique = false;
-    while (!unique) {
-        newAccNum = "";
-        for (int i = 0; i < 10; ++i) {
-            newAccNum += std::to_string(distrib(gen));
-        }
-
-        // Check if this account number already exists
-        unique = true; // Assume unique until proven otherwise
-        for (const auto& acc : accounts) {
-            if (acc.getAccountNumber() == newAccNum) {
-                unique = false;
-                break;
-            }
-        }
+    // The allocator never issues a number twice, so no probing of the index is needed
+    uint64_t key;
+    if (!numberAllocator.allocate(key)) {
+        return "";
     }
-    return newAccNum;
+    return unpackAccountNumber(key);
 }
 
 // Register a new user and create an account (updated for account type)
@@ -45,7 +71,7 @@ bool UserAuth::registerUser() {
     clearScreen();
     std::cout << "--- Register New Account ---" << std::endl;
     std::string ownerName, pin1, pin2;
-    double initialDeposit;
+    Money initialDeposit;
     int accountTypeChoice;
     AccountType selectedAccountType = AccountType::UNKNOWN;
 
@@ -106,12 +132,25 @@ bool UserAuth::registerUser() {
         break; // Exit loop if a valid choice is made
     }
 
+    // A recurring deposit's monthly installment is moved in from another account
+    uint64_t fundingKey = Account::NO_ACCOUNT_KEY;
+    while (selectedAccountType == AccountType::RECURRING_DEPOSIT) {
+        std::string fundingNumber;
+        std::cout << "Enter the account number to fund the monthly installment from: ";
+        std::cin >> fundingNumber;
+        Account* funding = findAccount(fundingNumber);
+        if (funding && funding->getAccountType() != AccountType::RECURRING_DEPOSIT &&
+            funding->getAccountType() != AccountType::LOAN) {
+            fundingKey = funding->getAccountKey();
+            break;
+        }
+        std::cout << "Account not found, or it cannot fund installments. Please try again." << std::endl;
+    }
 
     // Get initial deposit
     while (true) {
         std::cout << "Enter initial deposit amount (minimum TK: 0.01): TK. ";
-        std::cin >> initialDeposit;
-        if (std::cin.fail() || !isValidAmount(initialDeposit)) {
+        if (!readAmount(std::cin, initialDeposit) || !isValidAmount(initialDeposit)) {
             std::cin.clear(); // Clear error flags
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
             std::cout << "Invalid amount. Please enter a positive number." << std::endl;
@@ -120,16 +159,18 @@ bool UserAuth::registerUser() {
         }
     }
 
-    std::string newAccNum = generateAccountNumber();
-    // Pass the selected account type to the Account constructor
-    Account newAccount(newAccNum, pin1, initialDeposit, ownerName, selectedAccountType);
-    accounts.push_back(newAccount);
+    std::string newAccNum = createAccount(pin1, initialDeposit, ownerName, selectedAccountType, fundingKey);
+    if (newAccNum.empty()) {
+        std::cout << "\nCould not allocate an account number. Please try again later." << std::endl;
+        pressEnterToContinue();
+        return false;
+    }
     saveAccounts(); // Save the new account immediately
 
     std::cout << "\nAccount created successfully!" << std::endl;
     std::cout << "Your Account Number is: " << newAccNum << std::endl;
     std::cout << "Account Type: " << accountTypeToString(selectedAccountType) << std::endl;
-    std::cout << "Initial Balance: TK. " << std::fixed << std::setprecision(2) << initialDeposit << std::endl;
+    std::cout << "Initial Balance: TK. " << initialDeposit << std::endl;
     pressEnterToContinue();
     return true;
 }
@@ -146,15 +187,14 @@ Account* UserAuth::loginUser() {
     std::cin >> pin;
 
     // Find the account
-    auto it = std::find_if(accounts.begin(), accounts.end(),
-                           [&](const Account& acc) { return acc.getAccountNumber() == accNum; });
+    Account* it = findAccount(accNum);
 
-    if (it != accounts.end()) {
+    if (it != nullptr) {
         // Account found, now authenticate PIN
         if (it->authenticate(pin)) {
             std::cout << "\nLogin successful! Welcome, " << it->getOwnerName() << "." << std::endl;
             pressEnterToContinue();
-            return &(*it); // Return pointer to the logged-in account
+            return it; // Return pointer to the logged-in account
         } else {
             std::cout << "\nIncorrect PIN. Please try again." << std::endl;
         }
@@ -165,50 +205,529 @@ Account* UserAuth::loginUser() {
     return nullptr; // Login failed
 }
 
-// Load all accounts from the binary file
-void UserAuth::loadAccounts() {
-    std::ifstream ifs(ACCOUNTS_FILE, std::ios::binary);
-    if (!ifs.is_open()) {
-        std::cout << "No existing accounts file found. Starting with empty accounts." << std::endl;
-        return;
+// Milliseconds elapsed since start, for the load timing report
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Pick an account's shard from the top bits of its hash (the index and the
+// posting locks use the low bits, so they stay evenly spread within a shard)
+size_t UserAuth::shardOf(uint64_t key) {
+    return static_cast<size_t>(hashAccountKey(key) >> (64 - SHARD_BITS));
+}
+
+UserAuth::Shard& UserAuth::shardFor(uint64_t key) {
+    return shards[shardOf(key)];
+}
+
+// Path of one shard's accounts file, e.g. data/accounts/shard-07.dat
+std::string UserAuth::shardFilePath(size_t shard) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/shard-%02zu.dat", shard);
+    return SHARD_DIRECTORY + name;
+}
+
+// Lock every shard exclusively; shard order rules out deadlock with other callers
+std::vector<std::unique_lock<std::shared_mutex>> UserAuth::lockAllShards() {
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(SHARD_COUNT);
+    for (auto& shard : shards) {
+        locks.emplace_back(shard.mutex);
     }
+    return locks;
+}
+
+// Keep a copy of a damaged file before the next save replaces it
+static void setAside(const std::string& path, size_t kept, const std::string& what) {
+    std::error_code ec;
+    std::filesystem::copy_file(path, path + ".corrupt", std::filesystem::copy_options::overwrite_existing, ec);
+    std::string message = "Error: Accounts file " + path + " " + what + "; loaded " + std::to_string(kept) +
+                          " account(s) from it and kept a copy as " + path + ".corrupt.\n";
+    std::cerr << message; // One write, so messages from shards loading in parallel do not mix
+}
 
-    accounts.clear(); // Clear existing accounts before loading
+// Read the single accounts file written before the store was sharded, in
+// the old length-prefixed layout, sequentially up to the first bad record.
+// Returns false if it was damaged (the accounts before the damage are kept).
+bool UserAuth::readLegacyFile(std::deque<Account>& accounts) {
+    std::ifstream ifs(ACCOUNTS_FILE, std::ios::binary);
     while (ifs.peek() != EOF) { // Check for end of file
         Account acc;
-        acc.loadFromFile(ifs);
+        if (!acc.loadFromFile(ifs)) {
+            setAside(ACCOUNTS_FILE, accounts.size(), "is damaged");
+            return false;
+        }
         accounts.push_back(acc);
     }
-    ifs.close();
-    std::cout << "Accounts loaded successfully." << std::endl;
+    return true;
+}
+
+// Read one shard's file and build the shard's accounts and index from it.
+// Returns false if the file was damaged (the accounts before the damage are kept).
+bool UserAuth::loadShard(size_t shard) {
+    Shard& target = shards[shard];
+    std::string path = shardFilePath(shard);
+    if (!std::ifstream(path, std::ios::binary).is_open()) {
+        return true; // No account has been saved to this shard yet
+    }
+    AccountFile file;
+    bool intact = file.open(path);
+    if (!intact) {
+        setAside(path, 0, "is damaged or was written by a newer version");
+    } else if (file.readAccounts(target.accounts) < file.recordCount() || !file.checksumMatches()) {
+        intact = false;
+        setAside(path, target.accounts.size(), "is damaged");
+    }
+    target.index.build(target.accounts);
+    // Damaged files are rewritten by the save that follows the load
+    target.dirty = !intact;
+    return intact;
+}
+
+// Load all accounts from the shard files (or split the old single file into them)
+void UserAuth::loadAccounts() {
+    ScopedTimer timer(loadSeconds);
+    std::lock_guard<std::mutex> exclusive(checkpointWriter.mutex); // No checkpoint may write the old accounts
+    checkpointWriter.join();
+    auto locks = lockAllShards();
+    auto phaseStart = std::chrono::steady_clock::now();
+    double shardsMs = 0.0, journalMs = 0.0;
+    loadJobPeriod();
+    std::error_code ec;
+    bool legacyFile = std::ifstream(ACCOUNTS_FILE, std::ios::binary).is_open();
+    if (!legacyFile && !std::filesystem::is_directory(SHARD_DIRECTORY, ec)) {
+        std::cout << "No existing accounts file found. Starting with empty accounts." << std::endl;
+        return;
+    }
+
+    // Clear existing accounts before loading
+    for (auto& shard : shards) {
+        shard.accounts.clear();
+        shard.index.clear();
+        shard.dirty = false;
+    }
+    uncheckedNumbers = 0;
+    // A damaged file never stops the load: the accounts before the damage
+    // are kept, a copy of the file is set aside, and the save below writes
+    // a clean file in its place
+    if (legacyFile) {
+        // The single file wins over any shard files: a split interrupted
+        // before the old file was removed is simply done again
+        std::deque<Account> all;
+        readLegacyFile(all);
+        for (const auto& acc : all) {
+            shardFor(acc.getAccountKey()).accounts.push_back(acc);
+        }
+        parallelFor(SHARD_COUNT, 1, [](size_t first, size_t last) {
+            for (size_t s = first; s < last; ++s) {
+                shards[s].index.build(shards[s].accounts);
+                shards[s].dirty = true; // Every shard file has to be written
+            }
+        });
+    } else {
+        // Each shard maps its own file and builds its own index, in parallel
+        parallelFor(SHARD_COUNT, 1, [](size_t first, size_t last) {
+            for (size_t s = first; s < last; ++s) {
+                loadShard(s);
+            }
+        });
+    }
+    parallelFor(SHARD_COUNT, 1, [](size_t first, size_t last) {
+        for (size_t s = first; s < last; ++s) {
+            size_t unchecked = 0;
+            for (const auto& acc : shards[s].accounts) {
+                unchecked += !AccountNumberAllocator::hasValidCheckDigit(acc.getAccountKey());
+            }
+            uncheckedNumbers += unchecked;
+        }
+    });
+    shardsMs = millisecondsSince(phaseStart);
+    phaseStart = std::chrono::steady_clock::now();
+
+    // Re-apply balance changes made since the shard files were last saved
+    size_t replayed = journal.replay([](const JournalRecord& rec) {
+        if (rec.accountKey == JOURNAL_PERIOD_KEY) {
+            uint32_t period = static_cast<uint32_t>(rec.newBalance.toPaisa());
+            if (period > jobPeriod) {
+                jobPeriod = period;
+                jobPeriodSaved = false; // Saved below, before the journal is emptied
+            }
+            return;
+        }
+        Shard& shard = shardFor(rec.accountKey);
+        size_t position;
+        if (shard.index.findPosition(rec.accountKey, position)) {
+            shard.accounts[position].setBalance(rec.newBalance);
+            shard.dirty = true;
+        }
+    });
+    journalMs = millisecondsSince(phaseStart);
+    size_t total = 0;
+    bool upgrade = !jobPeriodSaved;
+    for (const auto& shard : shards) {
+        total += shard.accounts.size();
+        upgrade = upgrade || shard.dirty;
+    }
+    accountsInMemory.set(static_cast<int64_t>(total));
+    std::cout << std::fixed << std::setprecision(1)
+              << "Accounts loaded successfully: " << total << " account(s) in "
+              << shardsMs + journalMs << " ms (" << SHARD_COUNT << " shards " << shardsMs
+              << ", journal " << journalMs << ")." << std::defaultfloat << std::endl;
+    if (replayed > 0) {
+        std::cout << "Recovered " << replayed << " journaled transaction(s)." << std::endl;
+    }
+
+    if (upgrade && saveAccountsLocked() && legacyFile) { // Fold recovered changes in and upgrade old file formats
+        std::remove(ACCOUNTS_FILE.c_str());
+        std::cout << "Accounts file split into " << SHARD_COUNT << " shard files." << std::endl;
+    }
 }
 
-// Save all accounts to the binary file
+// Save all accounts to the shard files
 void UserAuth::saveAccounts() {
-    std::ofstream ofs(ACCOUNTS_FILE, std::ios::binary | std::ios::trunc); // trunc to overwrite
-    if (!ofs.is_open()) {
-        std::cerr << "Error: Could not open accounts file for writing." << std::endl;
+    if (checkpoint()) {
+        std::cout << "Accounts saved successfully." << std::endl;
+    }
+}
+
+// Save all accounts without reporting success on the console
+bool UserAuth::checkpoint() {
+    std::lock_guard<std::mutex> exclusive(checkpointWriter.mutex); // No background checkpoint starts meanwhile
+    checkpointWriter.join(); // Its shard files must not land over the ones saved here
+    auto locks = lockAllShards(); // Waits for in-flight postings
+    return saveAccountsLocked();
+}
+
+// Start a background checkpoint once enough postings have been journaled since the last one
+void UserAuth::checkpointIfDue() {
+    if (journal.size() >= CHECKPOINT_INTERVAL) {
+        checkpointInBackground();
+    }
+}
+
+// Snapshot the changed shards and write them on a background thread
+bool UserAuth::checkpointInBackground() {
+    std::unique_lock<std::mutex> starting(checkpointWriter.mutex, std::try_to_lock);
+    if (!starting.owns_lock() || checkpointWriter.running.load()) {
+        return false; // Another thread is starting one, or the last one is still writing
+    }
+    checkpointWriter.join(); // Finished; only needs reaping
+
+    std::vector<ShardSnapshot> snapshots;
+    {
+        ScopedTimer pause(checkpointPauseSeconds);
+        auto locks = lockAllShards(); // Waits for in-flight postings; new ones wait for the snapshot
+        if (!saveJobPeriodLocked()) {
+            return false; // The rotated journal would be the only record of the period
+        }
+        if (!journal.rotate()) {
+            // The rotated journal of a checkpoint that failed is still there:
+            // save everything now, which also empties both journal files
+            return saveAccountsLocked();
+        }
+        snapshots = captureLocked(); // Exactly the postings in the rotated journal
+    }
+
+    checkpointWriter.running = true;
+    checkpointWriter.thread = std::thread([snapshots = std::move(snapshots)]() mutable {
+        journal.syncRotated(); // The shard files must not get ahead of the journal they replace
+        if (writeSnapshots(snapshots)) {
+            journal.discardRotated();
+        }
+        snapshots.clear();
+        checkpointSnapshotBytes.set(0);
+        checkpointWriter.running = false;
+    });
+    return true;
+}
+
+// Wait until a background checkpoint has finished
+void UserAuth::waitForCheckpoint() {
+    std::lock_guard<std::mutex> waiting(checkpointWriter.mutex);
+    checkpointWriter.join();
+}
+
+// Save the changed shards and empty the journal; the caller holds every shard exclusively
+bool UserAuth::saveAccountsLocked() {
+    std::vector<ShardSnapshot> snapshots = captureLocked();
+    bool saved = writeSnapshots(snapshots);
+    checkpointSnapshotBytes.set(0);
+    if (!saved || !saveJobPeriodLocked()) {
+        return false; // Keep the journal: it still covers the shards that failed
+    }
+    journal.reset(); // Every journaled change is now folded into the shard files
+    return true;
+}
+
+// Snapshot every changed shard and mark it clean; the caller holds every shard exclusively
+std::vector<UserAuth::ShardSnapshot> UserAuth::captureLocked() {
+    std::vector<ShardSnapshot> snapshots;
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        if (shards[s].dirty) {
+            snapshots.emplace_back();
+            snapshots.back().shard = s;
+            shards[s].dirty = false; // Later postings belong to the next checkpoint
+        }
+    }
+    parallelFor(snapshots.size(), 1, [&snapshots](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            snapshots[i].accounts.capture(shards[snapshots[i].shard].accounts);
+        }
+    });
+    size_t bytes = 0;
+    for (const auto& snapshot : snapshots) {
+        bytes += snapshot.accounts.bytes();
+    }
+    checkpointSnapshotBytes.set(static_cast<int64_t>(bytes));
+    return snapshots;
+}
+
+// Write snapshots to their shard files in parallel. A shard that could not
+// be written is marked changed again, so the next checkpoint retries it.
+bool UserAuth::writeSnapshots(std::vector<ShardSnapshot>& snapshots) {
+    ScopedTimer timer(saveSeconds);
+    std::error_code ec;
+    std::filesystem::create_directories(SHARD_DIRECTORY, ec);
+    std::vector<char> saved(snapshots.size()); // Not vector<bool>: written from several threads
+    parallelFor(snapshots.size(), 1, [&snapshots, &saved](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            saved[i] = AccountFile::write(shardFilePath(snapshots[i].shard), snapshots[i].accounts);
+        }
+    });
+    bool ok = true;
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        if (!saved[i]) {
+            std::cerr << "Error: Could not write accounts file " << shardFilePath(snapshots[i].shard)
+                      << "; keeping journal." << std::endl;
+            shards[snapshots[i].shard].dirty = true;
+            ok = false;
+        }
+    }
+    if (!ok) {
+        saveFailures.add();
+    }
+    return ok;
+}
+
+// Read the last applied job period; a missing file means none yet
+void UserAuth::loadJobPeriod() {
+    jobPeriod = 0;
+    jobPeriodSaved = true;
+    std::FILE* f = std::fopen(JOB_PERIOD_FILE.c_str(), "r");
+    if (!f) {
+        return;
+    }
+    unsigned year = 0, month = 0;
+    bool ok = std::fscanf(f, "%4u-%2u", &year, &month) == 2 && month >= 1 && month <= 12;
+    std::fclose(f);
+    if (!ok) {
+        // Starting over could apply a period twice, so refuse every period instead
+        std::cerr << "Error: Job period file " << JOB_PERIOD_FILE
+                  << " is damaged; month-end jobs are refused until it is fixed." << std::endl;
+        jobPeriod = std::numeric_limits<uint32_t>::max();
         return;
     }
+    jobPeriod = year * 100 + month;
+}
+
+// Write the job period through a temporary file, so a crash leaves the old or the new one
+bool UserAuth::saveJobPeriodLocked() {
+    if (jobPeriodSaved) {
+        return true;
+    }
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04u-%02u\n", jobPeriod / 100, jobPeriod % 100);
+    std::string tempPath = JOB_PERIOD_FILE + ".tmp";
+    std::FILE* f = std::fopen(tempPath.c_str(), "w");
+    bool ok = f && std::fputs(text, f) >= 0 && std::fflush(f) == 0;
+    if (f) {
+        fsync(fileno(f));
+        ok = std::fclose(f) == 0 && ok;
+    }
+    if (!ok || std::rename(tempPath.c_str(), JOB_PERIOD_FILE.c_str()) != 0) {
+        std::cerr << "Error: Could not write " << JOB_PERIOD_FILE << "; keeping journal." << std::endl;
+        return false;
+    }
+    int dir = ::open(std::filesystem::path(JOB_PERIOD_FILE).parent_path().c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+    jobPeriodSaved = true;
+    return true;
+}
 
-    for (const auto& acc : accounts) {
-        acc.saveToFile(ofs);
+// Note a period whose marker has just been journaled, and save it
+void UserAuth::recordJobPeriod(uint32_t period) {
+    jobPeriod = period;
+    jobPeriodSaved = false;
+    saveJobPeriodLocked(); // On failure the journal still holds the marker, and later saves retry
+}
+
+// Last period the month-end jobs were applied for
+uint32_t UserAuth::lastJobPeriod() {
+    return jobPeriod;
+}
+
+// Persist balance changes by appending them to the journal as one group
+bool UserAuth::recordPostings(JournalRecord* records, size_t count, bool syncNow) {
+    if (!journal.appendGroup(records, count, syncNow)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].accountKey == JOURNAL_PERIOD_KEY) {
+            continue;
+        }
+        Shard& shard = shardFor(records[i].accountKey);
+        if (!shard.dirty.load(std::memory_order_relaxed)) { // Read first: the flag is shared by every posting
+            shard.dirty.store(true, std::memory_order_relaxed);
+        }
     }
-    ofs.close();
-    std::cout << "Accounts saved successfully." << std::endl;
+    return true;
+}
+
+// Accept a number with a valid check digit, or any number while unchecked ones exist
+bool UserAuth::acceptsAccountNumber(uint64_t key) {
+    return uncheckedNumbers.load(std::memory_order_relaxed) > 0 || AccountNumberAllocator::hasValidCheckDigit(key);
 }
 
 // Find an account by account number
 Account* UserAuth::findAccount(const std::string& accNum) {
-    auto it = std::find_if(accounts.begin(), accounts.end(),
-                           [&](const Account& acc) { return acc.getAccountNumber() == accNum; });
-    if (it != accounts.end()) {
-        return &(*it);
+    uint64_t key;
+    if (!packAccountNumber(accNum, key) || !acceptsAccountNumber(key)) {
+        return nullptr; // Not a well-formed account number, or a mistyped one
+    }
+    ScopedTimer timer(lookupSeconds);
+    lookups.add();
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    Account* account = shard.index.find(key);
+    if (!account) {
+        lookupMisses.add();
+    }
+    return account;
+}
+
+// Add an account to the store and index
+Account* UserAuth::addAccount(const Account& account) {
+    uint64_t key = account.getAccountKey();
+    if (key == Account::NO_ACCOUNT_KEY) {
+        return nullptr;
+    }
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex); // Only this shard waits
+    if (shard.index.contains(key)) {
+        return nullptr;
+    }
+    shard.accounts.push_back(account);
+    shard.index.insert(key, &shard.accounts.back(), shard.accounts.size() - 1);
+    shard.dirty = true;
+    accountsInMemory.add(1);
+    if (!AccountNumberAllocator::hasValidCheckDigit(key)) {
+        ++uncheckedNumbers; // Imported with its own number
     }
-    return nullptr;
+    return &shard.accounts.back();
 }
 
-// Get a reference to the accounts vector
-std::vector<Account>& UserAuth::getAccounts() {
-    return accounts;
+// Create an account under a newly generated account number
+std::string UserAuth::createAccount(const std::string& pin, Money initialDeposit,
+                                    const std::string& ownerName, AccountType type, uint64_t fundingKey) {
+    // Hash the PIN once, whatever number the account ends up with
+    return createAccount(PinHash::hash(pin), initialDeposit, ownerName, type, fundingKey);
+}
+
+// Create an account with an already hashed PIN under a newly generated account number
+std::string UserAuth::createAccount(const PinCredential& credential, Money initialDeposit,
+                                    const std::string& ownerName, AccountType type, uint64_t fundingKey) {
+    // Issued numbers are unique, but an account imported with an explicit
+    // number (batch register lines, older files) may already hold one; skip it
+    std::string newAccNum;
+    Account account;
+    do {
+        newAccNum = generateAccountNumber();
+        if (newAccNum.empty()) {
+            return newAccNum;
+        }
+        account = Account(newAccNum, credential, initialDeposit, ownerName, type);
+        account.setFundingAccountKey(fundingKey);
+    } while (!addAccount(account));
+    return newAccNum;
+}
+
+// Write the shard files that hold new accounts, and drop the accounts of any shard that failed
+bool UserAuth::saveNewAccounts(const std::vector<uint64_t>& keys, std::vector<bool>& saved) {
+    std::lock_guard<std::mutex> exclusive(checkpointWriter.mutex); // No background checkpoint starts meanwhile
+    checkpointWriter.join(); // Its older copy of a shard must not land over the one saved here
+    auto locks = lockAllShards();
+    bool touched[SHARD_COUNT] = {};
+    for (uint64_t key : keys) {
+        touched[shardOf(key)] = true;
+    }
+    // Every journaled balance of a shard is in memory, so its rewritten file
+    // holds them all; the journal is only emptied by a full checkpoint
+    std::vector<ShardSnapshot> snapshots;
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        if (touched[s]) {
+            snapshots.emplace_back();
+            snapshots.back().shard = s;
+            snapshots.back().accounts.capture(shards[s].accounts);
+            shards[s].dirty = false;
+        }
+    }
+    bool ok = writeSnapshots(snapshots);
+    checkpointSnapshotBytes.set(0);
+    bool failed[SHARD_COUNT] = {};
+    for (const auto& snapshot : snapshots) {
+        failed[snapshot.shard] = shards[snapshot.shard].dirty; // writeSnapshots marks a failed shard changed again
+    }
+
+    saved.assign(keys.size(), true);
+    size_t removed[SHARD_COUNT] = {};
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (failed[shardOf(keys[i])]) {
+            saved[i] = false;
+            ++removed[shardOf(keys[i])];
+        }
+    }
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        if (removed[s] == 0) {
+            continue;
+        }
+        // The new accounts are the last ones of the shard; nothing else can
+        // point at them yet, so they can go
+        for (size_t i = shards[s].accounts.size() - removed[s]; i < shards[s].accounts.size(); ++i) {
+            if (!AccountNumberAllocator::hasValidCheckDigit(shards[s].accounts[i].getAccountKey())) {
+                --uncheckedNumbers;
+            }
+        }
+        shards[s].accounts.resize(shards[s].accounts.size() - removed[s]);
+        shards[s].index.build(shards[s].accounts);
+        accountsInMemory.add(-static_cast<int64_t>(removed[s]));
+    }
+    return ok;
+}
+
+// Reserve allocator numbers for a bulk registration
+bool UserAuth::reserveAccountNumbers(size_t count) {
+    return numberAllocator.reserve(count);
+}
+
+// Run reader over every shard's accounts while holding all shards exclusively
+void UserAuth::snapshotAccounts(const std::function<void(const std::vector<const std::deque<Account>*>&)>& reader) {
+    auto locks = lockAllShards(); // Waits for in-flight postings
+    std::vector<const std::deque<Account>*> parts;
+    for (const auto& shard : shards) {
+        parts.push_back(&shard.accounts);
+    }
+    reader(parts);
+}
+
+// Count the accounts in every shard
+size_t UserAuth::accountCount() {
+    size_t total = 0;
+    for (auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        total += shard.accounts.size();
+    }
+    return total;
 }
@@ -1,38 +1,159 @@
 // src/Utility.cpp
 #include "Utility.h"
 #include <chrono>   // For std::chrono::system_clock, std::chrono::duration_cast
-#include <ctime>    // For std::time_t, std::localtime, std::mktime, std::strftime
-#include <iomanip>  // For std::put_time
+#include <ctime>    // For std::time_t, localtime_r, std::mktime
+#include <cstring>  // For std::memcpy
+#include <algorithm> // For std::min, std::max
+#include <thread>   // For std::thread
+#include <vector>
 
-// Function to get the current date as a string in YYYY-MM-DD format
+// Function to get the current time in seconds since the epoch
+int64_t currentTimestamp() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+}
+
+// Write value as two ASCII digits
+static void putTwoDigits(char* out, int value) {
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+// Function to format epoch seconds as local time, re-rendering only when the minute changes
+void formatTimestamp(int64_t epochSeconds, char* out) {
+    // Local minutes start on whole-minute UTC offsets, so within the cached
+    // minute only the seconds digits differ
+    thread_local bool cached = false;
+    thread_local int64_t minuteStart = 0;
+    thread_local char text[TIMESTAMP_TEXT_LENGTH];
+    int64_t second = epochSeconds - minuteStart;
+    if (!cached || second < 0 || second >= 60) {
+        std::time_t time = static_cast<std::time_t>(epochSeconds);
+        std::tm localTime;
+        localtime_r(&time, &localTime); // Unlike std::localtime, safe to call from several threads
+        int year = localTime.tm_year + 1900;
+        text[0] = static_cast<char>('0' + year / 1000 % 10);
+        text[1] = static_cast<char>('0' + year / 100 % 10);
+        putTwoDigits(text + 2, year % 100);
+        text[4] = '-';
+        putTwoDigits(text + 5, localTime.tm_mon + 1);
+        text[7] = '-';
+        putTwoDigits(text + 8, localTime.tm_mday);
+        text[10] = ' ';
+        putTwoDigits(text + 11, localTime.tm_hour);
+        text[13] = ':';
+        putTwoDigits(text + 14, localTime.tm_min);
+        text[16] = ':';
+        second = localTime.tm_sec < 60 ? localTime.tm_sec : 59; // Leap second
+        minuteStart = epochSeconds - second;
+        cached = true;
+    }
+    putTwoDigits(text + 17, static_cast<int>(second));
+    std::memcpy(out, text, TIMESTAMP_TEXT_LENGTH);
+}
+
+// Function to get the current date as a string in YYYY-MM-DD HH:MM:SS format
 std::string getCurrentDate() {
-    // Get the current time point
-    auto now = std::chrono::system_clock::now();
-    // Convert to time_t
-    std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
-    // Convert to tm structure (local time)
-    std::tm* localTime = std::localtime(&currentTime);
+    return formatDateTime(currentTimestamp());
+}
 
-    // Format the time into a string
-    std::ostringstream oss;
-    oss << std::put_time(localTime, "%Y-%m-%d %H:%M:%S"); // Include time for more detail
-    return oss.str();
+// Function to convert a local date and time to epoch seconds
+bool parseDateTime(std::string_view text, int64_t& epochSeconds) {
+    // Fixed layout: digits at every position except the separators
+    if (text.size() != 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+    int fields[6];
+    const size_t starts[6] = {0, 5, 8, 11, 14, 17};
+    const size_t widths[6] = {4, 2, 2, 2, 2, 2};
+    for (size_t f = 0; f < 6; ++f) {
+        int value = 0;
+        for (size_t i = starts[f]; i < starts[f] + widths[f]; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                return false;
+            }
+            value = value * 10 + (text[i] - '0');
+        }
+        fields[f] = value;
+    }
+
+    // mktime is slow, so remember the start of the last hour converted;
+    // consecutive log rows almost always share it
+    thread_local char cachedHour[13] = {};
+    thread_local int64_t cachedHourStart = 0;
+    if (text.compare(0, 13, std::string_view(cachedHour, 13)) != 0) {
+        std::tm tm = {};
+        tm.tm_year = fields[0] - 1900;
+        tm.tm_mon = fields[1] - 1;
+        tm.tm_mday = fields[2];
+        tm.tm_hour = fields[3];
+        tm.tm_isdst = -1; // Let the C library decide whether daylight saving applies
+        std::time_t start = std::mktime(&tm);
+        if (start == static_cast<std::time_t>(-1)) {
+            return false;
+        }
+        cachedHourStart = static_cast<int64_t>(start);
+        text.copy(cachedHour, 13);
+    }
+    epochSeconds = cachedHourStart + fields[4] * 60 + fields[5];
+    return true;
+}
+
+// Function to format epoch seconds as a local date and time
+std::string formatDateTime(int64_t epochSeconds) {
+    char text[TIMESTAMP_TEXT_LENGTH];
+    formatTimestamp(epochSeconds, text);
+    return std::string(text, TIMESTAMP_TEXT_LENGTH);
+}
+
+// Function to run body over [0, count) split across threads
+void parallelFor(size_t count, size_t minPerThread, const std::function<void(size_t, size_t)>& body) {
+    // Set while a thread runs a range, so that nested calls (such as a shard
+    // load that builds an index) stay on that thread instead of multiplying threads
+    thread_local bool insideRange = false;
+    size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t threads = std::min(hardware, std::max<size_t>(1, count / std::max<size_t>(1, minPerThread)));
+    if (threads <= 1 || insideRange) {
+        body(0, count);
+        return;
+    }
+    auto runRange = [&body](size_t begin, size_t end) {
+        insideRange = true;
+        body(begin, end);
+        insideRange = false;
+    };
+    std::vector<std::thread> workers;
+    size_t chunk = (count + threads - 1) / threads;
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        workers.emplace_back(runRange, begin, std::min(count, begin + chunk));
+    }
+    runRange(0, std::min(count, chunk)); // The calling thread takes the first range
+    for (auto& worker : workers) {
+        worker.join();
+    }
 }
 
 // Function to validate if an amount is positive
-bool isValidAmount(double amount) {
-    return amount > 0;
+bool isValidAmount(Money amount) {
+    return amount > Money();
+}
+
+// Function to read an amount typed by the user
+bool readAmount(std::istream& is, Money& amount) {
+    std::string text;
+    if (!(is >> text)) {
+        return false;
+    }
+    if (!Money::parse(text, amount)) {
+        is.setstate(std::ios::failbit);
+        return false;
+    }
+    return true;
 }
 
 // Function to clear the console screen
-// This is platform-dependent. For Windows, use "cls". For Unix/Linux/macOS, use "clear".
 void clearScreen() {
-#ifdef _WIN32
-    system("cls");
-#else
-    // Assume POSIX-like system
     system("clear");
-#endif
 }
 
 // Function to pause execution until user presses Enter
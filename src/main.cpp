@@ -3,25 +3,80 @@
 #include "UserAuth.h"
 #include "Transaction.h"
 #include "Utility.h"
+#include "PostingEngine.h"
+#include "BatchProcessor.h"
+#include "JobEngine.h"
+#include "Analytics.h"
+#include "Metrics.h"
+#include "PinHash.h"
+#include "RequestServer.h"
+#include <csignal>  // For sigaction, SIGINT, SIGTERM, SIGPIPE
+#include <cstdlib>  // For std::strtoull, std::getenv
+#include <cstring>  // For std::strcmp
 #include <iostream>
 #include <limits>   // Required for std::numeric_limits
-#include <iomanip>  // Required for std::fixed and std::setprecision
+#include <thread>   // For std::thread
 
 // Function prototypes for menu options
 void displayMainMenu();
 void displayAccountMenu(Account* loggedInAccount);
+int runBatchMode(int argc, char* argv[]);
+int runReportMode(int argc, char* argv[]);
+int runExportMode(int argc, char* argv[]);
+int runMonthEndMode(int argc, char* argv[]);
+int runQueryMode(int argc, char* argv[]);
+int runServeMode(int argc, char* argv[]);
+void printUsage(const char* program);
+
+int main(int argc, char* argv[]) {
+    // BMS_METRICS_FILE names a file to dump metrics to at exit and on SIGUSR1
+    // (JSON if it ends in .json, Prometheus text otherwise). Set up before any
+    // thread starts, so every thread inherits the signal mask.
+    const char* metricsFile = std::getenv("BMS_METRICS_FILE");
+    if (metricsFile && *metricsFile) {
+        Metrics::enableDump(metricsFile);
+    }
+    // BMS_PIN_ITERATIONS sets the KDF cost of PINs hashed from now on
+    const char* pinIterations = std::getenv("BMS_PIN_ITERATIONS");
+    if (pinIterations && *pinIterations) {
+        PinHash::setIterations(static_cast<uint32_t>(std::strtoull(pinIterations, nullptr, 10)));
+    }
+
+    // In service mode stdout may carry the responses, so console messages go to stderr
+    if (argc > 1 && std::strcmp(argv[1], "--serve") == 0) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
 
-int main() {
     // Ensure the data directory exists
     // This is a simple check; a more robust solution might use boost::filesystem or C++17 std::filesystem
-#ifdef _WIN32
-    system("mkdir data >nul 2>&1"); // Create data directory quietly on Windows
-#else
-    system("mkdir -p data >/dev/null 2>&1"); // Create data directory 
-#endif
+    system("mkdir -p data >/dev/null 2>&1"); // Create data directory
 
-    // Load existing accounts when the program starts
+    // Load existing accounts when the program starts, while the transaction
+    // log's statement index is caught up on another thread
+    std::thread logLoader(openTransactionLog);
     UserAuth::loadAccounts();
+    logLoader.join();
+
+    // Non-interactive modes: process an operations file, print a report, export or query
+    // the log, run the month-end jobs or serve clients, then exit
+    if (argc > 1) {
+        if (std::strcmp(argv[1], "--report") == 0) {
+            return runReportMode(argc, argv);
+        }
+        if (std::strcmp(argv[1], "--export-log") == 0) {
+            return runExportMode(argc, argv);
+        }
+        if (std::strcmp(argv[1], "--month-end") == 0) {
+            return runMonthEndMode(argc, argv);
+        }
+        if (std::strcmp(argv[1], "--query") == 0) {
+            return runQueryMode(argc, argv);
+        }
+        if (std::strcmp(argv[1], "--serve") == 0) {
+            return runServeMode(argc, argv);
+        }
+        return runBatchMode(argc, argv);
+    }
 
     Account* currentLoggedInAccount = nullptr; // Pointer to the currently logged-in account
 
@@ -69,6 +124,206 @@ int main() {
     return 0;
 }
 
+// Handles "--batch <input> [--results <file>] [--batch-size <n>]"
+int runBatchMode(int argc, char* argv[]) {
+    BatchOptions options;
+    bool valid = argc >= 3 && std::strcmp(argv[1], "--batch") == 0;
+    if (valid) {
+        options.inputPath = argv[2];
+    }
+    for (int i = 3; valid && i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            valid = false;
+        } else if (std::strcmp(argv[i], "--results") == 0) {
+            options.resultsPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--batch-size") == 0) {
+            options.batchSize = std::strtoull(argv[i + 1], nullptr, 10);
+            valid = options.batchSize > 0;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    BatchSummary summary;
+    bool ok = BatchProcessor::run(options, summary);
+    if (summary.lines > 0) {
+        BatchProcessor::printSummary(summary);
+    }
+    // Fold the run's journal into the accounts file, as the interactive exit does
+    if (!UserAuth::checkpoint()) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+// Handles "--report [--below <amount>]"
+int runReportMode(int argc, char* argv[]) {
+    Money threshold = Money::fromPaisa(500 * 100); // Default: accounts under TK. 500
+    if (argc == 4 && std::strcmp(argv[2], "--below") == 0) {
+        if (!Money::parse(argv[3], threshold)) {
+            printUsage(argv[0]);
+            return 2;
+        }
+    } else if (argc != 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    BalanceColumns columns;
+    columns.captureStore();
+    Analytics::printReport(columns, threshold);
+    return 0;
+}
+
+// Handles "--export-log <output.csv>"
+int runExportMode(int argc, char* argv[]) {
+    if (argc != 3) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    return exportTransactionLog(argv[2]) ? 0 : 1;
+}
+
+// Handles "--month-end [YYYY-MM]"; the period defaults to the current month
+int runMonthEndMode(int argc, char* argv[]) {
+    uint32_t period = 0;
+    std::string text = argc > 2 ? std::string(argv[2]) : formatDateTime(currentTimestamp()).substr(0, 7);
+    if (argc > 3 || !JobEngine::parsePeriod(text, period)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    JobSummary summary;
+    bool ok = JobEngine::run(JobEngine::monthEndRules(), period, summary);
+    JobEngine::printSummary(summary);
+    // Fold the run's journal into the accounts file, as the interactive exit does
+    if (!UserAuth::checkpoint()) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+// Handles "--query [--account <number>] [--from <date>] [--to <date>] [--type <type>]...
+// [--min <amount>] [--max <amount>] [--rows <n>] [--page <n>]"
+int runQueryMode(int argc, char* argv[]) {
+    StatementQuery query;
+    std::string account;
+    bool valid = true;
+    for (int i = 2; valid && i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            valid = false;
+        } else if (std::strcmp(argv[i], "--account") == 0) {
+            account = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--from") == 0) {
+            query.fromDate = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--to") == 0) {
+            query.toDate = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--type") == 0) {
+            TransactionType type = stringToTransactionType(argv[i + 1]);
+            query.types |= transactionTypeBit(type);
+            valid = type != TransactionType::UNKNOWN;
+        } else if (std::strcmp(argv[i], "--min") == 0) {
+            valid = Money::parse(argv[i + 1], query.minAmount);
+        } else if (std::strcmp(argv[i], "--max") == 0) {
+            valid = Money::parse(argv[i + 1], query.maxAmount);
+        } else if (std::strcmp(argv[i], "--rows") == 0) {
+            query.pageSize = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--page") == 0) {
+            query.page = std::strtoull(argv[i + 1], nullptr, 10);
+        } else {
+            valid = false;
+        }
+    }
+    RowFilter filter;
+    if (!valid || !compileQuery(account, query, filter)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    // One account: its statement with running balances; otherwise every account's rows
+    if (!account.empty()) {
+        viewAccountStatement(account, query);
+    } else {
+        viewTransactions(query);
+    }
+    return 0;
+}
+
+// The server run by --serve, stopped by SIGINT and SIGTERM
+static RequestServer* activeServer = nullptr;
+
+static void stopActiveServer(int) {
+    if (activeServer) {
+        activeServer->stop();
+    }
+}
+
+// Handles "--serve [--socket <path>] [--workers <n>] [--pipeline <n>]"
+int runServeMode(int argc, char* argv[]) {
+    ServerOptions options;
+    bool valid = true;
+    for (int i = 2; valid && i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            valid = false;
+        } else if (std::strcmp(argv[i], "--socket") == 0) {
+            options.socketPath = argv[i + 1];
+            valid = !options.socketPath.empty();
+        } else if (std::strcmp(argv[i], "--workers") == 0) {
+            options.workers = std::strtoull(argv[i + 1], nullptr, 10);
+            valid = options.workers > 0;
+        } else if (std::strcmp(argv[i], "--pipeline") == 0) {
+            options.maxPipeline = std::strtoull(argv[i + 1], nullptr, 10);
+            valid = options.maxPipeline > 0;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    RequestServer server(options);
+    activeServer = &server;
+    struct sigaction action = {};
+    action.sa_handler = stopActiveServer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN); // A client that went away is noticed by the failed write
+
+    bool ok = server.run();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    activeServer = nullptr;
+    // Fold the session's journal into the accounts files, as the interactive exit does
+    if (!UserAuth::checkpoint()) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+// Prints the command-line options
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--batch <input.csv> [--results <file>] [--batch-size <n>]]" << std::endl;
+    std::cerr << "       " << program << " --report [--below <amount>]" << std::endl;
+    std::cerr << "       " << program << " --export-log <output.csv>" << std::endl;
+    std::cerr << "       " << program << " --month-end [YYYY-MM]   (interest and loan EMIs, once per month)" << std::endl;
+    std::cerr << "       " << program << " --query [--account <number>] [--from <date>] [--to <date>] [--type <type>]..."
+              << std::endl;
+    std::cerr << "         [--min <amount>] [--max <amount>] [--rows <n>] [--page <n>]" << std::endl;
+    std::cerr << "         (dates \"YYYY-MM-DD\" or \"YYYY-MM-DD HH:MM:SS\"; types Deposit, Withdrawal, \"Transfer In\","
+              << " \"Transfer Out\")" << std::endl;
+    std::cerr << "       " << program << " --serve [--socket <path>] [--workers <n>] [--pipeline <n>]"
+              << "   (stdin/stdout without --socket)" << std::endl;
+    std::cerr << "Set BMS_METRICS_FILE=<file> to write metrics there at exit and on SIGUSR1." << std::endl;
+    std::cerr << "Set BMS_PIN_ITERATIONS=<n> to change the PIN hashing cost (default "
+              << PinHash::DEFAULT_ITERATIONS << ")." << std::endl;
+}
+
 // Displays the main menu options
 void displayMainMenu() {
     std::cout << "--- Bank Management System ---" << std::endl;
@@ -108,44 +363,40 @@ void displayAccountMenu(Account* loggedInAccount) {
             continue;
         }
 
-        double amount;
-        Transaction trans;
+        Money amount;
+        Money balance; // After the posting
+        PostingResult result;
 
         switch (choice) {
             case 1: // Deposit
                 std::cout << "Enter amount to deposit: TK. ";
-                std::cin >> amount;
-                if (std::cin.fail() || !isValidAmount(amount)) {
+                if (!readAmount(std::cin, amount) || !isValidAmount(amount)) {
                     std::cin.clear();
                     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                     std::cout << "Invalid amount. Please enter a positive number." << std::endl;
                 } else {
-                    if (loggedInAccount->deposit(amount)) {
-                        std::cout << "Deposit successful. New balance: TK. " << std::fixed << std::setprecision(2) << loggedInAccount->getBalance() << std::endl;
-                        trans = Transaction(loggedInAccount->getAccountNumber(), "Deposit", amount, getCurrentDate());
-                        logTransaction(trans);
-                        UserAuth::saveAccounts(); // Save updated balance
+                    // The engine updates the balance, journals it and logs the transaction
+                    result = PostingEngine::deposit(loggedInAccount->getAccountNumber(), amount, balance);
+                    if (result == PostingResult::SUCCESS) {
+                        std::cout << "Deposit successful. New balance: TK. " << balance << std::endl;
                     } else {
-                        std::cout << "Deposit failed. Amount must be positive." << std::endl;
+                        std::cout << "Deposit failed. " << postingResultToString(result) << "." << std::endl;
                     }
                 }
                 pressEnterToContinue();
                 break;
             case 2: // Withdraw
                 std::cout << "Enter amount to withdraw: TK. ";
-                std::cin >> amount;
-                if (std::cin.fail() || !isValidAmount(amount)) {
+                if (!readAmount(std::cin, amount) || !isValidAmount(amount)) {
                     std::cin.clear();
                     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                     std::cout << "Invalid amount. Please enter a positive number." << std::endl;
                 } else {
-                    if (loggedInAccount->withdraw(amount)) {
-                        std::cout << "Withdrawal successful. New balance: TK. " << std::fixed << std::setprecision(2) << loggedInAccount->getBalance() << std::endl;
-                        trans = Transaction(loggedInAccount->getAccountNumber(), "Withdrawal", amount, getCurrentDate());
-                        logTransaction(trans);
-                        UserAuth::saveAccounts(); // Save updated balance
+                    result = PostingEngine::withdraw(loggedInAccount->getAccountNumber(), amount, balance);
+                    if (result == PostingResult::SUCCESS) {
+                        std::cout << "Withdrawal successful. New balance: TK. " << balance << std::endl;
                     } else {
-                        std::cout << "Withdrawal failed. Insufficient funds or invalid amount." << std::endl;
+                        std::cout << "Withdrawal failed. " << postingResultToString(result) << "." << std::endl;
                     }
                 }
                 pressEnterToContinue();